@@ -0,0 +1,166 @@
+#include "CaptureReplayer.h"
+
+CaptureReplayer::CaptureReplayer(GPUDriver* driver) : driver_(driver) {
+}
+
+bool CaptureReplayer::Replay(const std::string& path,
+                             std::function<void(uint32_t frame)> on_frame) {
+  CaptureReader reader;
+  if (!reader.Open(path))
+    return false;
+
+  num_frames_ = 0;
+  num_commands_ = 0;
+  for (auto& count : num_calls_)
+    count = 0;
+
+  bool result = true;
+  CaptureOp op;
+  while (reader.ReadOp(op)) {
+    num_calls_[(size_t)op]++;
+
+    if (op == CaptureOp::EndFrame) {
+      if (on_frame)
+        on_frame(num_frames_);
+      num_frames_++;
+      continue;
+    }
+
+    if (!ReplayOp(reader, op)) {
+      result = false;
+      break;
+    }
+  }
+
+  ///
+  /// ReadOp() also fails on an op we don't know, only a capture that ran out is complete.
+  ///
+  if (result && !reader.at_end())
+    result = false;
+
+  ///
+  /// A capture usually ends while the Renderer is still alive, release everything it left
+  /// behind so the target driver can be reused.
+  ///
+  DestroyRemainingResources();
+
+  return result;
+}
+
+bool CaptureReplayer::ReplayOp(CaptureReader& reader, CaptureOp op) {
+  uint32_t id;
+
+  switch (op) {
+  case CaptureOp::BeginSynchronize:
+    driver_->BeginSynchronize();
+    return true;
+  case CaptureOp::EndSynchronize:
+    driver_->EndSynchronize();
+    return true;
+  case CaptureOp::CreateTexture:
+  case CaptureOp::UpdateTexture: {
+    RefPtr<Bitmap> bitmap;
+    if (!reader.ReadUInt32(id) || !reader.ReadBitmap(bitmap))
+      return false;
+
+    if (op == CaptureOp::CreateTexture) {
+      uint32_t new_id = driver_->NextTextureId();
+      texture_ids_[id] = new_id;
+      driver_->CreateTexture(new_id, bitmap);
+    } else {
+      driver_->UpdateTexture(Translate(texture_ids_, id), bitmap);
+    }
+    return true;
+  }
+  case CaptureOp::DestroyTexture:
+    if (!reader.ReadUInt32(id))
+      return false;
+
+    driver_->DestroyTexture(Translate(texture_ids_, id));
+    texture_ids_.erase(id);
+    return true;
+  case CaptureOp::CreateRenderBuffer: {
+    RenderBuffer buffer;
+    if (!reader.ReadUInt32(id) || !reader.ReadRenderBuffer(buffer))
+      return false;
+
+    buffer.texture_id = Translate(texture_ids_, buffer.texture_id);
+    uint32_t new_id = driver_->NextRenderBufferId();
+    render_buffer_ids_[id] = new_id;
+    driver_->CreateRenderBuffer(new_id, buffer);
+    return true;
+  }
+  case CaptureOp::DestroyRenderBuffer:
+    if (!reader.ReadUInt32(id))
+      return false;
+
+    driver_->DestroyRenderBuffer(Translate(render_buffer_ids_, id));
+    render_buffer_ids_.erase(id);
+    return true;
+  case CaptureOp::CreateGeometry:
+  case CaptureOp::UpdateGeometry: {
+    VertexBuffer vertices;
+    IndexBuffer indices;
+    if (!reader.ReadUInt32(id) || !reader.ReadGeometry(vertices, indices))
+      return false;
+
+    if (op == CaptureOp::CreateGeometry) {
+      uint32_t new_id = driver_->NextGeometryId();
+      geometry_ids_[id] = new_id;
+      driver_->CreateGeometry(new_id, vertices, indices);
+    } else {
+      driver_->UpdateGeometry(Translate(geometry_ids_, id), vertices, indices);
+    }
+    return true;
+  }
+  case CaptureOp::DestroyGeometry:
+    if (!reader.ReadUInt32(id))
+      return false;
+
+    driver_->DestroyGeometry(Translate(geometry_ids_, id));
+    geometry_ids_.erase(id);
+    return true;
+  case CaptureOp::UpdateCommandList: {
+    CommandList list;
+    if (!reader.ReadCommandList(list))
+      return false;
+
+    for (uint32_t i = 0; i < list.size; ++i) {
+      Command& command = list.commands[i];
+      GPUState& state = command.gpu_state;
+      state.render_buffer_id = Translate(render_buffer_ids_, state.render_buffer_id);
+      state.texture_1_id = Translate(texture_ids_, state.texture_1_id);
+      state.texture_2_id = Translate(texture_ids_, state.texture_2_id);
+      state.texture_3_id = Translate(texture_ids_, state.texture_3_id);
+      command.geometry_id = Translate(geometry_ids_, command.geometry_id);
+    }
+
+    num_commands_ += list.size;
+    driver_->UpdateCommandList(list);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+void CaptureReplayer::DestroyRemainingResources() {
+  for (auto& i : geometry_ids_)
+    driver_->DestroyGeometry(i.second);
+  for (auto& i : render_buffer_ids_)
+    driver_->DestroyRenderBuffer(i.second);
+  for (auto& i : texture_ids_)
+    driver_->DestroyTexture(i.second);
+
+  geometry_ids_.clear();
+  render_buffer_ids_.clear();
+  texture_ids_.clear();
+}
+
+uint32_t CaptureReplayer::Translate(const std::map<uint32_t, uint32_t>& ids, uint32_t id) {
+  if (!id)
+    return 0;
+
+  auto i = ids.find(id);
+  return i == ids.end() ? 0 : i->second;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "GPUCapture.h"
+#include <functional>
+#include <map>
+
+///
+/// Re-issues the calls in a capture file (see RecordingGPUDriver) against any GPUDriver.
+///
+/// Resource IDs are requested from the target driver as resources are created and every ID in
+/// the capture (including the ones referenced by commands and render buffers) is translated to
+/// the target's, so the capture doesn't depend on how the original driver numbered things.
+///
+class CaptureReplayer {
+public:
+  CaptureReplayer(GPUDriver* driver);
+
+  ///
+  /// Replay the whole capture. 'on_frame' is called at the end of every recorded frame, which is
+  /// where an app would draw the command list it received.
+  ///
+  /// Returns false if the capture couldn't be opened or is malformed.
+  ///
+  bool Replay(const std::string& path, std::function<void(uint32_t frame)> on_frame = nullptr);
+
+  uint32_t num_frames() const { return num_frames_; }
+  size_t num_calls(CaptureOp op) const { return num_calls_[(size_t)op]; }
+  size_t num_commands() const { return num_commands_; }
+
+protected:
+  bool ReplayOp(CaptureReader& reader, CaptureOp op);
+  void DestroyRemainingResources();
+
+  // Translates a captured ID (0 means no resource and is left alone).
+  static uint32_t Translate(const std::map<uint32_t, uint32_t>& ids, uint32_t id);
+
+  GPUDriver* driver_;
+  std::map<uint32_t, uint32_t> texture_ids_;
+  std::map<uint32_t, uint32_t> render_buffer_ids_;
+  std::map<uint32_t, uint32_t> geometry_ids_;
+  uint32_t num_frames_ = 0;
+  size_t num_calls_[(size_t)CaptureOp::Count] = {};
+  size_t num_commands_ = 0;
+};
@@ -0,0 +1,257 @@
+#include "GPUCapture.h"
+#include <cstddef>
+#include <cstring>
+
+// Anything larger than this is assumed to come from a corrupt capture.
+#define MAX_BUFFER_SIZE (256 * 1024 * 1024)
+
+// Where the clip matrices start and end within a Command.
+static const size_t kClipOffset = offsetof(Command, gpu_state) + offsetof(GPUState, clip);
+static const size_t kClipEnd = kClipOffset + sizeof(GPUState::clip);
+
+const char* CaptureOpName(CaptureOp op) {
+  switch (op) {
+  case CaptureOp::BeginSynchronize: return "BeginSynchronize";
+  case CaptureOp::EndSynchronize: return "EndSynchronize";
+  case CaptureOp::CreateTexture: return "CreateTexture";
+  case CaptureOp::UpdateTexture: return "UpdateTexture";
+  case CaptureOp::DestroyTexture: return "DestroyTexture";
+  case CaptureOp::CreateRenderBuffer: return "CreateRenderBuffer";
+  case CaptureOp::DestroyRenderBuffer: return "DestroyRenderBuffer";
+  case CaptureOp::CreateGeometry: return "CreateGeometry";
+  case CaptureOp::UpdateGeometry: return "UpdateGeometry";
+  case CaptureOp::DestroyGeometry: return "DestroyGeometry";
+  case CaptureOp::UpdateCommandList: return "UpdateCommandList";
+  case CaptureOp::EndFrame: return "EndFrame";
+  default: return "Unknown";
+  }
+}
+
+CaptureWriter::CaptureWriter() {
+}
+
+CaptureWriter::~CaptureWriter() {
+  Close();
+}
+
+bool CaptureWriter::Open(const std::string& path) {
+  Close();
+
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_)
+    return false;
+
+  bytes_written_ = 0;
+  Write(GPU_CAPTURE_MAGIC, strlen(GPU_CAPTURE_MAGIC));
+  WriteUInt32(GPU_CAPTURE_VERSION);
+  WriteUInt32((uint32_t)sizeof(Command));
+  WriteUInt32((uint32_t)sizeof(GPUState));
+  return true;
+}
+
+void CaptureWriter::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+void CaptureWriter::WriteOp(CaptureOp op) {
+  WriteUInt8((uint8_t)op);
+}
+
+void CaptureWriter::WriteBitmap(RefPtr<Bitmap> bitmap) {
+  WriteUInt32(bitmap->width());
+  WriteUInt32(bitmap->height());
+  WriteUInt8((uint8_t)bitmap->format());
+
+  bool is_empty = bitmap->IsEmpty();
+  WriteUInt8(is_empty ? 1 : 0);
+  if (is_empty)
+    return;
+
+  size_t packed_row_bytes = (size_t)bitmap->width() * bitmap->bpp();
+  const uint8_t* pixels = (const uint8_t*)bitmap->LockPixels();
+  for (uint32_t y = 0; y < bitmap->height(); ++y)
+    Write(pixels + (size_t)y * bitmap->row_bytes(), packed_row_bytes);
+  bitmap->UnlockPixels();
+}
+
+void CaptureWriter::WriteRenderBuffer(const RenderBuffer& buffer) {
+  Write(&buffer, sizeof(buffer));
+}
+
+void CaptureWriter::WriteGeometry(const VertexBuffer& vertices, const IndexBuffer& indices) {
+  WriteUInt8((uint8_t)vertices.format);
+  WriteUInt32(vertices.size);
+  Write(vertices.data, vertices.size);
+  WriteUInt32(indices.size);
+  Write(indices.data, indices.size);
+}
+
+void CaptureWriter::WriteCommandList(const CommandList& list) {
+  WriteUInt32(list.size);
+
+  for (uint32_t i = 0; i < list.size; ++i) {
+    const Command& command = list.commands[i];
+    const uint8_t* bytes = (const uint8_t*)&command;
+    uint8_t clip_size = command.gpu_state.clip_size;
+    if (clip_size > 8)
+      clip_size = 8;
+
+    Write(bytes, kClipOffset);
+    Write(bytes + kClipOffset, clip_size * sizeof(Matrix4x4));
+    Write(bytes + kClipEnd, sizeof(Command) - kClipEnd);
+  }
+}
+
+void CaptureWriter::Write(const void* data, size_t size) {
+  if (!file_ || !size)
+    return;
+
+  fwrite(data, 1, size, file_);
+  bytes_written_ += size;
+}
+
+CaptureReader::CaptureReader() {
+}
+
+CaptureReader::~CaptureReader() {
+  Close();
+}
+
+bool CaptureReader::Open(const std::string& path) {
+  Close();
+
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_)
+    return false;
+
+  char magic[8];
+  uint32_t version = 0, command_size = 0, gpu_state_size = 0;
+  if (!Read(magic, sizeof(magic)) || memcmp(magic, GPU_CAPTURE_MAGIC, sizeof(magic)) != 0 ||
+      !ReadUInt32(version) || version != GPU_CAPTURE_VERSION ||
+      !ReadUInt32(command_size) || command_size != sizeof(Command) ||
+      !ReadUInt32(gpu_state_size) || gpu_state_size != sizeof(GPUState)) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void CaptureReader::Close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool CaptureReader::ReadOp(CaptureOp& op) {
+  uint8_t value;
+  if (!ReadUInt8(value) || value >= (uint8_t)CaptureOp::Count)
+    return false;
+
+  op = (CaptureOp)value;
+  return true;
+}
+
+bool CaptureReader::ReadBitmap(RefPtr<Bitmap>& bitmap) {
+  uint32_t width, height;
+  uint8_t format, is_empty;
+  if (!ReadUInt32(width) || !ReadUInt32(height) || !ReadUInt8(format) || !ReadUInt8(is_empty))
+    return false;
+
+  if (format > (uint8_t)BitmapFormat::BGRA8_UNORM_SRGB)
+    return false;
+
+  BitmapFormat bitmap_format = (BitmapFormat)format;
+  uint32_t bpp = bitmap_format == BitmapFormat::A8_UNORM ? 1 : 4;
+
+  if (is_empty) {
+    ///
+    /// Render buffer textures are created from a Bitmap that has dimensions but no pixels.
+    ///
+    bitmap = Bitmap::Create(width, height, bitmap_format, width * bpp, nullptr, 0, false);
+    return true;
+  }
+
+  if (!width || !height || (size_t)width * height * bpp > MAX_BUFFER_SIZE)
+    return false;
+
+  bitmap = Bitmap::Create(width, height, bitmap_format);
+  size_t packed_row_bytes = (size_t)width * bpp;
+  uint8_t* pixels = (uint8_t*)bitmap->LockPixels();
+  bool result = true;
+  for (uint32_t y = 0; y < height && result; ++y)
+    result = Read(pixels + (size_t)y * bitmap->row_bytes(), packed_row_bytes);
+  bitmap->UnlockPixels();
+
+  return result;
+}
+
+bool CaptureReader::ReadRenderBuffer(RenderBuffer& buffer) {
+  return Read(&buffer, sizeof(buffer));
+}
+
+bool CaptureReader::ReadGeometry(VertexBuffer& vertices, IndexBuffer& indices) {
+  uint8_t format;
+  if (!ReadUInt8(format) || format > (uint8_t)VertexBufferFormat::_2f_4ub_2f_2f_28f)
+    return false;
+
+  vertices.format = (VertexBufferFormat)format;
+  if (!ReadUInt32(vertices.size) || vertices.size > MAX_BUFFER_SIZE)
+    return false;
+  vertex_data_.resize(vertices.size);
+  if (!Read(vertex_data_.data(), vertices.size))
+    return false;
+  vertices.data = vertex_data_.data();
+
+  if (!ReadUInt32(indices.size) || indices.size > MAX_BUFFER_SIZE)
+    return false;
+  index_data_.resize(indices.size);
+  if (!Read(index_data_.data(), indices.size))
+    return false;
+  indices.data = index_data_.data();
+
+  return true;
+}
+
+bool CaptureReader::ReadCommandList(CommandList& list) {
+  uint32_t size;
+  if (!ReadUInt32(size) || size > MAX_BUFFER_SIZE / sizeof(Command))
+    return false;
+
+  commands_.resize(size);
+
+  for (uint32_t i = 0; i < size; ++i) {
+    Command& command = commands_[i];
+    uint8_t* bytes = (uint8_t*)&command;
+    memset(bytes, 0, sizeof(Command));
+
+    if (!Read(bytes, kClipOffset))
+      return false;
+
+    uint8_t clip_size = command.gpu_state.clip_size;
+    if (clip_size > 8)
+      clip_size = 8;
+
+    if (!Read(bytes + kClipOffset, clip_size * sizeof(Matrix4x4)) ||
+        !Read(bytes + kClipEnd, sizeof(Command) - kClipEnd))
+      return false;
+  }
+
+  list.size = size;
+  list.commands = commands_.data();
+  return true;
+}
+
+bool CaptureReader::Read(void* data, size_t size) {
+  if (!file_)
+    return false;
+
+  if (!size)
+    return true;
+
+  return fread(data, 1, size, file_) == size;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <Ultralight/platform/GPUDriver.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace ultralight;
+
+///
+/// A GPU capture is a binary file holding every call made to a GPUDriver, in order:
+///
+///   header:  "ULGPUCAP", version, sizeof(Command), sizeof(GPUState)
+///   records: one CaptureOp byte followed by that call's arguments
+///
+/// All values are stored little-endian, in the layout of the SDK that recorded them (captures
+/// are only meant to be replayed by a build against the same SDK, which the header checks).
+///
+#define GPU_CAPTURE_MAGIC   "ULGPUCAP"
+#define GPU_CAPTURE_VERSION 1
+
+enum class CaptureOp : uint8_t {
+  BeginSynchronize,
+  EndSynchronize,
+  CreateTexture,
+  UpdateTexture,
+  DestroyTexture,
+  CreateRenderBuffer,
+  DestroyRenderBuffer,
+  CreateGeometry,
+  UpdateGeometry,
+  DestroyGeometry,
+  UpdateCommandList,
+  EndFrame,           // Marks the end of a call to Renderer::Render()
+  Count,
+};
+
+const char* CaptureOpName(CaptureOp op);
+
+///
+/// Writes GPUDriver calls to a capture file.
+///
+class CaptureWriter {
+public:
+  CaptureWriter();
+  ~CaptureWriter();
+
+  bool Open(const std::string& path);
+  void Close();
+  bool is_open() const { return file_ != nullptr; }
+
+  size_t bytes_written() const { return bytes_written_; }
+
+  void WriteOp(CaptureOp op);
+  void WriteUInt8(uint8_t value) { Write(&value, sizeof(value)); }
+  void WriteUInt32(uint32_t value) { Write(&value, sizeof(value)); }
+
+  ///
+  /// Bitmaps are stored with tightly-packed rows. Empty bitmaps (used for render buffer
+  /// textures) only store their dimensions.
+  ///
+  void WriteBitmap(RefPtr<Bitmap> bitmap);
+  void WriteRenderBuffer(const RenderBuffer& buffer);
+  void WriteGeometry(const VertexBuffer& vertices, const IndexBuffer& indices);
+
+  ///
+  /// Commands are stored as-is, except that the unused clip matrices in each command's GPUState
+  /// (clip[clip_size] onwards) are left out-- they make up most of a command's size.
+  ///
+  void WriteCommandList(const CommandList& list);
+
+protected:
+  void Write(const void* data, size_t size);
+
+  FILE* file_ = nullptr;
+  size_t bytes_written_ = 0;
+};
+
+///
+/// Reads back what CaptureWriter wrote. Every Read method returns false once the capture runs out
+/// or turns out to be malformed.
+///
+class CaptureReader {
+public:
+  CaptureReader();
+  ~CaptureReader();
+
+  bool Open(const std::string& path);
+  void Close();
+
+  bool ReadOp(CaptureOp& op);
+
+  ///
+  /// Whether the last read failed because the capture ended, rather than because it was
+  /// malformed.
+  ///
+  bool at_end() const { return file_ && feof(file_); }
+
+  bool ReadUInt8(uint8_t& value) { return Read(&value, sizeof(value)); }
+  bool ReadUInt32(uint32_t& value) { return Read(&value, sizeof(value)); }
+  bool ReadBitmap(RefPtr<Bitmap>& bitmap);
+  bool ReadRenderBuffer(RenderBuffer& buffer);
+
+  ///
+  /// The returned buffers point into storage owned by the reader, they remain valid until the
+  /// next call to ReadGeometry().
+  ///
+  bool ReadGeometry(VertexBuffer& vertices, IndexBuffer& indices);
+
+  ///
+  /// The returned list points into storage owned by the reader, it remains valid until the next
+  /// call to ReadCommandList().
+  ///
+  bool ReadCommandList(CommandList& list);
+
+protected:
+  bool Read(void* data, size_t size);
+
+  FILE* file_ = nullptr;
+  std::vector<uint8_t> vertex_data_;
+  std::vector<uint8_t> index_data_;
+  std::vector<Command> commands_;
+};
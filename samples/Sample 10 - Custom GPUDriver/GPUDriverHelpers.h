@@ -0,0 +1,27 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <algorithm>
+
+using namespace ultralight;
+
+///
+/// Fill types of the Fill shader (stored in the first component of each vertex's data0).
+///
+enum FillType {
+  FillType_Solid = 0,
+  FillType_Image = 1,
+  FillType_Glyph = 9,
+};
+
+inline IntRect IntersectRects(const IntRect& a, const IntRect& b) {
+  IntRect result;
+  result.left = std::max(a.left, b.left);
+  result.top = std::max(a.top, b.top);
+  result.right = std::min(a.right, b.right);
+  result.bottom = std::min(a.bottom, b.bottom);
+  return result;
+}
+
+inline bool IsEmptyRect(const IntRect& rect) {
+  return rect.right <= rect.left || rect.bottom <= rect.top;
+}
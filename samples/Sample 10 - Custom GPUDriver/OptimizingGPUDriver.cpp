@@ -0,0 +1,440 @@
+#include "OptimizingGPUDriver.h"
+#include "GPUDriverHelpers.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+static bool ContainsRect(const IntRect& outer, const IntRect& inner) {
+  return inner.left >= outer.left && inner.top >= outer.top && inner.right <= outer.right &&
+         inner.bottom <= outer.bottom;
+}
+
+static bool ReadsTexture(const GPUState& state, uint32_t texture_id) {
+  return texture_id && (state.texture_1_id == texture_id || state.texture_2_id == texture_id ||
+                        state.texture_3_id == texture_id);
+}
+
+///
+/// Compare only the state that affects rendering: clips past 'clip_size' and the scissor rect
+/// when scissoring is off are ignored.
+///
+static bool IsSameState(const GPUState& a, const GPUState& b) {
+  if (a.viewport_width != b.viewport_width || a.viewport_height != b.viewport_height ||
+      a.enable_texturing != b.enable_texturing || a.enable_blend != b.enable_blend ||
+      (uint8_t)a.shader_type != (uint8_t)b.shader_type ||
+      a.render_buffer_id != b.render_buffer_id || a.texture_1_id != b.texture_1_id ||
+      a.texture_2_id != b.texture_2_id || a.texture_3_id != b.texture_3_id ||
+      a.clip_size != b.clip_size || a.enable_scissor != b.enable_scissor)
+    return false;
+
+  if (memcmp(a.transform.data, b.transform.data, sizeof(a.transform.data)) ||
+      memcmp(a.uniform_scalar, b.uniform_scalar, sizeof(a.uniform_scalar)) ||
+      memcmp(a.uniform_vector, b.uniform_vector, sizeof(a.uniform_vector)))
+    return false;
+
+  for (uint8_t i = 0; i < a.clip_size && i < 8; ++i)
+    if (memcmp(a.clip[i].data, b.clip[i].data, sizeof(a.clip[i].data)))
+      return false;
+
+  if (a.enable_scissor &&
+      (a.scissor_rect.left != b.scissor_rect.left || a.scissor_rect.top != b.scissor_rect.top ||
+       a.scissor_rect.right != b.scissor_rect.right ||
+       a.scissor_rect.bottom != b.scissor_rect.bottom))
+    return false;
+
+  return true;
+}
+
+OptimizingGPUDriver::OptimizingGPUDriver(GPUDriver* driver, const Options& options)
+  : driver_(driver), options_(options) {
+}
+
+void OptimizingGPUDriver::CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  driver_->CreateTexture(texture_id, bitmap);
+}
+
+void OptimizingGPUDriver::UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  driver_->UpdateTexture(texture_id, bitmap);
+}
+
+void OptimizingGPUDriver::DestroyTexture(uint32_t texture_id) {
+  driver_->DestroyTexture(texture_id);
+}
+
+void OptimizingGPUDriver::CreateRenderBuffer(uint32_t render_buffer_id,
+                                             const RenderBuffer& buffer) {
+  render_buffers_[render_buffer_id] = buffer;
+  driver_->CreateRenderBuffer(render_buffer_id, buffer);
+}
+
+void OptimizingGPUDriver::DestroyRenderBuffer(uint32_t render_buffer_id) {
+  render_buffers_.erase(render_buffer_id);
+  driver_->DestroyRenderBuffer(render_buffer_id);
+}
+
+void OptimizingGPUDriver::CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                         const IndexBuffer& indices) {
+  StoreGeometry(geometry_id, vertices, indices);
+  driver_->CreateGeometry(geometry_id, vertices, indices);
+}
+
+void OptimizingGPUDriver::UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                         const IndexBuffer& indices) {
+  StoreGeometry(geometry_id, vertices, indices);
+  driver_->UpdateGeometry(geometry_id, vertices, indices);
+}
+
+void OptimizingGPUDriver::StoreGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                        const IndexBuffer& indices) {
+  Geometry& geometry = geometry_[geometry_id];
+  geometry.format = vertices.format;
+  geometry.vertices.assign(vertices.data, vertices.data + vertices.size);
+  geometry.indices.resize(indices.size / sizeof(IndexType));
+  if (!geometry.indices.empty())
+    memcpy(geometry.indices.data(), indices.data, geometry.indices.size() * sizeof(IndexType));
+}
+
+void OptimizingGPUDriver::DestroyGeometry(uint32_t geometry_id) {
+  geometry_.erase(geometry_id);
+  driver_->DestroyGeometry(geometry_id);
+}
+
+void OptimizingGPUDriver::UpdateCommandList(const CommandList& list) {
+  auto start = std::chrono::steady_clock::now();
+
+  entries_.clear();
+  for (uint32_t i = 0; i < list.size; ++i) {
+    Entry entry;
+    if (Analyze(list.commands[i], entry))
+      entries_.push_back(entry);
+    else
+      num_dropped_++;
+  }
+
+  if (options_.cull)
+    Cull();
+  if (options_.reorder)
+    Reorder();
+  if (options_.merge)
+    Merge();
+
+  commands_.clear();
+  for (auto& entry : entries_)
+    commands_.push_back(entry.command);
+
+  commands_in_ += list.size;
+  commands_out_ += commands_.size();
+
+  auto end = std::chrono::steady_clock::now();
+  cpu_time_ += std::chrono::duration<double, std::milli>(end - start).count();
+
+  if (commands_.empty())
+    return;
+
+  CommandList optimized;
+  optimized.size = (uint32_t)commands_.size();
+  optimized.commands = commands_.data();
+  driver_->UpdateCommandList(optimized);
+}
+
+bool OptimizingGPUDriver::Analyze(const Command& command, Entry& entry) const {
+  entry.command = command;
+  entry.is_clear = (uint8_t)command.command_type == (uint8_t)CommandType::ClearRenderBuffer;
+  entry.is_opaque = false;
+  entry.opaque_rect = { 0, 0, 0, 0 };
+  entry.target_texture = 0;
+
+  ///
+  /// Clear state that has no effect so states that render the same compare (and batch) the same.
+  ///
+  GPUState& state = entry.command.gpu_state;
+  for (uint8_t i = state.clip_size; i < 8; ++i)
+    memset(state.clip[i].data, 0, sizeof(state.clip[i].data));
+  if (!state.enable_scissor)
+    state.scissor_rect = { 0, 0, 0, 0 };
+
+  IntRect target = { 0, 0, INT_MAX, INT_MAX };
+  auto render_buffer = render_buffers_.find(state.render_buffer_id);
+  if (render_buffer != render_buffers_.end()) {
+    target = { 0, 0, (int)render_buffer->second.width, (int)render_buffer->second.height };
+    entry.target_texture = render_buffer->second.texture_id;
+  }
+
+  if (entry.is_clear) {
+    entry.bounds = target;
+    entry.is_opaque = true;
+    entry.opaque_rect = target;
+    return true;
+  }
+
+  IntRect visible = IntersectRects(target, { 0, 0, (int)state.viewport_width,
+                                             (int)state.viewport_height });
+  if (state.enable_scissor)
+    visible = IntersectRects(visible, state.scissor_rect);
+
+  auto i = geometry_.find(command.geometry_id);
+  if (command.indices_count == 0 || i == geometry_.end() || IsEmptyRect(visible))
+    return false;
+
+  const Geometry& geometry = i->second;
+  bool is_path = geometry.format == VertexBufferFormat::_2f_4ub_2f;
+  size_t stride = is_path ? sizeof(Vertex_2f_4ub_2f) : sizeof(Vertex_2f_4ub_2f_2f_28f);
+  size_t num_vertices = geometry.vertices.size() / stride;
+
+  uint64_t first = command.indices_offset;
+  uint64_t last = std::min<uint64_t>(first + command.indices_count, geometry.indices.size());
+  if (first + 3 > last)
+    return false;
+
+  ///
+  /// Bound the vertices the draw uses in render buffer pixels. Vertices behind the camera don't
+  /// have a meaningful position so we assume those draws cover everything visible.
+  ///
+  const float* m = state.transform.data;
+  float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+  bool is_unbounded = false;
+  for (uint64_t index = first; index < last; ++index) {
+    IndexType vertex = geometry.indices[index];
+    if (vertex >= num_vertices)
+      continue;
+
+    const float* pos = (const float*)(geometry.vertices.data() + vertex * stride);
+    float w = pos[0] * m[3] + pos[1] * m[7] + m[15];
+    if (w <= 0.0f) {
+      is_unbounded = true;
+      break;
+    }
+
+    float x = (pos[0] * m[0] + pos[1] * m[4] + m[12]) / w;
+    float y = (pos[0] * m[1] + pos[1] * m[5] + m[13]) / w;
+    min_x = std::min(min_x, x);
+    min_y = std::min(min_y, y);
+    max_x = std::max(max_x, x);
+    max_y = std::max(max_y, y);
+  }
+
+  if (is_unbounded) {
+    entry.bounds = visible;
+  } else {
+    if (min_x > max_x)
+      return false;
+
+    IntRect bounds = { (int)std::max(std::floor(min_x), -1e9f),
+                       (int)std::max(std::floor(min_y), -1e9f),
+                       (int)std::min(std::ceil(max_x) + 1, 1e9f),
+                       (int)std::min(std::ceil(max_y) + 1, 1e9f) };
+    entry.bounds = IntersectRects(bounds, visible);
+    if (IsEmptyRect(entry.bounds))
+      return false;
+  }
+
+  IntRect opaque_rect;
+  if (IsOpaqueRect(entry.command, geometry, opaque_rect)) {
+    entry.opaque_rect = IntersectRects(opaque_rect, visible);
+    entry.is_opaque = !IsEmptyRect(entry.opaque_rect);
+  }
+
+  return true;
+}
+
+bool OptimizingGPUDriver::IsOpaqueRect(const Command& command, const Geometry& geometry,
+                                       IntRect& rect) const {
+  ///
+  /// We only look for the most common opaque draw: an unclipped, axis-aligned quad (two triangles
+  /// split along a diagonal) with a solid, fully opaque fill.
+  ///
+  const GPUState& state = command.gpu_state;
+  const float* m = state.transform.data;
+  if ((uint8_t)state.shader_type != (uint8_t)ShaderType::Fill || state.clip_size != 0 ||
+      geometry.format != VertexBufferFormat::_2f_4ub_2f_2f_28f || command.indices_count != 6 ||
+      m[3] != 0.0f || m[7] != 0.0f || m[15] != 1.0f)
+    return false;
+
+  size_t num_vertices = geometry.vertices.size() / sizeof(Vertex_2f_4ub_2f_2f_28f);
+  if ((uint64_t)command.indices_offset + 6 > geometry.indices.size())
+    return false;
+
+  float x[6], y[6];
+  for (int i = 0; i < 6; ++i) {
+    IndexType index = geometry.indices[command.indices_offset + i];
+    if (index >= num_vertices)
+      return false;
+
+    const Vertex_2f_4ub_2f_2f_28f* vertex =
+      (const Vertex_2f_4ub_2f_2f_28f*)geometry.vertices.data() + index;
+    if ((uint32_t)(vertex->data0[0] + 0.5f) != FillType_Solid || vertex->color[3] != 255)
+      return false;
+
+    x[i] = vertex->pos[0] * m[0] + vertex->pos[1] * m[4] + m[12];
+    y[i] = vertex->pos[0] * m[1] + vertex->pos[1] * m[5] + m[13];
+  }
+
+  float left = *std::min_element(x, x + 6), right = *std::max_element(x, x + 6);
+  float top = *std::min_element(y, y + 6), bottom = *std::max_element(y, y + 6);
+
+  ///
+  /// Every vertex must sit on a corner (numbered bit 0 = right, bit 1 = bottom). Each triangle
+  /// must use three different corners and the corners they leave out must be opposite each
+  /// other, otherwise the two halves don't cover the whole rect.
+  ///
+  int missing[2];
+  for (int t = 0; t < 2; ++t) {
+    int corners = 0;
+    for (int v = t * 3; v < t * 3 + 3; ++v) {
+      if ((x[v] != left && x[v] != right) || (y[v] != top && y[v] != bottom))
+        return false;
+      corners |= 1 << ((x[v] == right ? 1 : 0) | (y[v] == bottom ? 2 : 0));
+    }
+
+    switch (corners) {
+    case 0xE: missing[t] = 0; break;
+    case 0xD: missing[t] = 1; break;
+    case 0xB: missing[t] = 2; break;
+    case 0x7: missing[t] = 3; break;
+    default: return false;
+    }
+  }
+
+  if ((missing[0] ^ missing[1]) != 3)
+    return false;
+
+  ///
+  /// Only pixels whose centers are strictly inside the rect are certain to be covered.
+  ///
+  rect = { (int)std::ceil(left), (int)std::ceil(top), (int)std::floor(right),
+           (int)std::floor(bottom) };
+  return !IsEmptyRect(rect);
+}
+
+void OptimizingGPUDriver::Cull() {
+  ///
+  /// Walk backwards collecting the opaque rects drawn to each render buffer so far, anything
+  /// earlier inside one of them is never seen. Sampling a render buffer makes everything drawn
+  /// to it up to that point visible again.
+  ///
+  std::map<uint32_t, std::vector<IntRect>> occluders;
+
+  scratch_.clear();
+  for (size_t i = entries_.size(); i-- > 0;) {
+    const Entry& entry = entries_[i];
+    std::vector<IntRect>& rects = occluders[entry.command.gpu_state.render_buffer_id];
+
+    bool is_hidden = false;
+    for (auto& rect : rects) {
+      if (ContainsRect(rect, entry.bounds)) {
+        is_hidden = true;
+        break;
+      }
+    }
+
+    if (is_hidden) {
+      num_culled_++;
+      continue;
+    }
+
+    scratch_.push_back(entry);
+
+    if (entry.is_clear) {
+      rects.assign(1, entry.opaque_rect);
+    } else if (entry.is_opaque) {
+      if (rects.size() < MAX_OCCLUDERS) {
+        rects.push_back(entry.opaque_rect);
+      } else {
+        // Replace the smallest rect if this one is larger.
+        auto area = [](const IntRect& r) { return (int64_t)r.width() * r.height(); };
+        auto smallest = std::min_element(rects.begin(), rects.end(),
+          [&](const IntRect& a, const IntRect& b) { return area(a) < area(b); });
+        if (area(*smallest) < area(entry.opaque_rect))
+          *smallest = entry.opaque_rect;
+      }
+    }
+
+    for (auto& other : occluders) {
+      auto render_buffer = render_buffers_.find(other.first);
+      if (render_buffer != render_buffers_.end() &&
+          ReadsTexture(entry.command.gpu_state, render_buffer->second.texture_id))
+        other.second.clear();
+    }
+  }
+
+  entries_.assign(scratch_.rbegin(), scratch_.rend());
+}
+
+void OptimizingGPUDriver::Reorder() {
+  ///
+  /// Move each draw back to just after the closest earlier draw with the same state, as long as
+  /// it doesn't depend on anything it moves past.
+  ///
+  scratch_.clear();
+  for (auto& entry : entries_) {
+    size_t insert_at = scratch_.size();
+    if (!entry.is_clear) {
+      size_t limit = scratch_.size() > REORDER_WINDOW ? scratch_.size() - REORDER_WINDOW : 0;
+      for (size_t i = scratch_.size(); i-- > limit;) {
+        const Entry& earlier = scratch_[i];
+        if (!earlier.is_clear && IsSameState(earlier.command.gpu_state, entry.command.gpu_state)) {
+          insert_at = i + 1;
+          break;
+        }
+
+        if (DependsOn(entry, earlier))
+          break;
+      }
+    }
+
+    if (insert_at != scratch_.size())
+      num_reordered_++;
+
+    scratch_.insert(scratch_.begin() + insert_at, entry);
+  }
+
+  entries_.swap(scratch_);
+}
+
+void OptimizingGPUDriver::Merge() {
+  ///
+  /// Adjacent draws of consecutive index ranges of the same geometry with the same state are
+  /// the same as one draw of both ranges.
+  ///
+  size_t out = 0;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    Entry& entry = entries_[i];
+    if (out > 0) {
+      Entry& previous = entries_[out - 1];
+      Command& a = previous.command;
+      const Command& b = entry.command;
+      if (!previous.is_clear && !entry.is_clear && a.geometry_id == b.geometry_id &&
+          (uint64_t)a.indices_offset + a.indices_count == b.indices_offset &&
+          IsSameState(a.gpu_state, b.gpu_state)) {
+        a.indices_count += b.indices_count;
+        previous.bounds.left = std::min(previous.bounds.left, entry.bounds.left);
+        previous.bounds.top = std::min(previous.bounds.top, entry.bounds.top);
+        previous.bounds.right = std::max(previous.bounds.right, entry.bounds.right);
+        previous.bounds.bottom = std::max(previous.bounds.bottom, entry.bounds.bottom);
+        previous.is_opaque = false;
+        num_merged_++;
+        continue;
+      }
+    }
+
+    if (out != i)
+      entries_[out] = entry;
+    out++;
+  }
+
+  entries_.resize(out);
+}
+
+bool OptimizingGPUDriver::DependsOn(const Entry& later, const Entry& earlier) {
+  if (later.command.gpu_state.render_buffer_id == earlier.command.gpu_state.render_buffer_id) {
+    if (later.is_clear || earlier.is_clear)
+      return true;
+    if (!IsEmptyRect(IntersectRects(later.bounds, earlier.bounds)))
+      return true;
+  }
+
+  return ReadsTexture(later.command.gpu_state, earlier.target_texture) ||
+         ReadsTexture(earlier.command.gpu_state, later.target_texture);
+}
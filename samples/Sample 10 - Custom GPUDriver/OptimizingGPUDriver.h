@@ -0,0 +1,136 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <Ultralight/platform/GPUDriver.h>
+#include <map>
+#include <vector>
+
+using namespace ultralight;
+
+///
+/// Number of commands we look back when trying to move a draw next to one with the same state.
+///
+#define REORDER_WINDOW 64
+
+///
+/// Number of opaque rects we remember per render buffer when culling hidden draws.
+///
+#define MAX_OCCLUDERS 16
+
+///
+/// A GPUDriver that rewrites every command list before forwarding it (and everything else) to
+/// another driver.
+///
+/// Each list goes through these passes, all of which leave the final pixels unchanged:
+///
+///   - Drop: draws with no indices, unknown geometry, or nothing on screen (outside the
+///     viewport or scissor rect).
+///   - Normalize: clear state that has no effect (unused clips, the scissor rect when scissoring
+///     is off) so equivalent states compare equal, here and in the driver we forward to.
+///   - Cull: draws completely hidden by later opaque draws (solid, axis-aligned, unclipped quads)
+///     or clears of the same render buffer, unless something samples the render buffer in
+///     between.
+///   - Reorder: move draws back next to an earlier draw with the same state when nothing in
+///     between depends on them (overlapping draws to the same render buffer, or reads of a
+///     render buffer one of them writes).
+///   - Merge: fold adjacent draws with the same state and contiguous ranges of the same geometry
+///     into one.
+///
+/// Set this as the GPUDriver instead of your own and pass yours to the constructor, we keep a
+/// CPU copy of all geometry to work out what each draw covers.
+///
+class OptimizingGPUDriver : public GPUDriver {
+public:
+  // Passes to run (dropping invisible draws and normalizing state always happen).
+  struct Options {
+    Options() : cull(true), reorder(true), merge(true) {}
+    bool cull;
+    bool reorder;
+    bool merge;
+  };
+
+  OptimizingGPUDriver(GPUDriver* driver, const Options& options = Options());
+  virtual ~OptimizingGPUDriver() {}
+
+  size_t commands_in() const { return commands_in_; }
+  size_t commands_out() const { return commands_out_; }
+  size_t num_dropped() const { return num_dropped_; }
+  size_t num_culled() const { return num_culled_; }
+  size_t num_reordered() const { return num_reordered_; }
+  size_t num_merged() const { return num_merged_; }
+
+  // Total CPU time spent optimizing command lists, in milliseconds.
+  double cpu_time() const { return cpu_time_; }
+
+  // Inherited from GPUDriver
+  virtual void BeginSynchronize() override { driver_->BeginSynchronize(); }
+  virtual void EndSynchronize() override { driver_->EndSynchronize(); }
+  virtual uint32_t NextTextureId() override { return driver_->NextTextureId(); }
+  virtual void CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void DestroyTexture(uint32_t texture_id) override;
+  virtual uint32_t NextRenderBufferId() override { return driver_->NextRenderBufferId(); }
+  virtual void CreateRenderBuffer(uint32_t render_buffer_id, const RenderBuffer& buffer) override;
+  virtual void DestroyRenderBuffer(uint32_t render_buffer_id) override;
+  virtual uint32_t NextGeometryId() override { return driver_->NextGeometryId(); }
+  virtual void CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void DestroyGeometry(uint32_t geometry_id) override;
+  virtual void UpdateCommandList(const CommandList& list) override;
+
+protected:
+  struct Geometry {
+    VertexBufferFormat format;
+    std::vector<uint8_t> vertices;
+    std::vector<IndexType> indices;
+  };
+
+  // A command along with what we worked out about it.
+  struct Entry {
+    Command command;
+    bool is_clear;
+    IntRect bounds;           // Pixels it may touch (clears: the whole render buffer)
+    bool is_opaque;           // Whether every pixel in 'opaque_rect' is overwritten
+    IntRect opaque_rect;
+    uint32_t target_texture;  // Texture backing the render buffer drawn to
+  };
+
+  ///
+  /// Keep a copy of a geometry's vertices and indices, Analyze() reads them to work out what
+  /// each command draws.
+  ///
+  void StoreGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                     const IndexBuffer& indices);
+
+  ///
+  /// Fill in 'entry' for 'command', returns false if the command can be dropped.
+  ///
+  bool Analyze(const Command& command, Entry& entry) const;
+  bool IsOpaqueRect(const Command& command, const Geometry& geometry, IntRect& rect) const;
+  void Cull();
+  void Reorder();
+  void Merge();
+
+  ///
+  /// Whether 'later' has to stay after 'earlier': they touch the same pixels of a render buffer
+  /// (clears touch all of them), or one samples the render buffer the other draws to.
+  ///
+  static bool DependsOn(const Entry& later, const Entry& earlier);
+
+  GPUDriver* driver_;
+  Options options_;
+  std::map<uint32_t, Geometry> geometry_;
+  std::map<uint32_t, RenderBuffer> render_buffers_;
+  std::vector<Entry> entries_;
+  std::vector<Entry> scratch_;
+  std::vector<Command> commands_;
+
+  size_t commands_in_ = 0;
+  size_t commands_out_ = 0;
+  size_t num_dropped_ = 0;
+  size_t num_culled_ = 0;
+  size_t num_reordered_ = 0;
+  size_t num_merged_ = 0;
+  double cpu_time_ = 0;
+};
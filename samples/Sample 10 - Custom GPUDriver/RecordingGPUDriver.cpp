@@ -0,0 +1,133 @@
+#include "RecordingGPUDriver.h"
+
+RecordingGPUDriver::RecordingGPUDriver(const std::string& path, GPUDriver* driver)
+  : driver_(driver) {
+  writer_.Open(path);
+}
+
+RecordingGPUDriver::~RecordingGPUDriver() {
+  StopRecording();
+}
+
+void RecordingGPUDriver::EndFrame() {
+  WriteOp(CaptureOp::EndFrame);
+  num_frames_++;
+}
+
+void RecordingGPUDriver::StopRecording() {
+  writer_.Close();
+}
+
+void RecordingGPUDriver::BeginSynchronize() {
+  WriteOp(CaptureOp::BeginSynchronize);
+
+  if (driver_)
+    driver_->BeginSynchronize();
+}
+
+void RecordingGPUDriver::EndSynchronize() {
+  WriteOp(CaptureOp::EndSynchronize);
+
+  if (driver_)
+    driver_->EndSynchronize();
+}
+
+uint32_t RecordingGPUDriver::NextTextureId() {
+  return driver_ ? driver_->NextTextureId() : next_texture_id_++;
+}
+
+void RecordingGPUDriver::CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  WriteOp(CaptureOp::CreateTexture);
+  writer_.WriteUInt32(texture_id);
+  writer_.WriteBitmap(bitmap);
+
+  if (driver_)
+    driver_->CreateTexture(texture_id, bitmap);
+}
+
+void RecordingGPUDriver::UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  WriteOp(CaptureOp::UpdateTexture);
+  writer_.WriteUInt32(texture_id);
+  writer_.WriteBitmap(bitmap);
+
+  if (driver_)
+    driver_->UpdateTexture(texture_id, bitmap);
+}
+
+void RecordingGPUDriver::DestroyTexture(uint32_t texture_id) {
+  WriteOp(CaptureOp::DestroyTexture);
+  writer_.WriteUInt32(texture_id);
+
+  if (driver_)
+    driver_->DestroyTexture(texture_id);
+}
+
+uint32_t RecordingGPUDriver::NextRenderBufferId() {
+  return driver_ ? driver_->NextRenderBufferId() : next_render_buffer_id_++;
+}
+
+void RecordingGPUDriver::CreateRenderBuffer(uint32_t render_buffer_id,
+                                            const RenderBuffer& buffer) {
+  WriteOp(CaptureOp::CreateRenderBuffer);
+  writer_.WriteUInt32(render_buffer_id);
+  writer_.WriteRenderBuffer(buffer);
+
+  if (driver_)
+    driver_->CreateRenderBuffer(render_buffer_id, buffer);
+}
+
+void RecordingGPUDriver::DestroyRenderBuffer(uint32_t render_buffer_id) {
+  WriteOp(CaptureOp::DestroyRenderBuffer);
+  writer_.WriteUInt32(render_buffer_id);
+
+  if (driver_)
+    driver_->DestroyRenderBuffer(render_buffer_id);
+}
+
+uint32_t RecordingGPUDriver::NextGeometryId() {
+  return driver_ ? driver_->NextGeometryId() : next_geometry_id_++;
+}
+
+void RecordingGPUDriver::CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                        const IndexBuffer& indices) {
+  WriteOp(CaptureOp::CreateGeometry);
+  writer_.WriteUInt32(geometry_id);
+  writer_.WriteGeometry(vertices, indices);
+
+  if (driver_)
+    driver_->CreateGeometry(geometry_id, vertices, indices);
+}
+
+void RecordingGPUDriver::UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                        const IndexBuffer& indices) {
+  WriteOp(CaptureOp::UpdateGeometry);
+  writer_.WriteUInt32(geometry_id);
+  writer_.WriteGeometry(vertices, indices);
+
+  if (driver_)
+    driver_->UpdateGeometry(geometry_id, vertices, indices);
+}
+
+void RecordingGPUDriver::DestroyGeometry(uint32_t geometry_id) {
+  WriteOp(CaptureOp::DestroyGeometry);
+  writer_.WriteUInt32(geometry_id);
+
+  if (driver_)
+    driver_->DestroyGeometry(geometry_id);
+}
+
+void RecordingGPUDriver::UpdateCommandList(const CommandList& list) {
+  WriteOp(CaptureOp::UpdateCommandList);
+  writer_.WriteCommandList(list);
+
+  if (driver_)
+    driver_->UpdateCommandList(list);
+}
+
+void RecordingGPUDriver::WriteOp(CaptureOp op) {
+  if (!writer_.is_open())
+    return;
+
+  writer_.WriteOp(op);
+  num_calls_[(size_t)op]++;
+}
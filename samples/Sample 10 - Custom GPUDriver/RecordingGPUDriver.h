@@ -0,0 +1,66 @@
+#pragma once
+#include "GPUCapture.h"
+
+///
+/// A GPUDriver that records every call (and its payload) to a capture file before forwarding it
+/// to another driver.
+///
+/// The driver we forward to is optional, without one we hand out resource IDs ourselves and the
+/// Renderer's output is only recorded. This lets you capture accelerated rendering on machines
+/// without a GPU and profile or regression-test it later by replaying the capture (see
+/// CaptureReplayer).
+///
+/// Set this as the GPUDriver (Platform::set_gpu_driver) before creating the Renderer so the
+/// capture sees every resource from the start.
+///
+class RecordingGPUDriver : public GPUDriver {
+public:
+  RecordingGPUDriver(const std::string& path, GPUDriver* driver = nullptr);
+  virtual ~RecordingGPUDriver();
+
+  bool is_recording() const { return writer_.is_open(); }
+
+  ///
+  /// Call this after every call to Renderer::Render(), replays use it to know when a frame's
+  /// command list should be drawn.
+  ///
+  void EndFrame();
+
+  ///
+  /// Finish the capture file, later calls are only forwarded.
+  ///
+  void StopRecording();
+
+  uint32_t num_frames() const { return num_frames_; }
+  size_t num_calls(CaptureOp op) const { return num_calls_[(size_t)op]; }
+  size_t bytes_written() const { return writer_.bytes_written(); }
+
+  // Inherited from GPUDriver
+  virtual void BeginSynchronize() override;
+  virtual void EndSynchronize() override;
+  virtual uint32_t NextTextureId() override;
+  virtual void CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void DestroyTexture(uint32_t texture_id) override;
+  virtual uint32_t NextRenderBufferId() override;
+  virtual void CreateRenderBuffer(uint32_t render_buffer_id, const RenderBuffer& buffer) override;
+  virtual void DestroyRenderBuffer(uint32_t render_buffer_id) override;
+  virtual uint32_t NextGeometryId() override;
+  virtual void CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void DestroyGeometry(uint32_t geometry_id) override;
+  virtual void UpdateCommandList(const CommandList& list) override;
+
+protected:
+  void WriteOp(CaptureOp op);
+
+  GPUDriver* driver_;
+  CaptureWriter writer_;
+  uint32_t next_texture_id_ = 1;
+  uint32_t next_render_buffer_id_ = 1;
+  uint32_t next_geometry_id_ = 1;
+  uint32_t num_frames_ = 0;
+  size_t num_calls_[(size_t)CaptureOp::Count] = {};
+};
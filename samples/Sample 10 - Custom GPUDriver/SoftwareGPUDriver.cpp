@@ -0,0 +1,655 @@
+#include "SoftwareGPUDriver.h"
+#include "GPUDriverHelpers.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define TILE_SIZE 64
+
+static const uint32_t kClearBin = 0xFFFFFFFF;
+
+static float Clamp01(float value) {
+  return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// Bilinear sample with clamp-to-edge, returns premultiplied RGBA.
+static void SampleBGRA(const uint8_t* pixels, uint32_t width, uint32_t height, float u, float v,
+                       float result[4]) {
+  float x = u * width - 0.5f;
+  float y = v * height - 0.5f;
+  float fx = x - std::floor(x);
+  float fy = y - std::floor(y);
+  int x0 = std::min(std::max((int)std::floor(x), 0), (int)width - 1);
+  int y0 = std::min(std::max((int)std::floor(y), 0), (int)height - 1);
+  int x1 = std::min(x0 + 1, (int)width - 1);
+  int y1 = std::min(y0 + 1, (int)height - 1);
+  if (x < 0) x1 = x0;
+  if (y < 0) y1 = y0;
+
+  const uint8_t* p00 = pixels + ((size_t)y0 * width + x0) * 4;
+  const uint8_t* p10 = pixels + ((size_t)y0 * width + x1) * 4;
+  const uint8_t* p01 = pixels + ((size_t)y1 * width + x0) * 4;
+  const uint8_t* p11 = pixels + ((size_t)y1 * width + x1) * 4;
+
+  // BGRA -> RGBA
+  static const int kChannel[4] = { 2, 1, 0, 3 };
+  for (int c = 0; c < 4; ++c) {
+    int i = kChannel[c];
+    float top = p00[i] + (p10[i] - p00[i]) * fx;
+    float bottom = p01[i] + (p11[i] - p01[i]) * fx;
+    result[c] = (top + (bottom - top) * fy) * (1.0f / 255.0f);
+  }
+}
+
+static float SampleA8(const uint8_t* pixels, uint32_t width, uint32_t height, float u, float v) {
+  float x = u * width - 0.5f;
+  float y = v * height - 0.5f;
+  float fx = x - std::floor(x);
+  float fy = y - std::floor(y);
+  int x0 = std::min(std::max((int)std::floor(x), 0), (int)width - 1);
+  int y0 = std::min(std::max((int)std::floor(y), 0), (int)height - 1);
+  int x1 = std::min(x0 + 1, (int)width - 1);
+  int y1 = std::min(y0 + 1, (int)height - 1);
+  if (x < 0) x1 = x0;
+  if (y < 0) y1 = y0;
+
+  float p00 = pixels[(size_t)y0 * width + x0];
+  float p10 = pixels[(size_t)y0 * width + x1];
+  float p01 = pixels[(size_t)y1 * width + x0];
+  float p11 = pixels[(size_t)y1 * width + x1];
+  float top = p00 + (p10 - p00) * fx;
+  float bottom = p01 + (p11 - p01) * fx;
+  return (top + (bottom - top) * fy) * (1.0f / 255.0f);
+}
+
+///
+/// Coverage of a clip for a point in object space.
+///
+/// Each clip is a rounded rect packed into a 4x4 matrix (by column): origin and size, corner
+/// radii (x and y radius of each corner packed as two 16-bit integers per float), then an affine
+/// transform from object space into the clip's space and whether the clip is inverted.
+///
+static float ClipCoverage(const Matrix4x4& clip, float x, float y) {
+  const float* m = clip.data;
+
+  float px = x * m[8] + y * m[10] + m[12] - m[0];
+  float py = x * m[9] + y * m[11] + m[13] - m[1];
+  float width = m[2];
+  float height = m[3];
+  bool inverse = m[14] != 0.0f;
+
+  // Pick the corner whose quadrant we're in: top-left, top-right, bottom-right, bottom-left
+  int corner = px < width * 0.5f ? (py < height * 0.5f ? 0 : 3) : (py < height * 0.5f ? 1 : 2);
+  float radius_x = std::floor(m[4 + corner] / 65536.0f);
+  float radius_y = std::floor(m[4 + corner] - radius_x * 65536.0f);
+
+  // Signed distance to the rect (negative inside)
+  float dx = std::max(-px, px - width);
+  float dy = std::max(-py, py - height);
+  float distance = std::min(std::max(dx, dy), 0.0f) +
+                   std::sqrt(std::max(dx, 0.0f) * std::max(dx, 0.0f) +
+                             std::max(dy, 0.0f) * std::max(dy, 0.0f));
+
+  if (radius_x > 0.0f && radius_y > 0.0f) {
+    float center_x = corner == 0 || corner == 3 ? radius_x : width - radius_x;
+    float center_y = corner == 0 || corner == 1 ? radius_y : height - radius_y;
+    bool in_corner = (corner == 0 || corner == 3 ? px < center_x : px > center_x) &&
+                     (corner == 0 || corner == 1 ? py < center_y : py > center_y);
+    if (in_corner) {
+      // Approximate distance to the corner's ellipse
+      float ex = (px - center_x) / radius_x;
+      float ey = (py - center_y) / radius_y;
+      distance = (std::sqrt(ex * ex + ey * ey) - 1.0f) * std::min(radius_x, radius_y);
+    }
+  }
+
+  if (inverse)
+    distance = -distance;
+
+  return Clamp01(0.5f - distance);
+}
+
+SoftwareGPUDriver::SoftwareGPUDriver(uint32_t num_threads) : next_job_item_(0) {
+  if (!num_threads)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  // The calling thread does its share of the work too.
+  for (uint32_t i = 1; i < num_threads; ++i)
+    workers_.emplace_back(&SoftwareGPUDriver::WorkerMain, this);
+}
+
+SoftwareGPUDriver::~SoftwareGPUDriver() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  work_available_.notify_all();
+
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+RefPtr<Bitmap> SoftwareGPUDriver::CopyTexture(uint32_t texture_id, uint32_t width,
+                                              uint32_t height) {
+  auto i = textures_.find(texture_id);
+  if (i == textures_.end() || i->second.bpp != 4)
+    return nullptr;
+
+  const Texture& texture = i->second;
+  width = std::min(width, texture.width);
+  height = std::min(height, texture.height);
+  if (!width || !height)
+    return nullptr;
+
+  RefPtr<Bitmap> bitmap = Bitmap::Create(width, height, BitmapFormat::BGRA8_UNORM_SRGB);
+  uint8_t* pixels = (uint8_t*)bitmap->LockPixels();
+  for (uint32_t y = 0; y < height; ++y)
+    memcpy(pixels + (size_t)y * bitmap->row_bytes(),
+           texture.pixels.data() + (size_t)y * texture.width * 4, (size_t)width * 4);
+  bitmap->UnlockPixels();
+
+  return bitmap;
+}
+
+uint32_t SoftwareGPUDriver::render_buffer_texture(uint32_t render_buffer_id) const {
+  auto i = render_buffers_.find(render_buffer_id);
+  return i == render_buffers_.end() ? 0 : i->second;
+}
+
+void SoftwareGPUDriver::CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  LoadTexture(textures_[texture_id], bitmap);
+}
+
+void SoftwareGPUDriver::UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  LoadTexture(textures_[texture_id], bitmap);
+}
+
+void SoftwareGPUDriver::DestroyTexture(uint32_t texture_id) {
+  textures_.erase(texture_id);
+}
+
+void SoftwareGPUDriver::CreateRenderBuffer(uint32_t render_buffer_id,
+                                           const RenderBuffer& buffer) {
+  render_buffers_[render_buffer_id] = buffer.texture_id;
+}
+
+void SoftwareGPUDriver::DestroyRenderBuffer(uint32_t render_buffer_id) {
+  render_buffers_.erase(render_buffer_id);
+}
+
+void SoftwareGPUDriver::CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                       const IndexBuffer& indices) {
+  UpdateGeometry(geometry_id, vertices, indices);
+}
+
+void SoftwareGPUDriver::UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                       const IndexBuffer& indices) {
+  Geometry& geometry = geometry_[geometry_id];
+  geometry.format = vertices.format;
+  geometry.vertices.assign(vertices.data, vertices.data + vertices.size);
+  geometry.indices.resize(indices.size / sizeof(IndexType));
+  if (!geometry.indices.empty())
+    memcpy(geometry.indices.data(), indices.data, geometry.indices.size() * sizeof(IndexType));
+}
+
+void SoftwareGPUDriver::DestroyGeometry(uint32_t geometry_id) {
+  geometry_.erase(geometry_id);
+}
+
+void SoftwareGPUDriver::UpdateCommandList(const CommandList& list) {
+  command_list_.insert(command_list_.end(), list.commands, list.commands + list.size);
+}
+
+void SoftwareGPUDriver::DrawCommandList() {
+  ///
+  /// Split the commands into passes that each draw to a single render buffer. A pass may sample
+  /// what an earlier pass drew so passes run one after another, only tiles run in parallel.
+  ///
+  size_t begin = 0;
+  while (begin < command_list_.size()) {
+    uint32_t render_buffer_id = command_list_[begin].gpu_state.render_buffer_id;
+    size_t end = begin + 1;
+    while (end < command_list_.size() &&
+           command_list_[end].gpu_state.render_buffer_id == render_buffer_id)
+      end++;
+
+    DrawPass(begin, end);
+    begin = end;
+  }
+
+  command_list_.clear();
+}
+
+void SoftwareGPUDriver::LoadTexture(Texture& texture, RefPtr<Bitmap> bitmap) {
+  texture.width = bitmap->width();
+  texture.height = bitmap->height();
+  texture.bpp = bitmap->format() == BitmapFormat::A8_UNORM ? 1 : 4;
+
+  size_t row_bytes = (size_t)texture.width * texture.bpp;
+
+  ///
+  /// Empty bitmaps are used to create render buffer textures, these start out transparent.
+  ///
+  if (bitmap->IsEmpty()) {
+    texture.pixels.assign(row_bytes * texture.height, 0);
+    return;
+  }
+
+  texture.pixels.resize(row_bytes * texture.height);
+  const uint8_t* pixels = (const uint8_t*)bitmap->LockPixels();
+  for (uint32_t y = 0; y < texture.height; ++y)
+    memcpy(texture.pixels.data() + y * row_bytes, pixels + (size_t)y * bitmap->row_bytes(),
+           row_bytes);
+  bitmap->UnlockPixels();
+}
+
+void SoftwareGPUDriver::DrawPass(size_t begin, size_t end) {
+  uint32_t render_buffer_id = command_list_[begin].gpu_state.render_buffer_id;
+  auto texture = textures_.find(render_buffer_texture(render_buffer_id));
+  if (texture == textures_.end() || texture->second.bpp != 4)
+    return;
+
+  target_ = &texture->second;
+  last_render_buffer_id_ = render_buffer_id;
+  num_passes_++;
+
+  tiles_x_ = (target_->width + TILE_SIZE - 1) / TILE_SIZE;
+  tiles_y_ = (target_->height + TILE_SIZE - 1) / TILE_SIZE;
+  tile_bins_.resize((size_t)tiles_x_ * tiles_y_);
+  for (auto& bins : tile_bins_)
+    bins.clear();
+
+  pass_commands_.clear();
+  triangles_.clear();
+
+  ///
+  /// Resolve each command's state and bin its triangles.
+  ///
+  for (size_t i = begin; i < end; ++i) {
+    const Command& command = command_list_[i];
+    const GPUState& state = command.gpu_state;
+
+    PassCommand pass_command;
+    pass_command.command = &command;
+
+    auto texture_1 = textures_.find(state.texture_1_id);
+    pass_command.texture_1 = texture_1 == textures_.end() ? nullptr : &texture_1->second;
+
+    IntRect target_bounds = { 0, 0, (int)target_->width, (int)target_->height };
+    IntRect viewport = { 0, 0, (int)state.viewport_width, (int)state.viewport_height };
+    pass_command.bounds = IntersectRects(target_bounds, viewport);
+    if (state.enable_scissor)
+      pass_command.bounds = IntersectRects(pass_command.bounds, state.scissor_rect);
+
+    uint32_t index = (uint32_t)pass_commands_.size();
+    pass_commands_.push_back(pass_command);
+    num_commands_++;
+
+    if ((uint8_t)command.command_type == (uint8_t)CommandType::ClearRenderBuffer) {
+      for (auto& bins : tile_bins_)
+        bins.push_back({ index, kClearBin });
+    } else {
+      auto geometry = geometry_.find(command.geometry_id);
+      if (geometry != geometry_.end() && !IsEmptyRect(pass_command.bounds))
+        PrepareTriangles(index, geometry->second);
+    }
+  }
+
+  ParallelFor(tile_bins_.size(), [this](size_t i) {
+    RasterizeTile((uint32_t)(i % tiles_x_), (uint32_t)(i / tiles_x_), tile_bins_[i]);
+  });
+
+  target_ = nullptr;
+}
+
+void SoftwareGPUDriver::PrepareTriangles(uint32_t pass_command, const Geometry& geometry) {
+  const PassCommand& command = pass_commands_[pass_command];
+  const GPUState& state = command.command->gpu_state;
+  const float* m = state.transform.data;
+
+  bool is_path = geometry.format == VertexBufferFormat::_2f_4ub_2f;
+  size_t stride = is_path ? sizeof(Vertex_2f_4ub_2f) : sizeof(Vertex_2f_4ub_2f_2f_28f);
+  size_t num_vertices = geometry.vertices.size() / stride;
+
+  uint32_t first = command.command->indices_offset;
+  uint32_t last = first + command.command->indices_count;
+  if (last > geometry.indices.size())
+    last = (uint32_t)geometry.indices.size();
+
+  for (uint32_t i = first; i + 3 <= last; i += 3) {
+    Triangle triangle;
+    triangle.command = pass_command;
+    triangle.fill_type = FillType_Solid;
+
+    bool valid = true;
+    for (int v = 0; v < 3; ++v) {
+      IndexType index = geometry.indices[i + v];
+      if (index >= num_vertices) {
+        valid = false;
+        break;
+      }
+
+      const uint8_t* data = geometry.vertices.data() + index * stride;
+      const float* pos;
+      const unsigned char* color;
+      ScreenVertex& out = triangle.v[v];
+
+      if (is_path) {
+        const Vertex_2f_4ub_2f* vertex = (const Vertex_2f_4ub_2f*)data;
+        pos = vertex->pos;
+        color = vertex->color;
+        out.tex[0] = out.tex[1] = 0.0f;
+        out.obj[0] = vertex->obj[0];
+        out.obj[1] = vertex->obj[1];
+      } else {
+        const Vertex_2f_4ub_2f_2f_28f* vertex = (const Vertex_2f_4ub_2f_2f_28f*)data;
+        pos = vertex->pos;
+        color = vertex->color;
+        out.tex[0] = vertex->tex[0];
+        out.tex[1] = vertex->tex[1];
+        out.obj[0] = vertex->obj[0];
+        out.obj[1] = vertex->obj[1];
+        if (v == 0)
+          triangle.fill_type = (uint32_t)(vertex->data0[0] + 0.5f);
+      }
+
+      // Column-major transform into render buffer pixels
+      float w = pos[0] * m[3] + pos[1] * m[7] + m[15];
+      if (w == 0.0f)
+        w = 1.0f;
+      out.x = (pos[0] * m[0] + pos[1] * m[4] + m[12]) / w;
+      out.y = (pos[0] * m[1] + pos[1] * m[5] + m[13]) / w;
+
+      for (int c = 0; c < 4; ++c)
+        out.color[c] = color[c] * (1.0f / 255.0f);
+    }
+
+    if (!valid)
+      continue;
+
+    const ScreenVertex* v = triangle.v;
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+    if (std::fabs(area) < 1e-8f)
+      continue;
+
+    // Rasterization assumes a positive area, flip the winding if needed.
+    if (area < 0.0f) {
+      std::swap(triangle.v[1], triangle.v[2]);
+      area = -area;
+    }
+    triangle.inv_area = 1.0f / area;
+
+    for (int e = 0; e < 3; ++e) {
+      const ScreenVertex& a = triangle.v[(e + 1) % 3];
+      const ScreenVertex& b = triangle.v[(e + 2) % 3];
+      float edge_a = a.y - b.y;
+      float edge_b = b.x - a.x;
+      triangle.top_left[e] = edge_a > 0.0f || (edge_a == 0.0f && edge_b > 0.0f);
+    }
+
+    if (!is_path && (uint8_t)state.shader_type == (uint8_t)ShaderType::Fill &&
+        triangle.fill_type != FillType_Solid && triangle.fill_type != FillType_Image &&
+        triangle.fill_type != FillType_Glyph)
+      num_unsupported_fills_++;
+
+    ///
+    /// Bin the triangle into every tile its bounds overlap.
+    ///
+    float min_x = std::min(std::min(v[0].x, v[1].x), v[2].x);
+    float min_y = std::min(std::min(v[0].y, v[1].y), v[2].y);
+    float max_x = std::max(std::max(v[0].x, v[1].x), v[2].x);
+    float max_y = std::max(std::max(v[0].y, v[1].y), v[2].y);
+
+    IntRect bounds = { (int)std::floor(min_x), (int)std::floor(min_y),
+                       (int)std::ceil(max_x) + 1, (int)std::ceil(max_y) + 1 };
+    bounds = IntersectRects(bounds, command.bounds);
+    if (IsEmptyRect(bounds))
+      continue;
+
+    uint32_t index = (uint32_t)triangles_.size();
+    triangles_.push_back(triangle);
+    num_triangles_++;
+
+    for (int ty = bounds.top / TILE_SIZE; ty <= (bounds.bottom - 1) / TILE_SIZE; ++ty)
+      for (int tx = bounds.left / TILE_SIZE; tx <= (bounds.right - 1) / TILE_SIZE; ++tx)
+        tile_bins_[(size_t)ty * tiles_x_ + tx].push_back({ pass_command, index });
+  }
+}
+
+void SoftwareGPUDriver::RasterizeTile(uint32_t tile_x, uint32_t tile_y, std::vector<Bin>& bins) {
+  IntRect tile = { (int)(tile_x * TILE_SIZE), (int)(tile_y * TILE_SIZE),
+                   (int)std::min((tile_x + 1) * TILE_SIZE, target_->width),
+                   (int)std::min((tile_y + 1) * TILE_SIZE, target_->height) };
+
+  for (const Bin& bin : bins) {
+    const PassCommand& command = pass_commands_[bin.command];
+
+    if (bin.triangle == kClearBin) {
+      for (int y = tile.top; y < tile.bottom; ++y)
+        memset(target_->pixels.data() + ((size_t)y * target_->width + tile.left) * 4, 0,
+               (size_t)(tile.right - tile.left) * 4);
+      continue;
+    }
+
+    RasterizeTriangle(triangles_[bin.triangle], command, tile);
+  }
+}
+
+void SoftwareGPUDriver::RasterizeTriangle(const Triangle& triangle, const PassCommand& command,
+                                          const IntRect& tile) {
+  const ScreenVertex* v = triangle.v;
+
+  float min_x = std::min(std::min(v[0].x, v[1].x), v[2].x);
+  float min_y = std::min(std::min(v[0].y, v[1].y), v[2].y);
+  float max_x = std::max(std::max(v[0].x, v[1].x), v[2].x);
+  float max_y = std::max(std::max(v[0].y, v[1].y), v[2].y);
+
+  IntRect bounds = { (int)std::floor(min_x), (int)std::floor(min_y),
+                     (int)std::ceil(max_x) + 1, (int)std::ceil(max_y) + 1 };
+  bounds = IntersectRects(IntersectRects(bounds, command.bounds), tile);
+  if (IsEmptyRect(bounds))
+    return;
+
+  ///
+  /// Edge function for the edge opposite vertex 'e': w = A * x + B * y + C, positive inside.
+  ///
+  float edge_a[3], edge_b[3], edge_c[3];
+  for (int e = 0; e < 3; ++e) {
+    const ScreenVertex& a = v[(e + 1) % 3];
+    const ScreenVertex& b = v[(e + 2) % 3];
+    edge_a[e] = a.y - b.y;
+    edge_b[e] = b.x - a.x;
+    edge_c[e] = -(edge_a[e] * a.x + edge_b[e] * a.y);
+  }
+
+  for (int y = bounds.top; y < bounds.bottom; ++y) {
+    float py = y + 0.5f;
+    uint8_t* row = target_->pixels.data() + (size_t)y * target_->width * 4;
+    int x = bounds.left;
+
+#if USE_SSE2
+    ///
+    /// Test 4 pixels at a time against all three edges, pixels exactly on an edge are only
+    /// included for top and left edges so shared edges are never drawn twice.
+    ///
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    __m128 a[3], row_c[3], top_left[3];
+    for (int e = 0; e < 3; ++e) {
+      a[e] = _mm_set1_ps(edge_a[e]);
+      row_c[e] = _mm_set1_ps(edge_b[e] * py + edge_c[e]);
+      top_left[e] = _mm_castsi128_ps(_mm_set1_epi32(triangle.top_left[e] ? -1 : 0));
+    }
+
+    for (; x + 4 <= bounds.right; x += 4) {
+      __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+      __m128 w[3];
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int e = 0; e < 3; ++e) {
+        w[e] = _mm_add_ps(_mm_mul_ps(a[e], px), row_c[e]);
+        __m128 edge_inside = _mm_or_ps(_mm_cmpgt_ps(w[e], zero),
+                                       _mm_and_ps(_mm_cmpeq_ps(w[e], zero), top_left[e]));
+        inside = _mm_and_ps(inside, edge_inside);
+      }
+
+      int mask = _mm_movemask_ps(inside);
+      if (!mask)
+        continue;
+
+      float w0[4], w1[4], w2[4];
+      _mm_storeu_ps(w0, w[0]);
+      _mm_storeu_ps(w1, w[1]);
+      _mm_storeu_ps(w2, w[2]);
+      for (int lane = 0; lane < 4; ++lane) {
+        if (mask & (1 << lane))
+          ShadePixel(triangle, command, w0[lane], w1[lane], w2[lane], row + (x + lane) * 4);
+      }
+    }
+#endif
+
+    for (; x < bounds.right; ++x) {
+      float px = x + 0.5f;
+      float w[3];
+      bool inside = true;
+      for (int e = 0; e < 3 && inside; ++e) {
+        w[e] = edge_a[e] * px + edge_b[e] * py + edge_c[e];
+        inside = w[e] > 0.0f || (w[e] == 0.0f && triangle.top_left[e]);
+      }
+
+      if (inside)
+        ShadePixel(triangle, command, w[0], w[1], w[2], row + x * 4);
+    }
+  }
+}
+
+void SoftwareGPUDriver::ShadePixel(const Triangle& triangle, const PassCommand& command,
+                                   float w0, float w1, float w2, uint8_t* dest) {
+  const ScreenVertex* v = triangle.v;
+  const GPUState& state = command.command->gpu_state;
+
+  float b0 = w0 * triangle.inv_area;
+  float b1 = w1 * triangle.inv_area;
+  float b2 = w2 * triangle.inv_area;
+
+  float color[4];
+  for (int c = 0; c < 4; ++c)
+    color[c] = v[0].color[c] * b0 + v[1].color[c] * b1 + v[2].color[c] * b2;
+
+  ///
+  /// Fill shader: the fill type decides how the vertex color is combined with texture 1.
+  /// (The FillPath shader only uses the vertex color.)
+  ///
+  const Texture* texture = command.texture_1;
+  if ((uint8_t)state.shader_type == (uint8_t)ShaderType::Fill && texture &&
+      (triangle.fill_type == FillType_Image || triangle.fill_type == FillType_Glyph)) {
+    float u = v[0].tex[0] * b0 + v[1].tex[0] * b1 + v[2].tex[0] * b2;
+    float t = v[0].tex[1] * b0 + v[1].tex[1] * b1 + v[2].tex[1] * b2;
+
+    if (texture->bpp == 1) {
+      float coverage = SampleA8(texture->pixels.data(), texture->width, texture->height, u, t);
+      for (int c = 0; c < 4; ++c)
+        color[c] *= coverage;
+    } else {
+      float texel[4];
+      SampleBGRA(texture->pixels.data(), texture->width, texture->height, u, t, texel);
+      for (int c = 0; c < 4; ++c)
+        color[c] *= texel[c];
+    }
+  }
+
+  if (state.clip_size) {
+    float obj_x = v[0].obj[0] * b0 + v[1].obj[0] * b1 + v[2].obj[0] * b2;
+    float obj_y = v[0].obj[1] * b0 + v[1].obj[1] * b1 + v[2].obj[1] * b2;
+
+    float coverage = 1.0f;
+    for (uint8_t i = 0; i < state.clip_size && i < 8; ++i)
+      coverage *= ClipCoverage(state.clip[i], obj_x, obj_y);
+
+    for (int c = 0; c < 4; ++c)
+      color[c] *= coverage;
+  }
+
+  ///
+  /// Premultiplied "source over" (what the GPU renderer sets up as its blend state):
+  ///   rgb = src.rgb + dst.rgb * (1 - src.a), a = src.a * (1 - dst.a) + dst.a
+  ///
+  float r = Clamp01(color[0]), g = Clamp01(color[1]), b = Clamp01(color[2]);
+  float a = Clamp01(color[3]);
+
+  if (state.enable_blend) {
+    float dst_r = dest[2] * (1.0f / 255.0f);
+    float dst_g = dest[1] * (1.0f / 255.0f);
+    float dst_b = dest[0] * (1.0f / 255.0f);
+    float dst_a = dest[3] * (1.0f / 255.0f);
+    r = r + dst_r * (1.0f - a);
+    g = g + dst_g * (1.0f - a);
+    b = b + dst_b * (1.0f - a);
+    a = a * (1.0f - dst_a) + dst_a;
+  }
+
+  dest[0] = (uint8_t)(Clamp01(b) * 255.0f + 0.5f);
+  dest[1] = (uint8_t)(Clamp01(g) * 255.0f + 0.5f);
+  dest[2] = (uint8_t)(Clamp01(r) * 255.0f + 0.5f);
+  dest[3] = (uint8_t)(Clamp01(a) * 255.0f + 0.5f);
+}
+
+void SoftwareGPUDriver::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+  if (workers_.empty() || count <= 1) {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &fn;
+    job_size_ = count;
+    next_job_item_ = 0;
+    busy_workers_ = workers_.size();
+    job_generation_++;
+  }
+  work_available_.notify_all();
+
+  RunParallelItems();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+  job_ = nullptr;
+}
+
+void SoftwareGPUDriver::WorkerMain() {
+  uint64_t generation = 0;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock, [&] { return quit_ || job_generation_ != generation; });
+      if (quit_)
+        return;
+      generation = job_generation_;
+    }
+
+    RunParallelItems();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_workers_ == 0)
+        work_done_.notify_one();
+    }
+  }
+}
+
+void SoftwareGPUDriver::RunParallelItems() {
+  for (;;) {
+    size_t i = next_job_item_++;
+    if (i >= job_size_)
+      return;
+
+    (*job_)(i);
+  }
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <Ultralight/platform/GPUDriver.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ultralight;
+
+///
+/// A GPUDriver that executes command lists on the CPU.
+///
+/// This is meant as a reference for accelerated rendering on machines without a GPU (and a
+/// throughput baseline for real drivers), not as a fast path-- use the CPU renderer
+/// (ViewConfig::is_accelerated = false) if you just want pixels without a GPU.
+///
+/// Each call to DrawCommandList() splits the pending commands into passes (runs of commands that
+/// draw to the same render buffer), bins every triangle of a pass into 64x64 pixel tiles, then
+/// rasterizes the tiles in parallel. Tiles only ever run their own bins, in command order, so
+/// blending is identical no matter how many threads are used.
+///
+/// Render buffers and textures are stored as premultiplied BGRA (or A8), blending matches the
+/// GPU renderer's (premultiplied "source over"). Supported: both shaders (Fill and FillPath),
+/// rounded-rect clips, scissor, and render buffer textures. Of the Fill shader's fill types only
+/// solid, image and glyph fills are implemented, others are drawn with their vertex color and
+/// counted in num_unsupported_fills().
+///
+class SoftwareGPUDriver : public GPUDriver {
+public:
+  // 'num_threads' of 0 uses one thread per core.
+  SoftwareGPUDriver(uint32_t num_threads = 0);
+  virtual ~SoftwareGPUDriver();
+
+  bool HasCommandsPending() const { return !command_list_.empty(); }
+
+  ///
+  /// Execute (and clear) all commands received via UpdateCommandList().
+  ///
+  void DrawCommandList();
+
+  ///
+  /// Copy the top-left 'width' x 'height' pixels of a texture (eg, a View's render target) into
+  /// a new BGRA Bitmap. Returns null if the texture doesn't exist.
+  ///
+  RefPtr<Bitmap> CopyTexture(uint32_t texture_id, uint32_t width, uint32_t height);
+
+  // Texture backing a render buffer (0 if there is no such render buffer).
+  uint32_t render_buffer_texture(uint32_t render_buffer_id) const;
+
+  // The render buffer the most recent draw went to.
+  uint32_t last_render_buffer_id() const { return last_render_buffer_id_; }
+
+  uint32_t num_threads() const { return (uint32_t)workers_.size() + 1; }
+  uint64_t num_commands() const { return num_commands_; }
+  uint64_t num_triangles() const { return num_triangles_; }
+  uint64_t num_passes() const { return num_passes_; }
+  uint64_t num_unsupported_fills() const { return num_unsupported_fills_; }
+
+  // Inherited from GPUDriver
+  virtual void BeginSynchronize() override {}
+  virtual void EndSynchronize() override {}
+  virtual uint32_t NextTextureId() override { return next_texture_id_++; }
+  virtual void CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void DestroyTexture(uint32_t texture_id) override;
+  virtual uint32_t NextRenderBufferId() override { return next_render_buffer_id_++; }
+  virtual void CreateRenderBuffer(uint32_t render_buffer_id, const RenderBuffer& buffer) override;
+  virtual void DestroyRenderBuffer(uint32_t render_buffer_id) override;
+  virtual uint32_t NextGeometryId() override { return next_geometry_id_++; }
+  virtual void CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void DestroyGeometry(uint32_t geometry_id) override;
+  virtual void UpdateCommandList(const CommandList& list) override;
+
+protected:
+  struct Texture {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t bpp = 4;               // 4 = premultiplied BGRA, 1 = A8
+    std::vector<uint8_t> pixels;    // Tightly-packed rows
+  };
+
+  struct Geometry {
+    VertexBufferFormat format;
+    std::vector<uint8_t> vertices;
+    std::vector<IndexType> indices;
+  };
+
+  // A vertex after transformation to render buffer pixels, with the attributes we interpolate.
+  struct ScreenVertex {
+    float x, y;
+    float color[4];   // Premultiplied RGBA
+    float tex[2];
+    float obj[2];
+  };
+
+  struct Triangle {
+    ScreenVertex v[3];
+    float inv_area;
+    bool top_left[3];   // Whether the edge opposite each vertex is a top or left edge
+    uint32_t command;   // Index into the current pass
+    uint32_t fill_type; // Only used by the Fill shader
+  };
+
+  // A command in the current pass along with everything we resolved for it up front.
+  struct PassCommand {
+    const Command* command;
+    const Texture* texture_1;
+    IntRect bounds;     // Viewport, scissor and render buffer intersected
+  };
+
+  // One item in a tile's bin: a triangle, or a clear (triangle == kClearBin).
+  struct Bin {
+    uint32_t command;
+    uint32_t triangle;
+  };
+
+  void LoadTexture(Texture& texture, RefPtr<Bitmap> bitmap);
+  void DrawPass(size_t begin, size_t end);
+  void PrepareTriangles(uint32_t pass_command, const Geometry& geometry);
+  void RasterizeTile(uint32_t tile_x, uint32_t tile_y, std::vector<Bin>& bins);
+  void RasterizeTriangle(const Triangle& triangle, const PassCommand& command,
+                         const IntRect& tile);
+  void ShadePixel(const Triangle& triangle, const PassCommand& command, float w0, float w1,
+                  float w2, uint8_t* dest);
+
+  ///
+  /// Runs 'fn(0..count-1)' across our worker threads (and the calling thread) and waits for it.
+  ///
+  void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+  void WorkerMain();
+  void RunParallelItems();
+
+  uint32_t next_texture_id_ = 1;
+  uint32_t next_render_buffer_id_ = 1;
+  uint32_t next_geometry_id_ = 1;
+  std::map<uint32_t, Texture> textures_;
+  std::map<uint32_t, uint32_t> render_buffers_;   // Render buffer ID -> texture ID
+  std::map<uint32_t, Geometry> geometry_;
+  std::vector<Command> command_list_;
+  uint32_t last_render_buffer_id_ = 0;
+
+  // State for the pass being drawn
+  Texture* target_ = nullptr;
+  std::vector<PassCommand> pass_commands_;
+  std::vector<Triangle> triangles_;
+  std::vector<std::vector<Bin>> tile_bins_;
+  uint32_t tiles_x_ = 0;
+  uint32_t tiles_y_ = 0;
+
+  uint64_t num_commands_ = 0;
+  uint64_t num_triangles_ = 0;
+  uint64_t num_passes_ = 0;
+  uint64_t num_unsupported_fills_ = 0;
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  const std::function<void(size_t)>* job_ = nullptr;
+  size_t job_size_ = 0;
+  std::atomic<size_t> next_job_item_;
+  uint64_t job_generation_ = 0;
+  size_t busy_workers_ = 0;
+  bool quit_ = false;
+};
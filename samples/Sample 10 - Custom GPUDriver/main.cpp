@@ -0,0 +1,428 @@
+#include <Ultralight/Ultralight.h>
+#include <AppCore/AppCore.h>
+#include "CaptureReplayer.h"
+#include "OptimizingGPUDriver.h"
+#include "RecordingGPUDriver.h"
+#include "SoftwareGPUDriver.h"
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace ultralight;
+
+///
+/// Number of frames to keep recording after the page has loaded (so CSS animations and
+/// transitions end up in the capture too).
+///
+#define FRAMES_AFTER_LOAD 60
+
+///
+/// Give up if the page hasn't loaded after this many seconds.
+///
+#define LOAD_TIMEOUT_SECONDS 30
+
+///
+///  Welcome to Sample 10!
+///
+///  In this sample we'll provide our own GPUDriver and use it to record everything the GPU
+///  renderer asks a driver to do, then replay that recording later without a Renderer.
+///
+///  Usage:
+///
+///    Sample10 record [capture.ulgpu] [url]     Render a page with an accelerated View and
+///                                              write every GPUDriver call to a capture file.
+///
+///    Sample10 replay [capture.ulgpu] [out.png] Re-issue the calls in a capture file against
+///                                              our software GPUDriver and save the last frame.
+///
+///    Sample10 render [out.png] [url]           Render a page with an accelerated View using our
+///                                              software GPUDriver and save the result.
+///
+///    Sample10 optimize [capture.ulgpu]         Replay a capture with and without our
+///                                              OptimizingGPUDriver in between, check both give
+///                                              the same pixels and print what it saved.
+///
+///  Captures let you profile and regression-test accelerated rendering offline: record once on
+///  any machine (no GPU needed, we don't draw anything while recording), then replay the exact
+///  same stream of textures, geometry and command lists against the driver you're working on.
+///
+///  SoftwareGPUDriver executes command lists on the CPU, which lets us check accelerated
+///  rendering (and compare a real driver's output against it) on machines without a GPU.
+///
+class MyApp : public LoadListener,
+              public Logger {
+  std::unique_ptr<RecordingGPUDriver> gpu_driver_;
+  RefPtr<Renderer> renderer_;
+  RefPtr<View> view_;
+  bool done_ = false;
+  bool failed_ = false;
+public:
+  MyApp() {}
+
+  virtual ~MyApp() {
+    view_ = nullptr;
+    renderer_ = nullptr;
+  }
+
+  ///
+  /// Set up the Platform and Renderer to use 'gpu_driver' and load 'url' into an accelerated
+  /// View. Call RenderFrames() afterwards.
+  ///
+  void CreateAcceleratedView(GPUDriver* gpu_driver, const std::string& url) {
+    Config config;
+    Platform::instance().set_config(config);
+    Platform::instance().set_font_loader(GetPlatformFontLoader());
+    Platform::instance().set_file_system(GetPlatformFileSystem("./assets/"));
+    Platform::instance().set_logger(this);
+
+    ///
+    /// Register our GPUDriver with the Platform singleton, it's used by all accelerated Views.
+    ///
+    Platform::instance().set_gpu_driver(gpu_driver);
+
+    renderer_ = Renderer::Create();
+
+    ///
+    /// Accelerated Views are rendered with the GPUDriver instead of to a Surface.
+    ///
+    ViewConfig view_config;
+    view_config.is_accelerated = true;
+
+    view_ = renderer_->CreateView(1280, 720, view_config, nullptr);
+    view_->set_load_listener(this);
+    view_->LoadURL(url.c_str());
+  }
+
+  ///
+  /// Render until the page has loaded, then keep going for a bit. 'on_frame' is called after
+  /// every call to Renderer::Render(), which is where an app would draw the command list its
+  /// GPUDriver received.
+  ///
+  /// Returns false if the page failed to load or didn't load within LOAD_TIMEOUT_SECONDS.
+  ///
+  bool RenderFrames(std::function<void()> on_frame) {
+    auto start = std::chrono::steady_clock::now();
+    int frames_after_load = 0;
+    while (frames_after_load < FRAMES_AFTER_LOAD) {
+      renderer_->Update();
+      renderer_->Render();
+      on_frame();
+
+      if (failed_)
+        return false;
+
+      if (done_) {
+        frames_after_load++;
+      } else if (std::chrono::steady_clock::now() - start >
+                 std::chrono::seconds(LOAD_TIMEOUT_SECONDS)) {
+        LogMessage(LogLevel::Error, "Timed out waiting for our page to load.");
+        return false;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+
+    return true;
+  }
+
+  bool Record(const std::string& capture_path, const std::string& url) {
+    ///
+    /// Create our GPUDriver before anything else, it should see every resource the Renderer
+    /// creates.
+    ///
+    /// We don't pass another driver to forward to, so we only record (RecordingGPUDriver hands
+    /// out resource IDs itself).
+    ///
+    gpu_driver_.reset(new RecordingGPUDriver(capture_path));
+    if (!gpu_driver_->is_recording()) {
+      LogMessage(LogLevel::Error, ("Could not open " + capture_path).c_str());
+      return false;
+    }
+
+    CreateAcceleratedView(gpu_driver_.get(), url);
+
+    LogMessage(LogLevel::Info, "Recording, waiting for page to load...");
+
+    ///
+    /// Render as we wait so the capture includes the page loading in. Every call to
+    /// Renderer::Render() is one frame in the capture.
+    ///
+    bool loaded = RenderFrames([this]() { gpu_driver_->EndFrame(); });
+
+    ///
+    /// Destroy our View and Renderer while still recording so the capture also shows every
+    /// resource being released.
+    ///
+    view_ = nullptr;
+    renderer_ = nullptr;
+    gpu_driver_->StopRecording();
+
+    if (!loaded)
+      return false;
+
+    std::cout << "Recorded " << gpu_driver_->num_frames() << " frames ("
+              << gpu_driver_->bytes_written() << " bytes) to " << capture_path << std::endl;
+    for (size_t op = 0; op < (size_t)CaptureOp::Count; ++op) {
+      if (gpu_driver_->num_calls((CaptureOp)op))
+        std::cout << "  " << CaptureOpName((CaptureOp)op) << ": "
+                  << gpu_driver_->num_calls((CaptureOp)op) << std::endl;
+    }
+
+    return true;
+  }
+
+  ///
+  /// Replay a capture into 'replayer' (which forwards to 'driver', possibly through another
+  /// GPUDriver), drawing each frame's command list when the capture says the frame ended.
+  /// 'last_frame' receives a copy of the last render buffer that was drawn to (the capture
+  /// destroys everything at the end).
+  ///
+  bool ReplayCapture(CaptureReplayer& replayer, const std::string& capture_path,
+                     SoftwareGPUDriver& driver, double& draw_ms, RefPtr<Bitmap>& last_frame) {
+    draw_ms = 0;
+    bool result = replayer.Replay(capture_path, [&](uint32_t frame) {
+      if (!driver.HasCommandsPending())
+        return;
+
+      auto start = std::chrono::steady_clock::now();
+      driver.DrawCommandList();
+      draw_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+      last_frame = driver.CopyTexture(
+        driver.render_buffer_texture(driver.last_render_buffer_id()), 0xFFFFFFFF, 0xFFFFFFFF);
+    });
+
+    if (!result)
+      LogMessage(LogLevel::Error, ("Could not replay " + capture_path).c_str());
+
+    return result;
+  }
+
+  bool Replay(const std::string& capture_path, const std::string& png_path) {
+    SoftwareGPUDriver driver;
+    CaptureReplayer replayer(&driver);
+
+    double draw_ms;
+    RefPtr<Bitmap> last_frame;
+    if (!ReplayCapture(replayer, capture_path, driver, draw_ms, last_frame))
+      return false;
+
+    std::cout << "Replayed " << replayer.num_frames() << " frames ("
+              << replayer.num_commands() << " commands)" << std::endl;
+    for (size_t op = 0; op < (size_t)CaptureOp::Count; ++op) {
+      if (replayer.num_calls((CaptureOp)op))
+        std::cout << "  " << CaptureOpName((CaptureOp)op) << ": "
+                  << replayer.num_calls((CaptureOp)op) << std::endl;
+    }
+    PrintDriverStats(driver, draw_ms);
+
+    if (last_frame && last_frame->WritePNG(png_path.c_str()))
+      std::cout << "Saved the last frame to " << png_path << std::endl;
+
+    return true;
+  }
+
+  bool Optimize(const std::string& capture_path) {
+    ///
+    /// Replay the capture as recorded first, to have something to compare against.
+    ///
+    SoftwareGPUDriver reference_driver;
+    CaptureReplayer reference_replayer(&reference_driver);
+    double reference_ms;
+    RefPtr<Bitmap> reference_frame;
+    if (!ReplayCapture(reference_replayer, capture_path, reference_driver, reference_ms,
+                       reference_frame))
+      return false;
+
+    ///
+    /// Then replay it again with every command list going through OptimizingGPUDriver.
+    ///
+    SoftwareGPUDriver driver;
+    OptimizingGPUDriver optimizer(&driver);
+    CaptureReplayer replayer(&optimizer);
+    double draw_ms;
+    RefPtr<Bitmap> last_frame;
+    if (!ReplayCapture(replayer, capture_path, driver, draw_ms, last_frame))
+      return false;
+
+    std::cout << "Replayed " << replayer.num_frames() << " frames through OptimizingGPUDriver"
+              << std::endl
+              << "  Commands: " << optimizer.commands_in() << " in, "
+              << optimizer.commands_out() << " out" << std::endl
+              << "  Dropped (nothing visible): " << optimizer.num_dropped() << std::endl
+              << "  Culled (hidden by later draws): " << optimizer.num_culled() << std::endl
+              << "  Reordered: " << optimizer.num_reordered() << std::endl
+              << "  Merged: " << optimizer.num_merged() << std::endl
+              << "  CPU time: " << optimizer.cpu_time() << " ms" << std::endl;
+
+    std::cout << "Without optimizing: ";
+    PrintDriverStats(reference_driver, reference_ms);
+    std::cout << "With optimizing:    ";
+    PrintDriverStats(driver, draw_ms);
+
+    ///
+    /// Every pass is meant to leave the pixels exactly as they were.
+    ///
+    if (!reference_frame || !last_frame) {
+      std::cout << "Nothing was drawn, no frames to compare" << std::endl;
+      return true;
+    }
+
+    if (reference_frame->width() != last_frame->width() ||
+        reference_frame->height() != last_frame->height()) {
+      LogMessage(LogLevel::Error, "The last frames have different sizes");
+      return false;
+    }
+
+    const uint8_t* expected = (const uint8_t*)reference_frame->LockPixels();
+    const uint8_t* actual = (const uint8_t*)last_frame->LockPixels();
+    size_t num_different = 0;
+    for (uint32_t y = 0; y < last_frame->height(); ++y) {
+      const uint8_t* a = expected + (size_t)y * reference_frame->row_bytes();
+      const uint8_t* b = actual + (size_t)y * last_frame->row_bytes();
+      for (uint32_t x = 0; x < last_frame->width(); ++x)
+        if (memcmp(a + x * 4, b + x * 4, 4))
+          num_different++;
+    }
+    reference_frame->UnlockPixels();
+    last_frame->UnlockPixels();
+
+    if (num_different) {
+      std::cout << num_different << " pixels of the last frame differ!" << std::endl;
+      return false;
+    }
+
+    std::cout << "The last frame is identical with and without optimizing" << std::endl;
+    return true;
+  }
+
+  bool Render(const std::string& png_path, const std::string& url) {
+    SoftwareGPUDriver driver;
+    CreateAcceleratedView(&driver, url);
+
+    bool result = RenderToPNG(driver, png_path);
+
+    ///
+    /// Release our View and Renderer before the driver they use goes away, whether we succeeded
+    /// or not.
+    ///
+    view_ = nullptr;
+    renderer_ = nullptr;
+    return result;
+  }
+
+  bool RenderToPNG(SoftwareGPUDriver& driver, const std::string& png_path) {
+    LogMessage(LogLevel::Info, "Rendering with the software GPUDriver...");
+
+    double draw_ms = 0;
+    bool loaded = RenderFrames([&]() {
+      auto start = std::chrono::steady_clock::now();
+      driver.DrawCommandList();
+      draw_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    });
+
+    if (!loaded)
+      return false;
+
+    ///
+    /// An accelerated View renders to a texture that may be larger than the View itself, only
+    /// save the part the View uses.
+    ///
+    RenderTarget target = view_->render_target();
+    RefPtr<Bitmap> bitmap = driver.CopyTexture(target.texture_id, target.width, target.height);
+
+    PrintDriverStats(driver, draw_ms);
+
+    if (!bitmap || !bitmap->WritePNG(png_path.c_str())) {
+      LogMessage(LogLevel::Error, ("Could not write " + png_path).c_str());
+      return false;
+    }
+
+    std::cout << "Saved a render of our page to " << png_path << std::endl;
+    return true;
+  }
+
+  void PrintDriverStats(const SoftwareGPUDriver& driver, double draw_ms) {
+    std::cout << "Software GPUDriver (" << driver.num_threads() << " threads): "
+              << driver.num_commands() << " commands, " << driver.num_triangles()
+              << " triangles, " << driver.num_passes() << " passes in " << draw_ms << " ms";
+    if (draw_ms > 0)
+      std::cout << " (" << (uint64_t)(driver.num_triangles() / (draw_ms / 1000.0))
+                << " triangles/s)";
+    std::cout << std::endl;
+
+    if (driver.num_unsupported_fills())
+      std::cout << "  " << driver.num_unsupported_fills()
+                << " triangles used fill types we don't implement (drawn as solid fills)"
+                << std::endl;
+  }
+
+  ///
+  /// Inherited from LoadListener, this is called when a View finishes loading a page into a frame.
+  ///
+  virtual void OnFinishLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                               const String& url) override {
+    if (is_main_frame) {
+      LogMessage(LogLevel::Info, "Our page has loaded!");
+      done_ = true;
+    }
+  }
+
+  ///
+  /// Inherited from LoadListener, this is called when a View fails to load a page into a frame.
+  ///
+  virtual void OnFailLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                             const String& url, const String& description,
+                             const String& error_domain, int error_code) override {
+    if (is_main_frame) {
+      LogMessage(LogLevel::Error, (std::string("Could not load ") + url.utf8().data() + ": " +
+                                   description.utf8().data()).c_str());
+      failed_ = true;
+    }
+  }
+
+  ///
+  /// Inherited from Logger, this is called when the library wants to print a message to the log.
+  ///
+  virtual void LogMessage(LogLevel log_level, const String& message) override {
+    std::cout << "> " << message.utf8().data() << std::endl << std::endl;
+  }
+};
+
+int main(int argc, char* argv[]) {
+  const char* mode = argc > 1 ? argv[1] : "record";
+  std::string capture_path = argc > 2 ? argv[2] : "capture.ulgpu";
+
+  MyApp app;
+
+  if (!strcmp(mode, "record")) {
+    std::string url = argc > 3 ? argv[3] : "file:///page.html";
+    return app.Record(capture_path, url) ? 0 : 1;
+  }
+
+  if (!strcmp(mode, "replay")) {
+    std::string png_path = argc > 3 ? argv[3] : "replay.png";
+    return app.Replay(capture_path, png_path) ? 0 : 1;
+  }
+
+  if (!strcmp(mode, "render")) {
+    std::string png_path = argc > 2 ? argv[2] : "result.png";
+    std::string url = argc > 3 ? argv[3] : "file:///page.html";
+    return app.Render(png_path, url) ? 0 : 1;
+  }
+
+  if (!strcmp(mode, "optimize"))
+    return app.Optimize(capture_path) ? 0 : 1;
+
+  std::cerr << "Usage: Sample10 record [capture.ulgpu] [url]" << std::endl
+            << "       Sample10 replay [capture.ulgpu] [out.png]" << std::endl
+            << "       Sample10 render [out.png] [url]" << std::endl
+            << "       Sample10 optimize [capture.ulgpu]" << std::endl;
+  return 1;
+}
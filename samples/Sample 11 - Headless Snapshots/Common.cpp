@@ -0,0 +1,56 @@
+#include "Common.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+///
+/// How long to sleep between Renderer updates while waiting for loads, short enough not to slow
+/// down the page loads we time.
+///
+#define LOAD_POLL_INTERVAL_US 100
+
+void SetupPlatform(const Config& config, Logger* logger, const std::string& file_system_path) {
+  Platform::instance().set_config(config);
+  Platform::instance().set_font_loader(GetPlatformFontLoader());
+  Platform::instance().set_file_system(GetPlatformFileSystem(file_system_path.c_str()));
+  if (logger)
+    Platform::instance().set_logger(logger);
+}
+
+void LoadCounter::OnFinishLoading(ultralight::View* caller, uint64_t frame_id,
+                                  bool is_main_frame, const String& url) {
+  if (is_main_frame)
+    num_finished++;
+}
+
+void LoadCounter::OnFailLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                                const String& url, const String& description,
+                                const String& error_domain, int error_code) {
+  if (is_main_frame) {
+    num_finished++;
+    num_failed++;
+  }
+}
+
+bool WaitForLoads(Renderer* renderer, LoadCounter& counter, uint32_t target) {
+  uint32_t num_failed = counter.num_failed;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(LOAD_TIMEOUT_SECONDS);
+
+  while (counter.num_finished < target) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      std::cerr << "Timed out after " << LOAD_TIMEOUT_SECONDS << " s waiting for "
+                << target - counter.num_finished << " page loads" << std::endl;
+      return false;
+    }
+
+    renderer->Update();
+    std::this_thread::sleep_for(std::chrono::microseconds(LOAD_POLL_INTERVAL_US));
+  }
+
+  if (counter.num_failed > num_failed) {
+    std::cerr << counter.num_failed - num_failed << " page loads failed" << std::endl;
+    return false;
+  }
+
+  return true;
+}
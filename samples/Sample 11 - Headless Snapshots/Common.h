@@ -0,0 +1,46 @@
+#pragma once
+#include <AppCore/AppCore.h>
+#include <cstdint>
+#include <string>
+
+using namespace ultralight;
+
+///
+/// Give up on page loads that haven't finished after this many seconds.
+///
+#define LOAD_TIMEOUT_SECONDS 30
+
+///
+/// Set up the Platform handlers every Renderer in this sample uses: 'config', the platform's font
+/// loader, a file system serving file:/// from 'file_system_path' (our ./assets/ unless given)
+/// and, if given, 'logger'.
+///
+/// Platform handlers are process-wide, call this once per process before creating the Renderer.
+///
+void SetupPlatform(const Config& config = Config(), Logger* logger = nullptr,
+                   const std::string& file_system_path = "./assets/");
+
+///
+/// Counts the main frame loads (finished or failed) of the Views it's attached to.
+///
+class LoadCounter : public LoadListener {
+public:
+  virtual void OnFinishLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                               const String& url) override;
+
+  virtual void OnFailLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                             const String& url, const String& description,
+                             const String& error_domain, int error_code) override;
+
+  uint32_t num_finished = 0;
+  uint32_t num_failed = 0;
+};
+
+///
+/// Update 'renderer' until 'counter' has seen 'target' loads finish (or fail), sleeping briefly
+/// between updates.
+///
+/// Returns false, after printing why, if any of those loads failed or they didn't all finish
+/// within LOAD_TIMEOUT_SECONDS.
+///
+bool WaitForLoads(Renderer* renderer, LoadCounter& counter, uint32_t target);
@@ -0,0 +1,237 @@
+#include "ImageBenchmark.h"
+#include "Common.h"
+#include "PNGStreamWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+///
+/// Size of the images in the eager and staged pages, and the size every image is drawn at.
+///
+#define IMAGE_WIDTH 512
+#define IMAGE_HEIGHT 384
+#define DISPLAY_WIDTH 80
+#define DISPLAY_HEIGHT 60
+
+///
+/// Real images the staged page swaps in per frame.
+///
+#define IMAGE_BENCHMARK_BATCH 4
+
+#define FRAME_BUDGET_MS (1000.0 / 60.0)
+
+///
+/// Give up if the images haven't all been painted after this many milliseconds.
+///
+#define IMAGE_BENCHMARK_TIMEOUT_MS 60000
+
+static const char* kModes[] = { "eager", "staged", "display-size" };
+
+///
+/// Counts the images that haven't loaded yet, and for the staged page swaps in the next ones.
+///
+static const char* kImageBenchScript = R"JS(
+window.__imageBench = {
+  release: function(count) {
+    var images = document.querySelectorAll("img[data-src]");
+    for (var i = 0; i < images.length && i < count; i++) {
+      images[i].src = images[i].getAttribute("data-src");
+      images[i].removeAttribute("data-src");
+    }
+  },
+  pending: function() {
+    if (document.readyState == "loading")
+      return -1;
+
+    var pending = 0;
+    for (var i = 0; i < document.images.length; i++) {
+      var image = document.images[i];
+      if (image.hasAttribute("data-src") || !image.complete)
+        pending++;
+    }
+    return pending;
+  }
+};
+)JS";
+
+static std::string ImageName(bool display_size, uint32_t index) {
+  return std::string("image-bench-") + (display_size ? "small-" : "full-") +
+         std::to_string(index) + ".png";
+}
+
+static std::string PageName(const std::string& mode) {
+  return "image-bench-" + mode + ".html";
+}
+
+static std::string CreateTempDirectory() {
+#ifdef _WIN32
+  const char* temp = std::getenv("TEMP");
+  std::string path = std::string(temp ? temp : ".") + "\\image-bench-" +
+                     std::to_string(_getpid());
+  return _mkdir(path.c_str()) == 0 ? path : std::string();
+#else
+  const char* temp = std::getenv("TMPDIR");
+  std::string path = std::string(temp && *temp ? temp : "/tmp") + "/image-bench-XXXXXX";
+  std::vector<char> buffer(path.begin(), path.end());
+  buffer.push_back(0);
+  return mkdtemp(buffer.data()) ? std::string(buffer.data()) : std::string();
+#endif
+}
+
+///
+/// Gradients and a pattern that differ per image, so no two files are the same, under a fine
+/// grain so the PNGs don't compress much better than photos would.
+///
+static bool WriteImage(const std::string& path, uint32_t width, uint32_t height, uint32_t seed) {
+  PNGStreamWriter writer;
+  if (!writer.Open(path, width, height))
+    return false;
+
+  std::vector<uint8_t> row(width * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint8_t* pixel = &row[x * 4];
+      uint32_t grain = (x * 73856093u) ^ (y * 19349663u) ^ (seed * 83492791u);
+      grain = (grain ^ (grain >> 13)) * 0x5bd1e995u;
+      pixel[0] = (uint8_t)(x * 255 / width + seed * 37 + (grain & 3));
+      pixel[1] = (uint8_t)(y * 255 / height + seed * 11 + ((grain >> 8) & 3));
+      pixel[2] = (uint8_t)((x ^ y) + seed * 5 + ((grain >> 16) & 3));
+      pixel[3] = 255;
+    }
+    if (!writer.WriteRow(row.data()))
+      return false;
+  }
+
+  return writer.Close();
+}
+
+static bool WritePage(const std::string& directory, const std::string& mode,
+                      uint32_t num_images) {
+  std::ofstream page(directory + "/" + PageName(mode));
+  page << "<!DOCTYPE html>\n<html><head><style>\n"
+       << "body { margin: 0; padding: 2px; display: flex; flex-wrap: wrap; }\n"
+       << "img { width: " << DISPLAY_WIDTH << "px; height: " << DISPLAY_HEIGHT
+       << "px; margin: 2px; background: #ddd; }\n"
+       << "</style><script>" << kImageBenchScript << "</script></head><body>\n";
+
+  for (uint32_t i = 0; i < num_images; ++i) {
+    page << "<img " << (mode == "staged" ? "data-src" : "src") << "=\""
+         << ImageName(mode == "display-size", i) << "\">\n";
+  }
+
+  page << "</body></html>\n";
+  return page.good();
+}
+
+std::string WriteImageBenchmarkFiles(uint32_t num_images) {
+  std::string directory = CreateTempDirectory();
+  if (directory.empty())
+    return directory;
+
+  bool success = true;
+  for (uint32_t i = 0; i < num_images && success; ++i) {
+    success = WriteImage(directory + "/" + ImageName(false, i), IMAGE_WIDTH, IMAGE_HEIGHT, i) &&
+              WriteImage(directory + "/" + ImageName(true, i), DISPLAY_WIDTH, DISPLAY_HEIGHT, i);
+  }
+
+  for (const char* mode : kModes)
+    success = success && WritePage(directory, mode, num_images);
+
+  if (!success) {
+    RemoveImageBenchmarkFiles(directory, num_images);
+    return std::string();
+  }
+
+  return directory;
+}
+
+void RemoveImageBenchmarkFiles(const std::string& directory, uint32_t num_images) {
+  for (uint32_t i = 0; i < num_images; ++i) {
+    std::remove((directory + "/" + ImageName(false, i)).c_str());
+    std::remove((directory + "/" + ImageName(true, i)).c_str());
+  }
+
+  for (const char* mode : kModes)
+    std::remove((directory + "/" + PageName(mode)).c_str());
+
+#ifdef _WIN32
+  _rmdir(directory.c_str());
+#else
+  rmdir(directory.c_str());
+#endif
+}
+
+int RunImageBenchmark(const std::string& directory, const std::string& mode,
+                      uint32_t num_images) {
+  SetupPlatform(Config(), nullptr, directory + "/");
+
+  RefPtr<Renderer> renderer = Renderer::Create();
+
+  ViewConfig view_config;
+  view_config.is_accelerated = false;
+  RefPtr<View> view = renderer->CreateView(1280, 720, view_config, nullptr);
+  view->LoadURL(("file:///image-bench-" + mode + ".html").c_str());
+
+  std::string release = "window.__imageBench && __imageBench.release(" +
+                        std::to_string(IMAGE_BENCHMARK_BATCH) + ")";
+  std::vector<double> frame_ms;
+  auto start = std::chrono::steady_clock::now();
+
+  for (;;) {
+    auto frame_start = std::chrono::steady_clock::now();
+
+    if (mode == "staged")
+      view->EvaluateScript(release.c_str());
+    renderer->Update();
+    renderer->Render();
+
+    auto frame_end = std::chrono::steady_clock::now();
+    frame_ms.push_back(std::chrono::duration<double, std::milli>(frame_end - frame_start).count());
+
+    ///
+    /// Images that finished loading this frame were decoded when we rendered it.
+    ///
+    String pending = view->EvaluateScript("window.__imageBench ? __imageBench.pending() : -1");
+    if (std::string(pending.utf8().data()) == "0")
+      break;
+
+    if (frame_end - start > std::chrono::milliseconds(IMAGE_BENCHMARK_TIMEOUT_MS)) {
+      std::cerr << "Timed out waiting for " << pending.utf8().data() << " images in " << mode
+                << " mode" << std::endl;
+      return 1;
+    }
+
+    std::this_thread::sleep_until(frame_start + std::chrono::microseconds(
+      (int64_t)(FRAME_BUDGET_MS * 1000)));
+  }
+
+  double load_ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+  size_t over_budget = std::count_if(frame_ms.begin(), frame_ms.end(),
+                                     [](double ms) { return ms > FRAME_BUDGET_MS; });
+
+  std::sort(frame_ms.begin(), frame_ms.end());
+  double p95_ms = frame_ms[std::min(frame_ms.size() - 1, frame_ms.size() * 95 / 100)];
+
+  std::cout << std::fixed << std::setprecision(1)
+            << std::setw(14) << mode << std::setw(10) << load_ms << std::setw(8)
+            << frame_ms.size() << std::setw(9) << p95_ms << std::setw(10) << frame_ms.back()
+            << std::setw(13) << over_budget << std::endl;
+
+  view = nullptr;
+  renderer = nullptr;
+  return 0;
+}
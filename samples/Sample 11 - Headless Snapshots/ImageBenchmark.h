@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+///
+/// Most images the benchmark page holds, all of them fit in the View without scrolling (images
+/// are only decoded once they're painted).
+///
+#define IMAGE_BENCHMARK_MAX_IMAGES 160
+
+///
+/// Measures the frame-time spikes a page full of large images causes while it loads.
+///
+/// Image decoding happens on the thread that calls Renderer::Update() / Render(), the first time
+/// an image is painted, so a page that shows many large images at once stalls the frames they
+/// arrive in. The benchmark loads the same page of 'num_images' images (drawn at 80x60) three
+/// ways and prints one row per mode:
+///
+///   eager          Every image is 512x384 and in the page from the start.
+///   staged         Same images, but the page starts with same-sized placeholders and only
+///                  swaps in IMAGE_BENCHMARK_BATCH real images per frame, spreading the decodes
+///                  over many frames instead of a few.
+///   display-size   Every image is already 80x60, what decoding to display size would give you:
+///                  serve images at the size they're drawn at.
+///
+/// The images are deflate-compressed PNGs with a fine grain over their gradients, so they compress
+/// about as well as photos do and decoding them means inflating them, not just copying pixels.
+///
+/// Frames are paced at 60 FPS. Each row has the time until every image was painted, the 95th
+/// percentile and worst frame time and the number of frames over the 16.7 ms budget.
+///
+
+///
+/// Create a temporary directory and write the images and the page for each mode to it. Returns
+/// the directory, or an empty string if anything couldn't be written (after cleaning up).
+///
+std::string WriteImageBenchmarkFiles(uint32_t num_images);
+
+///
+/// Delete 'directory' and everything WriteImageBenchmarkFiles() wrote to it.
+///
+void RemoveImageBenchmarkFiles(const std::string& directory, uint32_t num_images);
+
+///
+/// Sets up the Platform (serving file:/// from 'directory') and creates the Renderer, so it must
+/// run in a process of its own (one per mode, so images decoded by one mode aren't already in
+/// memory for the next). Loads the page for 'mode' and prints its row. Returns the process exit
+/// code.
+///
+int RunImageBenchmark(const std::string& directory, const std::string& mode,
+                      uint32_t num_images);
@@ -0,0 +1,134 @@
+#include "LayoutBenchmark.h"
+#include "Common.h"
+#include "NullSurface.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+///
+/// Read every element's geometry, which forces style and layout.
+///
+static const char* kMeasureScript = R"JS(
+(function() {
+  var elements = document.querySelectorAll("*");
+  var area = 0;
+  for (var i = 0; i < elements.length; i++) {
+    var rect = elements[i].getBoundingClientRect();
+    area += rect.width * rect.height;
+  }
+  return elements.length + " " + area;
+})()
+)JS";
+
+static RefPtr<View> LoadPage(Renderer* renderer, LoadCounter& counter) {
+  ViewConfig view_config;
+  view_config.is_accelerated = false;
+
+  RefPtr<View> view = renderer->CreateView(1280, 720, view_config, nullptr);
+  view->set_load_listener(&counter);
+  view->LoadURL("file:///page.html");
+  return view;
+}
+
+int RunLayoutBenchmark(bool layout_only, uint32_t num_pages) {
+  SetupPlatform();
+
+  ///
+  /// The surface factory has to be in place before any View is created.
+  ///
+  NullSurfaceFactory null_surface_factory;
+  if (layout_only)
+    Platform::instance().set_surface_factory(&null_surface_factory);
+
+  RefPtr<Renderer> renderer = Renderer::Create();
+  LoadCounter counter;
+
+  ///
+  /// Throughput: one page at a time, as a scraper would.
+  ///
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < num_pages; ++i) {
+    uint32_t target = counter.num_finished + 1;
+    RefPtr<View> view = LoadPage(renderer.get(), counter);
+    bool loaded = WaitForLoads(renderer.get(), counter, target);
+    view->set_load_listener(nullptr);
+    if (!loaded)
+      return 1;
+
+    view->EvaluateScript(kMeasureScript);
+    if (!layout_only)
+      renderer->Render();
+  }
+  double seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  ///
+  /// Memory: how much each extra loaded (and, for normal Views, painted) View costs.
+  ///
+  uint64_t memory_before = GetResidentMemory();
+
+  std::vector<RefPtr<View>> views;
+  uint32_t target = counter.num_finished + LAYOUT_BENCHMARK_VIEWS;
+  for (uint32_t i = 0; i < LAYOUT_BENCHMARK_VIEWS; ++i)
+    views.push_back(LoadPage(renderer.get(), counter));
+  bool loaded = WaitForLoads(renderer.get(), counter, target);
+  for (auto& view : views)
+    view->set_load_listener(nullptr);
+  if (!loaded)
+    return 1;
+
+  for (auto& view : views)
+    view->EvaluateScript(kMeasureScript);
+  if (!layout_only)
+    renderer->Render();
+
+  uint64_t memory_after = GetResidentMemory();
+  double mb_per_view = memory_after > memory_before ?
+    (memory_after - memory_before) / (1024.0 * 1024.0) / LAYOUT_BENCHMARK_VIEWS : 0;
+
+  std::cout << std::fixed << std::setprecision(2)
+            << std::setw(8) << (layout_only ? "layout" : "cpu") << std::setw(11)
+            << num_pages / seconds << std::setw(14) << mb_per_view << std::endl;
+
+  views.clear();
+  renderer = nullptr;
+  return 0;
+}
+
+uint64_t GetResidentMemory() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return counters.WorkingSetSize;
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) ==
+      KERN_SUCCESS)
+    return info.resident_size;
+  return 0;
+#else
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (!file)
+    return 0;
+  unsigned long long size = 0, resident = 0;
+  int count = fscanf(file, "%llu %llu", &size, &resident);
+  fclose(file);
+  return count == 2 ? resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
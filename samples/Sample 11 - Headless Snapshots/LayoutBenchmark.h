@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+///
+/// Number of Views we keep loaded at once to measure the memory each one takes.
+///
+#define LAYOUT_BENCHMARK_VIEWS 32
+
+///
+/// Measures what layout-only Views (see NullSurface) save over normal CPU Views, for workloads
+/// that load pages only to read their DOM or element geometry.
+///
+/// Sets up the Platform and creates the Renderer, so it must run in a process of its own (one
+/// per mode, so each gets a clean memory baseline). It loads our sample page 'num_pages' times
+/// one after another, reading every element's geometry (and rendering, for normal Views), then
+/// keeps LAYOUT_BENCHMARK_VIEWS Views loaded at once and prints one row: pages per second and
+/// resident memory per View.
+///
+/// Returns the process exit code, 1 if a page fails to load (see WaitForLoads()).
+///
+int RunLayoutBenchmark(bool layout_only, uint32_t num_pages);
+
+///
+/// Resident memory of this process in bytes (0 where we can't tell).
+///
+uint64_t GetResidentMemory();
@@ -0,0 +1,50 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+
+using namespace ultralight;
+
+///
+/// A Surface with no pixels, for layout-only Views.
+///
+/// Views loaded only to read their DOM or element geometry through EvaluateScript never need
+/// pixels, but every CPU View still gets a BitmapSurface as big as the View. Setting a
+/// NullSurfaceFactory as the Platform's surface factory (before creating the Renderer) gives
+/// every View one of these instead: style, layout and JavaScript run as usual and nothing is
+/// allocated for painting.
+///
+/// A process with layout-only Views must never call Renderer::Render(), there's nowhere to paint
+/// to (LockPixels() returns nullptr).
+///
+class NullSurface : public Surface {
+public:
+  NullSurface(uint32_t width, uint32_t height) : width_(width), height_(height) {}
+  virtual ~NullSurface() {}
+
+  virtual uint32_t width() const override { return width_; }
+  virtual uint32_t height() const override { return height_; }
+  virtual uint32_t row_bytes() const override { return 0; }
+  virtual size_t size() const override { return 0; }
+
+  virtual void* LockPixels() override { return nullptr; }
+  virtual void UnlockPixels() override {}
+
+  virtual void Resize(uint32_t width, uint32_t height) override {
+    width_ = width;
+    height_ = height;
+  }
+
+protected:
+  uint32_t width_;
+  uint32_t height_;
+};
+
+class NullSurfaceFactory : public SurfaceFactory {
+public:
+  virtual Surface* CreateSurface(uint32_t width, uint32_t height) override {
+    return new NullSurface(width, height);
+  }
+
+  virtual void DestroySurface(Surface* surface) override {
+    delete static_cast<NullSurface*>(surface);
+  }
+};
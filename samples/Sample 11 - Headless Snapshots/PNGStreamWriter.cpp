@@ -0,0 +1,372 @@
+#include "PNGStreamWriter.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+///
+/// How much new data we collect before deflating it as a block, and how far back matches can
+/// reach (the most deflate allows).
+///
+#define BLOCK_SIZE (64 * 1024)
+#define WINDOW_SIZE (32 * 1024)
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+///
+/// How many earlier positions with the same hash we try per match, more compresses better but
+/// slower.
+///
+#define MAX_CHAIN 32
+
+#define HASH_BITS 15
+
+///
+/// Write an IDAT chunk once we have this much compressed data.
+///
+#define MAX_CHUNK_SIZE (64 * 1024)
+
+static const uint16_t kLengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t kLengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3,
+                                        3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t kDistanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                          193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                          6145, 8193, 12289, 16385, 24577 };
+static const uint8_t kDistanceExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                          8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static uint32_t CRC32(uint32_t crc, const uint8_t* data, size_t size) {
+  static uint32_t table[256];
+  static bool has_table = false;
+  if (!has_table) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    has_table = true;
+  }
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void PutBigEndian(uint8_t* out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+///
+/// The value a PNG filter predicts for a byte from the one to its left ('a'), above ('b') and
+/// above-left ('c').
+///
+static int Predict(uint8_t filter, int a, int b, int c) {
+  switch (filter) {
+  case 1:
+    return a;
+  case 2:
+    return b;
+  case 4: {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+  }
+  default:
+    return 0;
+  }
+}
+
+PNGStreamWriter::PNGStreamWriter() {
+}
+
+PNGStreamWriter::~PNGStreamWriter() {
+  if (file_)
+    fclose(file_);
+}
+
+bool PNGStreamWriter::Open(const std::string& path, uint32_t width, uint32_t height) {
+  if (file_ || !width || !height)
+    return false;
+
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_)
+    return false;
+
+  width_ = width;
+  height_ = height;
+  rows_written_ = 0;
+  adler_a_ = 1;
+  adler_b_ = 0;
+  prior_row_.assign((size_t)width * 4, 0);
+  filtered_row_.resize((size_t)width * 4 + 1);
+  window_.clear();
+  window_.reserve(WINDOW_SIZE + BLOCK_SIZE + (size_t)width * 4 + 1);
+  window_pos_ = 0;
+  hash_head_.assign(1 << HASH_BITS, -1);
+  hash_prev_.clear();
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+
+  ///
+  /// The zlib header: deflate with a 32 KB window, no preset dictionary.
+  ///
+  output_.assign({ 0x78, 0x01 });
+
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  if (fwrite(signature, 1, sizeof(signature), file_) != sizeof(signature))
+    return false;
+
+  ///
+  /// 8 bits per channel, RGBA, no interlacing.
+  ///
+  uint8_t header[13] = {};
+  PutBigEndian(header, width);
+  PutBigEndian(header + 4, height);
+  header[8] = 8;
+  header[9] = 6;
+  return WriteChunk("IHDR", header, sizeof(header));
+}
+
+bool PNGStreamWriter::WriteRow(const uint8_t* rgba) {
+  if (!file_ || rows_written_ >= height_)
+    return false;
+
+  ///
+  /// Every row starts with its filter type. Try None (0), Sub (1), Up (2) and Paeth (4) and keep
+  /// whichever gives the smallest sum of absolute differences.
+  ///
+  size_t size = (size_t)width_ * 4;
+  const uint8_t* up = prior_row_.data();
+  uint8_t best_filter = 0;
+  uint64_t best_sum = UINT64_MAX;
+
+  for (uint8_t filter : { 0, 1, 2, 4 }) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size && sum < best_sum; ++i) {
+      uint8_t value = (uint8_t)(rgba[i] - Predict(filter, i >= 4 ? rgba[i - 4] : 0, up[i],
+                                                  i >= 4 ? up[i - 4] : 0));
+      sum += value < 128 ? value : 256 - value;
+    }
+    if (sum < best_sum) {
+      best_sum = sum;
+      best_filter = filter;
+    }
+  }
+
+  filtered_row_[0] = best_filter;
+  for (size_t i = 0; i < size; ++i) {
+    filtered_row_[i + 1] = (uint8_t)(rgba[i] - Predict(best_filter, i >= 4 ? rgba[i - 4] : 0,
+                                                       up[i], i >= 4 ? up[i - 4] : 0));
+  }
+  std::copy(rgba, rgba + size, prior_row_.begin());
+
+  if (!WriteData(filtered_row_.data(), filtered_row_.size()))
+    return false;
+
+  rows_written_++;
+  return true;
+}
+
+bool PNGStreamWriter::Close() {
+  if (!file_)
+    return false;
+
+  bool success = rows_written_ == height_ && CompressBlock(true);
+  if (success) {
+    ///
+    /// Pad the last byte, then the Adler-32 of the uncompressed data ends the zlib stream.
+    ///
+    if (bit_count_)
+      PutBits(0, 8 - bit_count_);
+
+    uint8_t adler[4];
+    PutBigEndian(adler, (adler_b_ << 16) | adler_a_);
+    output_.insert(output_.end(), adler, adler + 4);
+    success = FlushOutput() && WriteChunk("IEND", nullptr, 0);
+  }
+
+  success = fclose(file_) == 0 && success;
+  file_ = nullptr;
+  return success;
+}
+
+bool PNGStreamWriter::WriteChunk(const char* type, const uint8_t* data, size_t size) {
+  uint8_t header[8];
+  PutBigEndian(header, (uint32_t)size);
+  std::copy(type, type + 4, header + 4);
+
+  uint32_t crc = CRC32(0, header + 4, 4);
+  if (size)
+    crc = CRC32(crc, data, size);
+
+  uint8_t footer[4];
+  PutBigEndian(footer, crc);
+
+  return fwrite(header, 1, sizeof(header), file_) == sizeof(header) &&
+         (!size || fwrite(data, 1, size, file_) == size) &&
+         fwrite(footer, 1, sizeof(footer), file_) == sizeof(footer);
+}
+
+bool PNGStreamWriter::WriteData(const uint8_t* data, size_t size) {
+  ///
+  /// Adler-32 of the uncompressed data, reduced every 5552 bytes (the most it can take before
+  /// overflowing 32 bits).
+  ///
+  for (size_t i = 0; i < size; i += 5552) {
+    size_t end = std::min(size, i + 5552);
+    for (size_t j = i; j < end; ++j) {
+      adler_a_ += data[j];
+      adler_b_ += adler_a_;
+    }
+    adler_a_ %= 65521;
+    adler_b_ %= 65521;
+  }
+
+  window_.insert(window_.end(), data, data + size);
+  if (window_.size() - window_pos_ >= BLOCK_SIZE)
+    return CompressBlock(false);
+
+  return true;
+}
+
+bool PNGStreamWriter::CompressBlock(bool is_final) {
+  ///
+  /// A block compressed with the fixed Huffman codes (type 1).
+  ///
+  PutBits(is_final ? 1 : 0, 1);
+  PutBits(1, 2);
+
+  size_t end = window_.size();
+  hash_prev_.resize(end, -1);
+  size_t pos = window_pos_;
+  while (pos < end) {
+    uint32_t best_length = 0, best_distance = 0;
+    if (pos + MIN_MATCH <= end) {
+      size_t max_length = std::min((size_t)MAX_MATCH, end - pos);
+      uint32_t hash = (window_[pos] << 10 ^ window_[pos + 1] << 5 ^ window_[pos + 2]) &
+                      ((1 << HASH_BITS) - 1);
+      int32_t candidate = hash_head_[hash];
+      for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain) {
+        if (pos - candidate > WINDOW_SIZE)
+          break;
+
+        const uint8_t* a = &window_[candidate];
+        const uint8_t* b = &window_[pos];
+        size_t length = 0;
+        while (length < max_length && a[length] == b[length])
+          length++;
+
+        if (length > best_length) {
+          best_length = (uint32_t)length;
+          best_distance = (uint32_t)(pos - candidate);
+          if (length == max_length)
+            break;
+        }
+        candidate = hash_prev_[candidate];
+      }
+    }
+
+    if (best_length >= MIN_MATCH) {
+      PutMatch(best_length, best_distance);
+      for (size_t i = 0; i < best_length; ++i)
+        InsertHash(pos + i);
+      pos += best_length;
+    } else {
+      PutLiteral(window_[pos]);
+      InsertHash(pos);
+      pos++;
+    }
+
+    if (output_.size() >= MAX_CHUNK_SIZE && !FlushOutput())
+      return false;
+  }
+
+  ///
+  /// End of block.
+  ///
+  PutLiteral(256);
+
+  ///
+  /// Keep the last 32 KB for the next block to match against, and re-index them since their
+  /// positions moved.
+  ///
+  if (end > WINDOW_SIZE) {
+    window_.erase(window_.begin(), window_.end() - WINDOW_SIZE);
+    std::fill(hash_head_.begin(), hash_head_.end(), -1);
+    hash_prev_.assign(window_.size(), -1);
+    for (size_t i = 0; i < window_.size(); ++i)
+      InsertHash(i);
+  }
+  window_pos_ = window_.size();
+  return true;
+}
+
+void PNGStreamWriter::InsertHash(size_t pos) {
+  if (pos + MIN_MATCH > window_.size())
+    return;
+
+  uint32_t hash = (window_[pos] << 10 ^ window_[pos + 1] << 5 ^ window_[pos + 2]) &
+                  ((1 << HASH_BITS) - 1);
+  hash_prev_[pos] = hash_head_[hash];
+  hash_head_[hash] = (int32_t)pos;
+}
+
+void PNGStreamWriter::PutBits(uint32_t value, uint32_t count) {
+  ///
+  /// Deflate packs bits starting at the least significant bit of each byte.
+  ///
+  bit_buffer_ |= value << bit_count_;
+  bit_count_ += count;
+  while (bit_count_ >= 8) {
+    output_.push_back((uint8_t)bit_buffer_);
+    bit_buffer_ >>= 8;
+    bit_count_ -= 8;
+  }
+}
+
+void PNGStreamWriter::PutCode(uint32_t code, uint32_t length) {
+  ///
+  /// Huffman codes are the exception, they go out most significant bit first.
+  ///
+  uint32_t reversed = 0;
+  for (uint32_t i = 0; i < length; ++i)
+    reversed |= ((code >> i) & 1) << (length - 1 - i);
+  PutBits(reversed, length);
+}
+
+void PNGStreamWriter::PutLiteral(uint32_t symbol) {
+  if (symbol < 144)
+    PutCode(0x30 + symbol, 8);
+  else if (symbol < 256)
+    PutCode(0x190 + symbol - 144, 9);
+  else if (symbol < 280)
+    PutCode(symbol - 256, 7);
+  else
+    PutCode(0xC0 + symbol - 280, 8);
+}
+
+void PNGStreamWriter::PutMatch(uint32_t length, uint32_t distance) {
+  uint32_t code = 28;
+  while (kLengthBase[code] > length)
+    code--;
+  PutLiteral(257 + code);
+  PutBits(length - kLengthBase[code], kLengthExtra[code]);
+
+  code = 29;
+  while (kDistanceBase[code] > distance)
+    code--;
+  PutCode(code, 5);
+  PutBits(distance - kDistanceBase[code], kDistanceExtra[code]);
+}
+
+bool PNGStreamWriter::FlushOutput() {
+  bool success = output_.empty() || WriteChunk("IDAT", output_.data(), output_.size());
+  output_.clear();
+  return success;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+///
+/// Writes an RGBA PNG one row at a time, so an image can be encoded without ever having all of
+/// it in memory (Bitmap::WritePNG needs the whole image).
+///
+/// We have no zlib to link against here, so we compress the image data ourselves: every row is
+/// filtered the way PNG encoders usually pick (the filter with the smallest sum of absolute
+/// differences), then deflated with LZ77 matching over a 32 KB window and deflate's fixed Huffman
+/// codes. Files come out a lot smaller than the raw pixels, though not as small as zlib's, run
+/// them through any PNG optimizer to shrink them further.
+///
+class PNGStreamWriter {
+public:
+  PNGStreamWriter();
+  ~PNGStreamWriter();
+
+  ///
+  /// Create 'path' and write the header for a 'width' x 'height' image.
+  ///
+  bool Open(const std::string& path, uint32_t width, uint32_t height);
+
+  ///
+  /// Write the next row, 'rgba' is width * 4 bytes of straight (not premultiplied) alpha.
+  ///
+  bool WriteRow(const uint8_t* rgba);
+
+  ///
+  /// Finish the file, fails if fewer than 'height' rows were written.
+  ///
+  bool Close();
+
+  uint32_t rows_written() const { return rows_written_; }
+
+protected:
+  bool WriteChunk(const char* type, const uint8_t* data, size_t size);
+  bool WriteData(const uint8_t* data, size_t size);
+
+  ///
+  /// Deflate everything in 'window_' past 'window_pos_' as one block, then drop all but the last
+  /// 32 KB of the window.
+  ///
+  bool CompressBlock(bool is_final);
+
+  void InsertHash(size_t pos);
+  void PutBits(uint32_t value, uint32_t count);
+  void PutCode(uint32_t code, uint32_t length);
+  void PutLiteral(uint32_t symbol);
+  void PutMatch(uint32_t length, uint32_t distance);
+  bool FlushOutput();
+
+  FILE* file_ = nullptr;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  uint32_t rows_written_ = 0;
+  uint32_t adler_a_ = 1;
+  uint32_t adler_b_ = 0;
+
+  // The previous row (for filtering) and the filtered row we're building.
+  std::vector<uint8_t> prior_row_;
+  std::vector<uint8_t> filtered_row_;
+
+  // Data we already deflated (the match window) followed by data we haven't yet.
+  std::vector<uint8_t> window_;
+  size_t window_pos_ = 0;
+  std::vector<int32_t> hash_head_;
+  std::vector<int32_t> hash_prev_;
+
+  // Compressed bytes not yet written as an IDAT chunk.
+  std::vector<uint8_t> output_;
+  uint32_t bit_buffer_ = 0;
+  uint32_t bit_count_ = 0;
+};
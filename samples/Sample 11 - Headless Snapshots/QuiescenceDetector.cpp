@@ -0,0 +1,227 @@
+#include "QuiescenceDetector.h"
+#include <cstdio>
+
+//
+// Installed into every page before any of its own scripts run.
+//
+// Counts requests in flight and remembers when each timer is due, status(horizon) reports
+// "<requests> <timers due within horizon> <fonts loading> <images loading>".
+//
+static const char* kQuiescenceScript = R"JS(
+(function() {
+  if (window.__quiescence)
+    return;
+
+  var requests = 0;
+  var timers = {};
+
+  function run(callback, args) {
+    if (typeof callback === "function")
+      callback.apply(window, args);
+    else
+      (0, eval)(String(callback));
+  }
+
+  // Requests
+
+  if (window.fetch) {
+    var nativeFetch = window.fetch;
+    window.fetch = function() {
+      requests++;
+      var done = function() { requests--; };
+      try {
+        var promise = nativeFetch.apply(this, arguments);
+        promise.then(done, done);
+        return promise;
+      } catch (e) {
+        done();
+        throw e;
+      }
+    };
+  }
+
+  if (window.XMLHttpRequest) {
+    var nativeSend = XMLHttpRequest.prototype.send;
+    XMLHttpRequest.prototype.send = function() {
+      var finished = false;
+      var done = function() {
+        if (!finished) {
+          finished = true;
+          requests--;
+        }
+      };
+      requests++;
+      this.addEventListener("loadend", done);
+      try {
+        return nativeSend.apply(this, arguments);
+      } catch (e) {
+        done();
+        throw e;
+      }
+    };
+  }
+
+  // Timers
+
+  var nativeSetTimeout = window.setTimeout;
+  var nativeSetInterval = window.setInterval;
+  var nativeClearTimeout = window.clearTimeout;
+  var nativeClearInterval = window.clearInterval;
+
+  window.setTimeout = function(callback, delay) {
+    var args = Array.prototype.slice.call(arguments, 2);
+    var id = nativeSetTimeout.call(window, function() {
+      delete timers[id];
+      run(callback, args);
+    }, delay);
+    timers[id] = performance.now() + Math.max(Number(delay) || 0, 0);
+    return id;
+  };
+
+  window.setInterval = function(callback, delay) {
+    var args = Array.prototype.slice.call(arguments, 2);
+    var period = Math.max(Number(delay) || 0, 0);
+    var id = nativeSetInterval.call(window, function() {
+      if (id in timers)
+        timers[id] = performance.now() + period;
+      run(callback, args);
+    }, delay);
+    timers[id] = performance.now() + period;
+    return id;
+  };
+
+  window.clearTimeout = function(id) {
+    delete timers[id];
+    nativeClearTimeout.call(window, id);
+  };
+
+  window.clearInterval = function(id) {
+    delete timers[id];
+    nativeClearInterval.call(window, id);
+  };
+
+  // Images
+
+  function isInView(element) {
+    var rect = element.getBoundingClientRect();
+    return rect.bottom >= 0 && rect.right >= 0 &&
+           rect.top <= window.innerHeight && rect.left <= window.innerWidth;
+  }
+
+  function status(horizon) {
+    var now = performance.now();
+    var dueTimers = 0;
+    for (var id in timers) {
+      if (timers[id] - now <= horizon)
+        dueTimers++;
+    }
+
+    var fonts = document.fonts && document.fonts.status === "loading" ? 1 : 0;
+
+    var images = 0;
+    for (var i = 0; i < document.images.length; i++) {
+      var image = document.images[i];
+      if (image.complete || (image.loading === "lazy" && !isInView(image)))
+        continue;
+      images++;
+    }
+
+    return requests + " " + dueTimers + " " + fonts + " " + images;
+  }
+
+  window.__quiescence = { status: status };
+})();
+)JS";
+
+std::string QuiescenceDetector::Status::Describe() const {
+  if (!reasons)
+    return "idle";
+
+  std::string result;
+  auto add = [&](const std::string& reason) {
+    if (!result.empty())
+      result += ", ";
+    result += reason;
+  };
+
+  if (reasons & kLoading)
+    add("loading");
+  if (reasons & kPendingRequests)
+    add(std::to_string(num_requests) + (num_requests == 1 ? " request" : " requests"));
+  if (reasons & kPendingTimers)
+    add(std::to_string(num_timers) + (num_timers == 1 ? " timer" : " timers"));
+  if (reasons & kPendingFonts)
+    add("fonts");
+  if (reasons & kPendingImages)
+    add(std::to_string(num_images) + (num_images == 1 ? " image" : " images"));
+  if (reasons & kPaint)
+    add("paint");
+  return result;
+}
+
+void QuiescenceDetector::Install(View* view) {
+  view->EvaluateScript(kQuiescenceScript);
+}
+
+void QuiescenceDetector::Reset(const Thresholds& thresholds) {
+  thresholds_ = thresholds;
+  status_ = Status();
+  is_idle_ = false;
+}
+
+bool QuiescenceDetector::Poll(View* view) {
+  Status status;
+
+  if (view->is_loading())
+    status.reasons |= kLoading;
+
+  char script[96];
+  snprintf(script, sizeof(script), "window.__quiescence ? __quiescence.status(%.3f) : ''",
+           thresholds_.timer_horizon_ms);
+  String result = view->EvaluateScript(script);
+
+  ///
+  /// Pages without the script (eg, about:blank) only have the checks below.
+  ///
+  unsigned int num_fonts = 0;
+  if (sscanf(result.utf8().data(), "%u %u %u %u", &status.num_requests, &status.num_timers,
+             &num_fonts, &status.num_images) == 4) {
+    if (status.num_requests)
+      status.reasons |= kPendingRequests;
+    if (status.num_timers)
+      status.reasons |= kPendingTimers;
+    if (num_fonts)
+      status.reasons |= kPendingFonts;
+    if (status.num_images)
+      status.reasons |= kPendingImages;
+  }
+
+  ///
+  /// Accelerated Views have no Surface, all we can ask them is whether they need painting.
+  ///
+  Surface* surface = view->surface();
+  if (surface) {
+    if (!surface->dirty_bounds().IsEmpty()) {
+      status.reasons |= kPaint;
+      surface->ClearDirtyBounds();
+    }
+  } else if (view->needs_paint()) {
+    status.reasons |= kPaint;
+  }
+
+  status.reasons &= thresholds_.reasons;
+
+  auto now = std::chrono::steady_clock::now();
+  if (status.reasons) {
+    is_idle_ = false;
+  } else if (!is_idle_) {
+    is_idle_ = true;
+    idle_since_ = now;
+  }
+
+  if (is_idle_)
+    status.idle_ms = std::chrono::duration<double, std::milli>(now - idle_since_).count();
+
+  status_ = status;
+  return is_idle_ && status.idle_ms >= thresholds_.quiet_period_ms;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <chrono>
+#include <string>
+
+using namespace ultralight;
+
+///
+/// Tells when a page has gone idle, so a snapshot can be taken as soon as it's actually done
+/// instead of at OnFinishLoading (which fires before late XHR/fetch requests, web fonts and
+/// images are in) or after a conservative sleep.
+///
+/// A page is idle when none of these hold for a quiet period:
+///
+///  - The View is still loading.
+///  - XHR or fetch() requests are in flight.
+///  - A setTimeout/setInterval is due within a horizon.
+///  - Web fonts are loading (document.fonts.status).
+///  - Images on the page haven't finished loading (lazy ones only once they're in view).
+///  - The last Render() painted something.
+///
+/// Requests, timers, fonts and images are tracked by a script we install into the page before
+/// any of its own scripts run, loading and painting by asking the View and its Surface. Resources
+/// loaded by CSS (backgrounds, imports) are only seen through the paint they cause.
+///
+class QuiescenceDetector {
+public:
+  ///
+  /// Why a page isn't idle, as bit flags.
+  ///
+  enum Reason : uint32_t {
+    kLoading         = 1 << 0,
+    kPendingRequests = 1 << 1,
+    kPendingTimers   = 1 << 2,
+    kPendingFonts    = 1 << 3,
+    kPendingImages   = 1 << 4,
+    kPaint           = 1 << 5,
+    kAllReasons      = (1 << 6) - 1,
+  };
+
+  struct Thresholds {
+    Thresholds() : timer_horizon_ms(50), quiet_period_ms(100), reasons(kAllReasons) {}
+
+    double timer_horizon_ms;  // Timers due further out than this don't count as pending
+    double quiet_period_ms;   // How long a page has to stay idle before we call it idle
+    uint32_t reasons;         // Which Reasons to wait on, the rest are ignored
+  };
+
+  struct Status {
+    uint32_t reasons = 0;     // Reasons the page wasn't idle at the last Poll()
+    uint32_t num_requests = 0;
+    uint32_t num_timers = 0;
+    uint32_t num_images = 0;
+    double idle_ms = 0;       // How long the page has been idle for
+
+    ///
+    /// Human-readable list of reasons, eg "loading, 2 requests, paint", or "idle".
+    ///
+    std::string Describe() const;
+  };
+
+  ///
+  /// Installs the tracking script into a new page, call this from OnWindowObjectReady (after
+  /// any script that replaces the page's timers, like VirtualClock).
+  ///
+  void Install(View* view);
+
+  ///
+  /// Forget the quiet period so far, call this when starting on a new page.
+  ///
+  void Reset(const Thresholds& thresholds = Thresholds());
+
+  ///
+  /// Check the page once, call this after each Renderer::Update() and Renderer::Render().
+  /// Returns true once the page has been idle for the quiet period.
+  ///
+  bool Poll(View* view);
+
+  // The result of the last Poll().
+  const Status& status() const { return status_; }
+
+  const Thresholds& thresholds() const { return thresholds_; }
+
+protected:
+  Thresholds thresholds_;
+  Status status_;
+  bool is_idle_ = false;
+  std::chrono::steady_clock::time_point idle_since_;
+};
@@ -0,0 +1,81 @@
+#include "RasterBenchmark.h"
+#include "Common.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+///
+/// Frames of the animation fixture we paint (four seconds at 60 FPS).
+///
+#define RASTER_BENCHMARK_FRAMES 240
+
+#define FRAME_INTERVAL_US (1000000 / 60)
+
+static bool Load(Renderer* renderer, View* view, LoadCounter& counter, const char* url) {
+  uint32_t target = counter.num_finished + 1;
+  view->LoadURL(url);
+  return WaitForLoads(renderer, counter, target);
+}
+
+int RunRasterBenchmark(uint32_t num_threads, uint32_t num_pages) {
+  Config config;
+  config.num_renderer_threads = num_threads;
+  SetupPlatform(config);
+
+  RefPtr<Renderer> renderer = Renderer::Create();
+
+  ViewConfig view_config;
+  view_config.is_accelerated = false;
+  view_config.initial_device_scale = 2.0;
+  RefPtr<View> view = renderer->CreateView(1920, 1080, view_config, nullptr);
+
+  LoadCounter counter;
+  view->set_load_listener(&counter);
+
+  ///
+  /// Page load: every load dirties the whole View, so each Render() paints all of it.
+  ///
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < num_pages; ++i) {
+    if (!Load(renderer.get(), view.get(), counter, "file:///page.html")) {
+      view->set_load_listener(nullptr);
+      return 1;
+    }
+    renderer->Render();
+  }
+  double pages_per_second = num_pages / std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  ///
+  /// Animation: animations only advance with real time, so pace the frames like a display would
+  /// and time just the painting.
+  ///
+  if (!Load(renderer.get(), view.get(), counter, "file:///animation.html")) {
+    view->set_load_listener(nullptr);
+    return 1;
+  }
+  renderer->Render();
+
+  double render_ms = 0;
+  auto next_frame = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < RASTER_BENCHMARK_FRAMES; ++i) {
+    next_frame += std::chrono::microseconds(FRAME_INTERVAL_US);
+    std::this_thread::sleep_until(next_frame);
+
+    renderer->Update();
+    auto render_start = std::chrono::steady_clock::now();
+    renderer->Render();
+    render_ms += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - render_start).count();
+  }
+
+  std::cout << std::fixed << std::setprecision(2)
+            << std::setw(9) << num_threads << std::setw(13) << pages_per_second << std::setw(18)
+            << render_ms / RASTER_BENCHMARK_FRAMES << std::endl;
+
+  view->set_load_listener(nullptr);
+  view = nullptr;
+  renderer = nullptr;
+  return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+///
+/// Most renderer threads the benchmark goes up to.
+///
+#define MAX_RASTER_BENCHMARK_THREADS 16
+
+///
+/// Measures how CPU painting scales with Config::num_renderer_threads, the Renderer's own pool of
+/// threads that CPU Views (is_accelerated = false) are painted with.
+///
+/// Sets up the Platform and creates the Renderer, so it must run in a process of its own (one per
+/// thread count, the Config can only be set once per process). Paints a 1920x1080 View at 2x
+/// scale (a 3840x2160 surface) on two fixtures and prints one row:
+///
+///   page-load   Our sample page loaded and painted 'num_pages' times, pages per second.
+///   animation   assets/animation.html (40 tiles with CSS animations) at a 60 FPS pace for
+///               RASTER_BENCHMARK_FRAMES frames, average milliseconds in Renderer::Render().
+///
+/// Returns the process exit code, 1 if a fixture fails to load (see WaitForLoads()).
+///
+int RunRasterBenchmark(uint32_t num_threads, uint32_t num_pages);
@@ -0,0 +1,392 @@
+#include "ShardPool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+#endif
+
+ShardPool::ShardPool(const std::string& executable_path, uint32_t num_shards) {
+#ifndef _WIN32
+  ///
+  /// Writing to a worker that died should fail, not kill us.
+  ///
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(new Shard());
+    Shard& shard = *shards_.back();
+    shard.is_running = StartWorker(shard, executable_path, i);
+    if (shard.is_running)
+      shard.reader = std::thread(&ShardPool::ReaderMain, this, i);
+  }
+
+  ///
+  /// Wait for every worker to create its Renderer (or exit trying).
+  ///
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() {
+    for (auto& shard : shards_)
+      if (shard->is_running && !shard->is_ready)
+        return false;
+    return true;
+  });
+}
+
+ShardPool::~ShardPool() {
+  WaitAll();
+
+  ///
+  /// Workers exit once their stdin is closed, which in turn ends our reader threads.
+  ///
+  for (auto& shard : shards_) {
+    CloseInput(*shard);
+    if (shard->reader.joinable())
+      shard->reader.join();
+    StopWorker(*shard);
+  }
+}
+
+uint32_t ShardPool::num_running() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t count = 0;
+  for (auto& shard : shards_)
+    if (shard->is_running)
+      count++;
+  return count;
+}
+
+void ShardPool::Submit(const SnapshotJob& job) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  Shard* best = nullptr;
+  changed_.wait(lock, [&]() {
+    bool any_running = false;
+    best = nullptr;
+    for (auto& shard : shards_) {
+      if (!shard->is_running)
+        continue;
+
+      any_running = true;
+      if (shard->queued.size() >= MAX_JOBS_PER_SHARD)
+        continue;
+
+      if (!best || shard->queued.size() < best->queued.size() ||
+          (shard->queued.size() == best->queued.size() &&
+           shard->stats.busy_ms < best->stats.busy_ms))
+        best = shard.get();
+    }
+
+    return best || !any_running;
+  });
+
+  if (!best) {
+    SnapshotResult result;
+    result.error = "No workers are running";
+    completed_.push_back({ job, result, 0 });
+    return;
+  }
+
+  ///
+  /// If the write fails the worker is gone, its reader thread will fail the job for us.
+  ///
+  best->queued.push_back(job);
+  num_queued_++;
+  WriteLine(*best, FormatJob(job));
+}
+
+void ShardPool::WaitAll() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return num_queued_ == 0; });
+}
+
+std::vector<ShardPool::Completed> ShardPool::completed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return completed_;
+}
+
+ShardPool::ShardStats ShardPool::shard_stats(uint32_t shard) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shards_[shard]->stats;
+}
+
+void ShardPool::ReaderMain(uint32_t index) {
+  Shard& shard = *shards_[index];
+  std::string buffer;
+  std::string line;
+
+  while (ReadLine(shard, buffer, line)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!shard.is_ready) {
+      shard.is_ready = line == "ready";
+      changed_.notify_all();
+      continue;
+    }
+
+    if (shard.queued.empty())
+      continue;
+
+    Completed completed = { shard.queued.front(), SnapshotResult(), index };
+    if (!ParseResult(line, completed.result))
+      completed.result.error = "Could not parse result: " + line;
+
+    shard.queued.pop_front();
+    shard.stats.num_jobs++;
+    shard.stats.busy_ms += completed.result.ms;
+    completed_.push_back(completed);
+    num_queued_--;
+    changed_.notify_all();
+  }
+
+  ///
+  /// The worker exited (or crashed), fail whatever it had left.
+  ///
+  std::lock_guard<std::mutex> lock(mutex_);
+  shard.is_running = false;
+  for (auto& job : shard.queued) {
+    SnapshotResult result;
+    result.error = "Worker exited";
+    completed_.push_back({ job, result, index });
+    num_queued_--;
+  }
+  shard.queued.clear();
+  changed_.notify_all();
+}
+
+#ifdef _WIN32
+
+std::string ShardPool::GetExecutablePath(const char* argv0) {
+  char path[MAX_PATH];
+  DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+  return length > 0 && length < MAX_PATH ? std::string(path, length) : std::string(argv0);
+}
+
+bool ShardPool::StartWorker(Shard& shard, const std::string& executable_path, uint32_t index) {
+  ///
+  /// Create inheritable pipes for the worker's stdin/stdout, keeping our ends private.
+  ///
+  SECURITY_ATTRIBUTES security = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+  HANDLE child_input, input, output, child_output;
+  if (!CreatePipe(&child_input, &input, &security, 0))
+    return false;
+  if (!CreatePipe(&output, &child_output, &security, 0)) {
+    CloseHandle(child_input);
+    CloseHandle(input);
+    return false;
+  }
+  SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+  SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+  STARTUPINFOA startup_info = {};
+  startup_info.cb = sizeof(startup_info);
+  startup_info.dwFlags = STARTF_USESTDHANDLES;
+  startup_info.hStdInput = child_input;
+  startup_info.hStdOutput = child_output;
+  startup_info.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+  PROCESS_INFORMATION process_info = {};
+  std::string command_line = "\"" + executable_path + "\" --worker " + std::to_string(index);
+  BOOL started = CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, TRUE, 0, nullptr,
+                                nullptr, &startup_info, &process_info);
+
+  CloseHandle(child_input);
+  CloseHandle(child_output);
+
+  if (!started) {
+    CloseHandle(input);
+    CloseHandle(output);
+    return false;
+  }
+
+  CloseHandle(process_info.hThread);
+  shard.process = process_info.hProcess;
+  shard.input = input;
+  shard.output = output;
+  return true;
+}
+
+bool ShardPool::WriteLine(Shard& shard, const std::string& line) {
+  if (!shard.input)
+    return false;
+
+  std::string data = line + "\n";
+  const char* pos = data.data();
+  DWORD remaining = (DWORD)data.size();
+  while (remaining > 0) {
+    DWORD written = 0;
+    if (!WriteFile((HANDLE)shard.input, pos, remaining, &written, nullptr))
+      return false;
+    pos += written;
+    remaining -= written;
+  }
+  return true;
+}
+
+bool ShardPool::ReadLine(Shard& shard, std::string& buffer, std::string& line) {
+  while (true) {
+    size_t end = buffer.find('\n');
+    if (end != std::string::npos) {
+      line = buffer.substr(0, end);
+      buffer.erase(0, end + 1);
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      return true;
+    }
+
+    char chunk[4096];
+    DWORD read = 0;
+    if (!ReadFile((HANDLE)shard.output, chunk, sizeof(chunk), &read, nullptr) || read == 0)
+      return false;
+    buffer.append(chunk, read);
+  }
+}
+
+void ShardPool::CloseInput(Shard& shard) {
+  if (shard.input) {
+    CloseHandle((HANDLE)shard.input);
+    shard.input = nullptr;
+  }
+}
+
+void ShardPool::StopWorker(Shard& shard) {
+  if (shard.process) {
+    WaitForSingleObject((HANDLE)shard.process, INFINITE);
+    CloseHandle((HANDLE)shard.process);
+    shard.process = nullptr;
+  }
+  if (shard.output) {
+    CloseHandle((HANDLE)shard.output);
+    shard.output = nullptr;
+  }
+}
+
+#else
+
+std::string ShardPool::GetExecutablePath(const char* argv0) {
+#ifdef __APPLE__
+  char path[4096];
+  uint32_t size = sizeof(path);
+  if (_NSGetExecutablePath(path, &size) == 0)
+    return path;
+#else
+  char path[4096];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+  if (length > 0 && length < (ssize_t)sizeof(path))
+    return std::string(path, length);
+#endif
+  return argv0;
+}
+
+bool ShardPool::StartWorker(Shard& shard, const std::string& executable_path, uint32_t index) {
+  int to_worker[2];
+  int from_worker[2];
+  if (pipe(to_worker))
+    return false;
+  if (pipe(from_worker)) {
+    close(to_worker[0]);
+    close(to_worker[1]);
+    return false;
+  }
+
+  ///
+  /// Don't leak this worker's pipes into the workers started after it, or they'd keep its stdin
+  /// open after we close it.
+  ///
+  for (int fd : { to_worker[0], to_worker[1], from_worker[0], from_worker[1] })
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  std::string index_arg = std::to_string(index);
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(to_worker[0], STDIN_FILENO);
+    dup2(from_worker[1], STDOUT_FILENO);
+    execl(executable_path.c_str(), executable_path.c_str(), "--worker", index_arg.c_str(),
+          (char*)nullptr);
+    _exit(127);
+  }
+
+  close(to_worker[0]);
+  close(from_worker[1]);
+
+  if (pid < 0) {
+    close(to_worker[1]);
+    close(from_worker[0]);
+    return false;
+  }
+
+  shard.pid = pid;
+  shard.input = to_worker[1];
+  shard.output = from_worker[0];
+  return true;
+}
+
+bool ShardPool::WriteLine(Shard& shard, const std::string& line) {
+  if (shard.input < 0)
+    return false;
+
+  std::string data = line + "\n";
+  const char* pos = data.data();
+  size_t remaining = data.size();
+  while (remaining > 0) {
+    ssize_t written = write(shard.input, pos, remaining);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    pos += written;
+    remaining -= (size_t)written;
+  }
+  return true;
+}
+
+bool ShardPool::ReadLine(Shard& shard, std::string& buffer, std::string& line) {
+  while (true) {
+    size_t end = buffer.find('\n');
+    if (end != std::string::npos) {
+      line = buffer.substr(0, end);
+      buffer.erase(0, end + 1);
+      return true;
+    }
+
+    char chunk[4096];
+    ssize_t count = read(shard.output, chunk, sizeof(chunk));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    buffer.append(chunk, (size_t)count);
+  }
+}
+
+void ShardPool::CloseInput(Shard& shard) {
+  if (shard.input >= 0) {
+    close(shard.input);
+    shard.input = -1;
+  }
+}
+
+void ShardPool::StopWorker(Shard& shard) {
+  if (shard.pid > 0) {
+    int status;
+    while (waitpid(shard.pid, &status, 0) < 0 && errno == EINTR) {}
+    shard.pid = -1;
+  }
+  if (shard.output >= 0) {
+    close(shard.output);
+    shard.output = -1;
+  }
+}
+
+#endif
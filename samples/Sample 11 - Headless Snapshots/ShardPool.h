@@ -0,0 +1,111 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SnapshotJob.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+///
+/// Number of jobs we queue on a shard before it's considered full. Having one more queued than
+/// it's working on means a shard never waits on us between jobs.
+///
+#define MAX_JOBS_PER_SHARD 2
+
+///
+/// Runs snapshot jobs on a pool of worker processes ("shards"), each running its own
+/// SnapshotWorker (and Renderer) on its own core.
+///
+/// Workers are copies of this executable started with "--worker <index>", jobs and results are
+/// sent over their stdin and stdout one per line. Every job goes to the least-loaded shard: the
+/// one with the fewest jobs queued, then the one that has spent the least time rendering so far.
+///
+/// If a worker exits, the jobs it had are reported as failed and it's given no more work.
+///
+class ShardPool {
+public:
+  struct Completed {
+    SnapshotJob job;
+    SnapshotResult result;
+    uint32_t shard;
+  };
+
+  struct ShardStats {
+    uint64_t num_jobs = 0;
+    double busy_ms = 0;
+  };
+
+  ///
+  /// Start 'num_shards' workers and wait until they're ready. Check num_running() to see how
+  /// many actually started.
+  ///
+  ShardPool(const std::string& executable_path, uint32_t num_shards);
+
+  ///
+  /// Waits for all queued jobs, then shuts the workers down.
+  ///
+  ~ShardPool();
+
+  uint32_t num_shards() const { return (uint32_t)shards_.size(); }
+  uint32_t num_running() const;
+
+  ///
+  /// Queue a job on the least-loaded shard, blocks while every shard is full.
+  ///
+  void Submit(const SnapshotJob& job);
+
+  ///
+  /// Block until every submitted job has completed.
+  ///
+  void WaitAll();
+
+  ///
+  /// Jobs completed so far, in the order they completed.
+  ///
+  std::vector<Completed> completed() const;
+
+  ShardStats shard_stats(uint32_t shard) const;
+
+  ///
+  /// Path of the running executable, falls back to 'argv0' where we can't look it up.
+  ///
+  static std::string GetExecutablePath(const char* argv0);
+
+protected:
+  struct Shard {
+#ifdef _WIN32
+    void* process = nullptr;    // HANDLEs
+    void* input = nullptr;      // Worker's stdin
+    void* output = nullptr;     // Worker's stdout
+#else
+    pid_t pid = -1;
+    int input = -1;
+    int output = -1;
+#endif
+    bool is_running = false;
+    bool is_ready = false;
+    std::deque<SnapshotJob> queued;
+    ShardStats stats;
+    std::thread reader;
+  };
+
+  bool StartWorker(Shard& shard, const std::string& executable_path, uint32_t index);
+  bool WriteLine(Shard& shard, const std::string& line);
+  bool ReadLine(Shard& shard, std::string& buffer, std::string& line);
+  void CloseInput(Shard& shard);
+  void StopWorker(Shard& shard);
+  void ReaderMain(uint32_t index);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  size_t num_queued_ = 0;
+  std::vector<Completed> completed_;
+};
@@ -0,0 +1,61 @@
+#include "SnapshotJob.h"
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+static std::vector<std::string> SplitFields(const std::string& line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t end = line.find('\t', start);
+    fields.push_back(line.substr(start, end == std::string::npos ? end : end - start));
+    if (end == std::string::npos)
+      break;
+    start = end + 1;
+  }
+  return fields;
+}
+
+std::string FormatJob(const SnapshotJob& job) {
+  std::ostringstream stream;
+  stream << job.url << '\t' << job.png_path << '\t' << job.width << '\t' << job.height << '\t'
+         << job.virtual_time_ms << '\t' << job.idle_ms << '\t' << (job.full_page ? 1 : 0) << '\t'
+         << job.selector;
+  return stream.str();
+}
+
+bool ParseJob(const std::string& line, SnapshotJob& job) {
+  std::vector<std::string> fields = SplitFields(line);
+  if (fields.size() != 8 || fields[0].empty())
+    return false;
+
+  job.url = fields[0];
+  job.png_path = fields[1];
+  job.width = (uint32_t)strtoul(fields[2].c_str(), nullptr, 10);
+  job.height = (uint32_t)strtoul(fields[3].c_str(), nullptr, 10);
+  job.virtual_time_ms = (uint32_t)strtoul(fields[4].c_str(), nullptr, 10);
+  job.idle_ms = (uint32_t)strtoul(fields[5].c_str(), nullptr, 10);
+  job.full_page = fields[6] == "1";
+  job.selector = fields[7];
+  return job.width > 0 && job.height > 0;
+}
+
+std::string FormatResult(const SnapshotResult& result) {
+  std::ostringstream stream;
+  stream << (result.success ? "ok" : "error") << '\t' << result.ms << '\t' << result.timers_run
+         << '\t' << result.frames_run << '\t' << result.error;
+  return stream.str();
+}
+
+bool ParseResult(const std::string& line, SnapshotResult& result) {
+  std::vector<std::string> fields = SplitFields(line);
+  if (fields.size() != 5 || (fields[0] != "ok" && fields[0] != "error"))
+    return false;
+
+  result.success = fields[0] == "ok";
+  result.ms = strtod(fields[1].c_str(), nullptr);
+  result.timers_run = strtoull(fields[2].c_str(), nullptr, 10);
+  result.frames_run = strtoull(fields[3].c_str(), nullptr, 10);
+  result.error = fields[4];
+  return true;
+}
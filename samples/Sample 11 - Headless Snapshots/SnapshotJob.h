@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+///
+/// A page to load and render to a PNG.
+///
+/// Jobs are sent to worker processes one per line as tab-separated fields, which is why URLs and
+/// paths can't contain tabs or newlines.
+///
+struct SnapshotJob {
+  std::string url;
+  std::string png_path;   // Empty to render without saving
+  uint32_t width = 1280;
+  uint32_t height = 720;
+  uint32_t virtual_time_ms = 0;  // Page time to run on a VirtualClock before rendering, 0 to
+                                 // render as soon as the page loads (on the real clock)
+  uint32_t idle_ms = 0;          // Wait for the page to stay idle this long before rendering
+                                 // (see QuiescenceDetector), 0 to not wait
+  bool full_page = false;        // Capture the whole page instead of the viewport (TallCapture)
+  std::string selector;          // Capture just the first element matching this CSS selector
+                                 // (implies full_page)
+};
+
+struct SnapshotResult {
+  bool success = false;
+  double ms = 0;          // Time spent loading and rendering, in the worker
+  uint64_t timers_run = 0;  // Timers and animation frames the page's VirtualClock ran
+  uint64_t frames_run = 0;
+  std::string error;
+};
+
+std::string FormatJob(const SnapshotJob& job);
+bool ParseJob(const std::string& line, SnapshotJob& job);
+
+std::string FormatResult(const SnapshotResult& result);
+bool ParseResult(const std::string& line, SnapshotResult& result);
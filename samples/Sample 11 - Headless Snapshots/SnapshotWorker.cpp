@@ -0,0 +1,196 @@
+#include "SnapshotWorker.h"
+#include "Common.h"
+#include "TallCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+SnapshotWorker::SnapshotWorker(uint32_t shard_index) : shard_index_(shard_index) {
+  ///
+  /// Platform handlers are process-wide, every shard sets up its own copy.
+  ///
+  SetupPlatform(Config(), this);
+
+  renderer_ = Renderer::Create();
+}
+
+SnapshotWorker::~SnapshotWorker() {
+  renderer_ = nullptr;
+}
+
+int SnapshotWorker::Run(std::istream& in, std::ostream& out) {
+  ///
+  /// Creating the Renderer is the slow part of starting up, let the pool know we're done with it
+  /// so it doesn't count towards the first job.
+  ///
+  out << "ready" << std::endl;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    SnapshotJob job;
+    SnapshotResult result;
+    if (ParseJob(line, job))
+      Snapshot(job, result);
+    else
+      result.error = "Could not parse job";
+
+    ///
+    /// Keep the result on one line.
+    ///
+    std::replace(result.error.begin(), result.error.end(), '\t', ' ');
+    std::replace(result.error.begin(), result.error.end(), '\n', ' ');
+    std::replace(result.error.begin(), result.error.end(), '\r', ' ');
+
+    out << FormatResult(result) << std::endl;
+  }
+
+  return 0;
+}
+
+void SnapshotWorker::Snapshot(const SnapshotJob& job, SnapshotResult& result) {
+  auto start = std::chrono::steady_clock::now();
+
+  ViewConfig view_config;
+  view_config.is_accelerated = false;
+
+  RefPtr<View> view = renderer_->CreateView(job.width, job.height, view_config, nullptr);
+  view->set_load_listener(this);
+
+  load_state_ = LoadState::Loading;
+  load_error_.clear();
+  use_virtual_clock_ = job.virtual_time_ms > 0;
+  wait_for_idle_ = job.idle_ms > 0;
+  view->LoadURL(job.url.c_str());
+
+  while (load_state_ == LoadState::Loading) {
+    renderer_->Update();
+
+    if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(JOB_TIMEOUT_MS)) {
+      load_state_ = LoadState::Failed;
+      load_error_ = "Timed out loading " + job.url;
+      break;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  ///
+  /// Run the page's clock ahead in steps, updating in between so anything the page loads or
+  /// lays out along the way is picked up by the next step.
+  ///
+  VirtualClock::Stats clock_before = virtual_clock_.stats();
+  if (load_state_ == LoadState::Loaded && use_virtual_clock_) {
+    for (uint32_t elapsed = 0; elapsed < job.virtual_time_ms; elapsed += VIRTUAL_TIME_STEP_MS) {
+      uint32_t step = std::min(job.virtual_time_ms - elapsed, (uint32_t)VIRTUAL_TIME_STEP_MS);
+      if (!virtual_clock_.Advance(view.get(), step)) {
+        load_state_ = LoadState::Failed;
+        load_error_ = "Virtual clock was not installed in " + job.url;
+        break;
+      }
+
+      renderer_->Update();
+    }
+  }
+
+  if (load_state_ == LoadState::Loaded && wait_for_idle_)
+    WaitForIdle(view.get(), job);
+
+  if (load_state_ == LoadState::Loaded && !job.png_path.empty() &&
+      (job.full_page || !job.selector.empty())) {
+    ///
+    /// Tall captures render band by band as they go.
+    ///
+    TallCapture capture(renderer_.get());
+    if (!capture.Capture(view.get(), job.png_path, job.selector, load_error_))
+      load_state_ = LoadState::Failed;
+  } else if (load_state_ == LoadState::Loaded) {
+    renderer_->Render();
+
+    if (!job.png_path.empty()) {
+      BitmapSurface* surface = (BitmapSurface*)view->surface();
+      if (!surface->bitmap()->WritePNG(job.png_path.c_str())) {
+        load_state_ = LoadState::Failed;
+        load_error_ = "Could not write " + job.png_path;
+      }
+    }
+  }
+
+  view->set_load_listener(nullptr);
+  view = nullptr;
+
+  result.success = load_state_ == LoadState::Loaded;
+  result.error = load_error_;
+  result.timers_run = virtual_clock_.stats().timers_run - clock_before.timers_run;
+  result.frames_run = virtual_clock_.stats().frames_run - clock_before.frames_run;
+  result.ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+void SnapshotWorker::WaitForIdle(View* view, const SnapshotJob& job) {
+  QuiescenceDetector::Thresholds thresholds;
+  thresholds.quiet_period_ms = job.idle_ms;
+
+  ///
+  /// Timers on a VirtualClock only fire when we advance it, which we're done doing.
+  ///
+  if (use_virtual_clock_)
+    thresholds.reasons &= ~QuiescenceDetector::kPendingTimers;
+
+  quiescence_.Reset(thresholds);
+
+  auto start = std::chrono::steady_clock::now();
+  while (true) {
+    renderer_->Update();
+    renderer_->Render();
+
+    if (quiescence_.Poll(view))
+      return;
+
+    if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(IDLE_TIMEOUT_MS)) {
+      LogMessage(LogLevel::Warning, ("Rendering " + job.url + " before it went idle (" +
+                                     quiescence_.status().Describe() + ")").c_str());
+      return;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void SnapshotWorker::OnFinishLoading(ultralight::View* caller, uint64_t frame_id,
+                                     bool is_main_frame, const String& url) {
+  if (is_main_frame && load_state_ == LoadState::Loading)
+    load_state_ = LoadState::Loaded;
+}
+
+void SnapshotWorker::OnFailLoading(ultralight::View* caller, uint64_t frame_id,
+                                   bool is_main_frame, const String& url,
+                                   const String& description, const String& error_domain,
+                                   int error_code) {
+  if (is_main_frame) {
+    load_state_ = LoadState::Failed;
+    load_error_ = std::string("Could not load ") + url.utf8().data() + ": " +
+                  description.utf8().data();
+  }
+}
+
+void SnapshotWorker::OnWindowObjectReady(ultralight::View* caller, uint64_t frame_id,
+                                         bool is_main_frame, const String& url) {
+  if (!is_main_frame)
+    return;
+
+  ///
+  /// The detector has to go last so it sees the VirtualClock's timers.
+  ///
+  if (use_virtual_clock_)
+    virtual_clock_.Install(caller);
+  if (wait_for_idle_)
+    quiescence_.Install(caller);
+}
+
+void SnapshotWorker::LogMessage(LogLevel log_level, const String& message) {
+  std::cerr << "[shard " << shard_index_ << "] " << message.utf8().data() << std::endl;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <iostream>
+#include "SnapshotJob.h"
+#include "VirtualClock.h"
+#include "QuiescenceDetector.h"
+
+using namespace ultralight;
+
+///
+/// Give up on a page if it hasn't loaded after this many milliseconds.
+///
+#define JOB_TIMEOUT_MS 30000
+
+///
+/// Stop waiting for a loaded page to go idle after this many milliseconds and render it as it is
+/// (pages with endless animations never go idle).
+///
+#define IDLE_TIMEOUT_MS 10000
+
+///
+/// One shard: owns this process's Renderer and renders snapshot jobs one at a time.
+///
+/// Ultralight supports one Renderer per process (the Platform handlers it uses are process-wide
+/// singletons), so to use more than one core for snapshots we run one of these per worker process
+/// and let a ShardPool hand out the jobs.
+///
+class SnapshotWorker : public LoadListener,
+                       public Logger {
+public:
+  SnapshotWorker(uint32_t shard_index);
+  virtual ~SnapshotWorker();
+
+  ///
+  /// Print "ready", then read one job per line from 'in' and print one result per line to 'out',
+  /// until 'in' is closed. Returns the process exit code.
+  ///
+  int Run(std::istream& in, std::ostream& out);
+
+  ///
+  /// Load and render a single job, 'result' receives how it went.
+  ///
+  void Snapshot(const SnapshotJob& job, SnapshotResult& result);
+
+  ///
+  /// Inherited from LoadListener
+  ///
+  virtual void OnFinishLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                               const String& url) override;
+  virtual void OnFailLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                             const String& url, const String& description,
+                             const String& error_domain, int error_code) override;
+
+  ///
+  /// Inherited from LoadListener, installs the VirtualClock and QuiescenceDetector scripts into
+  /// pages that use them.
+  ///
+  virtual void OnWindowObjectReady(ultralight::View* caller, uint64_t frame_id,
+                                   bool is_main_frame, const String& url) override;
+
+  ///
+  /// Inherited from Logger, our stdout is reserved for results so we log to stderr.
+  ///
+  virtual void LogMessage(LogLevel log_level, const String& message) override;
+
+protected:
+  enum class LoadState { Loading, Loaded, Failed };
+
+  ///
+  /// Keep updating and rendering a loaded page until it's been idle for the job's idle_ms (or
+  /// we give up after IDLE_TIMEOUT_MS).
+  ///
+  void WaitForIdle(View* view, const SnapshotJob& job);
+
+  uint32_t shard_index_;
+  RefPtr<Renderer> renderer_;
+  LoadState load_state_ = LoadState::Loading;
+  std::string load_error_;
+  bool use_virtual_clock_ = false;
+  VirtualClock virtual_clock_;
+  bool wait_for_idle_ = false;
+  QuiescenceDetector quiescence_;
+};
@@ -0,0 +1,152 @@
+#include "TallCapture.h"
+#include "PNGStreamWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+///
+/// Quote 'text' as a JavaScript string literal.
+///
+static std::string QuoteJS(const std::string& text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+    case '"': result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n"; break;
+    case '\r': result += "\\r"; break;
+    case '\t': result += "\\t"; break;
+    default: result += c; break;
+    }
+  }
+  return result + "\"";
+}
+
+TallCapture::TallCapture(Renderer* renderer) : renderer_(renderer) {}
+
+bool TallCapture::Capture(View* view, const std::string& png_path, const std::string& selector,
+                          std::string& error) {
+  num_bands_ = 0;
+
+  Surface* surface = view->surface();
+  if (!surface) {
+    error = "Tall captures need a CPU-rendered View";
+    return false;
+  }
+
+  ///
+  /// Find the area to capture in CSS pixels, relative to the top of the document.
+  ///
+  std::string script;
+  if (selector.empty()) {
+    script = "(function() {"
+             "  var height = document.documentElement.scrollHeight;"
+             "  if (document.body)"
+             "    height = Math.max(height, document.body.scrollHeight);"
+             "  return '0 0 ' + window.innerWidth + ' ' + height;"
+             "})()";
+  } else {
+    script = "(function() {"
+             "  var element = document.querySelector(" + QuoteJS(selector) + ");"
+             "  if (!element)"
+             "    return '';"
+             "  var rect = element.getBoundingClientRect();"
+             "  return (rect.left + window.scrollX) + ' ' + (rect.top + window.scrollY) + ' ' +"
+             "         rect.width + ' ' + rect.height;"
+             "})()";
+  }
+
+  double x, y, width, height;
+  String area = view->EvaluateScript(script.c_str());
+  if (sscanf(area.utf8().data(), "%lf %lf %lf %lf", &x, &y, &width, &height) != 4) {
+    error = selector.empty() ? "Could not measure the page" : "No element matches " + selector;
+    return false;
+  }
+
+  ///
+  /// Convert to device pixels. We only scroll vertically, anything outside the viewport
+  /// horizontally is cut off.
+  ///
+  double scale = view->device_scale();
+  int left = std::max(0, (int)std::floor(x * scale));
+  int right = std::min((int)surface->width(), (int)std::ceil((x + width) * scale));
+  int top = std::max(0, (int)std::floor(y * scale));
+  int bottom = (int)std::ceil((y + height) * scale);
+  if (right <= left || bottom <= top) {
+    error = "Nothing to capture";
+    return false;
+  }
+
+  PNGStreamWriter writer;
+  if (!writer.Open(png_path, (uint32_t)(right - left), (uint32_t)(bottom - top))) {
+    error = "Could not write " + png_path;
+    return false;
+  }
+
+  std::vector<uint8_t> row((size_t)(right - left) * 4);
+  int row_index = top;
+  while (row_index < bottom) {
+    ///
+    /// Scroll the next row we need to the top of the viewport, the page may stop short of that
+    /// at its end so we read back where it actually scrolled to.
+    ///
+    char scroll_script[128];
+    snprintf(scroll_script, sizeof(scroll_script),
+             "window.scrollTo(0, %d); String(window.scrollY)", (int)(row_index / scale));
+    double scroll_y = atof(view->EvaluateScript(scroll_script).utf8().data());
+
+    renderer_->Update();
+    renderer_->Render();
+    num_bands_++;
+
+    int band_top = (int)std::lround(scroll_y * scale);
+    int band_bottom = std::min(band_top + (int)surface->height(), bottom);
+    if (band_top > row_index || band_bottom <= row_index) {
+      error = "Could not scroll to row " + std::to_string(row_index);
+      writer.Close();
+      return false;
+    }
+
+    ///
+    /// Surfaces are premultiplied BGRA, PNGs want straight RGBA.
+    ///
+    const uint8_t* pixels = (const uint8_t*)surface->LockPixels();
+    for (; row_index < band_bottom; ++row_index) {
+      const uint8_t* src = pixels + (size_t)(row_index - band_top) * surface->row_bytes() +
+                           (size_t)left * 4;
+      uint8_t* dest = row.data();
+      for (int i = left; i < right; ++i, src += 4, dest += 4) {
+        uint8_t alpha = src[3];
+        if (alpha == 255) {
+          dest[0] = src[2];
+          dest[1] = src[1];
+          dest[2] = src[0];
+        } else if (alpha) {
+          dest[0] = (uint8_t)std::min(255, (src[2] * 255 + alpha / 2) / alpha);
+          dest[1] = (uint8_t)std::min(255, (src[1] * 255 + alpha / 2) / alpha);
+          dest[2] = (uint8_t)std::min(255, (src[0] * 255 + alpha / 2) / alpha);
+        } else {
+          dest[0] = dest[1] = dest[2] = 0;
+        }
+        dest[3] = alpha;
+      }
+
+      if (!writer.WriteRow(row.data())) {
+        surface->UnlockPixels();
+        error = "Could not write " + png_path;
+        writer.Close();
+        return false;
+      }
+    }
+    surface->UnlockPixels();
+  }
+
+  if (!writer.Close()) {
+    error = "Could not write " + png_path;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <string>
+
+using namespace ultralight;
+
+///
+/// Saves a screenshot of a whole page (or of one element on it) that may be much taller than the
+/// View, without needing a View (and Surface) that tall.
+///
+/// We scroll the View through the area in viewport-high bands, render each one and stream its
+/// rows to a PNGStreamWriter, so peak memory is about one viewport of pixels no matter how tall
+/// the page is. The View must be CPU-rendered (is_accelerated = false).
+///
+/// Like any scrolling screenshot, position: fixed elements show up once per band, and the page
+/// height is measured once up front (content added while we scroll is cut off).
+///
+class TallCapture {
+public:
+  TallCapture(Renderer* renderer);
+
+  ///
+  /// Capture the page in 'view' to 'png_path'. If 'selector' isn't empty, only capture the
+  /// bounding box of the first element matching it. Returns false and sets 'error' on failure.
+  ///
+  bool Capture(View* view, const std::string& png_path, const std::string& selector,
+               std::string& error);
+
+  // Number of bands rendered by the last Capture().
+  uint32_t num_bands() const { return num_bands_; }
+
+protected:
+  Renderer* renderer_;
+  uint32_t num_bands_ = 0;
+};
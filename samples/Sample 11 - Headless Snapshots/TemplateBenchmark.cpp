@@ -0,0 +1,110 @@
+#include "TemplateBenchmark.h"
+#include "Common.h"
+#include "TemplateRenderer.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#define TEMPLATE_URL "file:///report.html"
+
+///
+/// A made-up invoice, as JSON.
+///
+static std::string MakeRecord(uint32_t index) {
+  std::ostringstream json;
+  json << "{\"id\": \"#" << 10000 + index << "\", \"customer\": \"Customer " << index % 97
+       << "\", \"date\": \"2020-" << 1 + index % 12 << "-" << 1 + index % 28 << "\", \"items\": [";
+
+  uint32_t num_items = 2 + index % 6;
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < num_items; ++i) {
+    uint32_t quantity = 1 + (index + i) % 5;
+    uint32_t amount = quantity * (5 + (index * 7 + i * 13) % 40);
+    total += amount;
+    json << (i ? ", " : "") << "{\"name\": \"Item " << (index + i) % 50 << "\", \"quantity\": "
+         << quantity << ", \"amount\": \"$" << amount << ".00\"}";
+  }
+
+  json << "], \"total\": \"$" << total << ".00\"}";
+  return json.str();
+}
+
+///
+/// Compare the pixels of two same-sized Views.
+///
+static bool SamePixels(View* a, View* b) {
+  Surface* surface_a = a->surface();
+  Surface* surface_b = b->surface();
+  if (surface_a->width() != surface_b->width() || surface_a->height() != surface_b->height())
+    return false;
+
+  const uint8_t* pixels_a = (const uint8_t*)surface_a->LockPixels();
+  const uint8_t* pixels_b = (const uint8_t*)surface_b->LockPixels();
+  bool same = true;
+  for (uint32_t y = 0; y < surface_a->height() && same; ++y)
+    same = !memcmp(pixels_a + y * surface_a->row_bytes(), pixels_b + y * surface_b->row_bytes(),
+                   surface_a->width() * 4);
+  surface_a->UnlockPixels();
+  surface_b->UnlockPixels();
+  return same;
+}
+
+int RunTemplateBenchmark(uint32_t num_records) {
+  SetupPlatform();
+
+  RefPtr<Renderer> renderer = Renderer::Create();
+  std::string error;
+
+  std::cout << "Rendering " << num_records << " records through " << TEMPLATE_URL << std::endl
+            << std::endl << "       mode   seconds   records/s   speedup" << std::endl;
+
+  ///
+  /// Baseline: load (parse, style, run scripts) the template again for every record.
+  ///
+  TemplateRenderer fresh(renderer.get(), 1280, 720);
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < num_records; ++i) {
+    if (!fresh.Load(TEMPLATE_URL, error) || !fresh.RenderRecord(MakeRecord(i), error)) {
+      std::cerr << "Record " << i << " failed: " << error << std::endl;
+      return 1;
+    }
+  }
+  double fresh_seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  ///
+  /// Instanced: load the template once, then only swap in each record's data.
+  ///
+  TemplateRenderer instanced(renderer.get(), 1280, 720);
+  start = std::chrono::steady_clock::now();
+  if (!instanced.Load(TEMPLATE_URL, error)) {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+  for (uint32_t i = 0; i < num_records; ++i) {
+    if (!instanced.RenderRecord(MakeRecord(i), error)) {
+      std::cerr << "Record " << i << " failed: " << error << std::endl;
+      return 1;
+    }
+  }
+  double instanced_seconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  std::cout << std::fixed << std::setprecision(2)
+            << std::setw(11) << "fresh" << std::setw(10) << fresh_seconds << std::setw(12)
+            << num_records / fresh_seconds << std::setw(9) << 1.0 << "x" << std::endl
+            << std::setw(11) << "instanced" << std::setw(10) << instanced_seconds
+            << std::setw(12) << num_records / instanced_seconds << std::setw(9)
+            << fresh_seconds / instanced_seconds << "x" << std::endl << std::endl;
+
+  ///
+  /// The last record went through every reset, it should come out exactly like a fresh load.
+  ///
+  bool same = SamePixels(fresh.view().get(), instanced.view().get());
+  std::cout << "Last record " << (same ? "matches" : "DIFFERS from") << " a fresh load"
+            << std::endl;
+
+  return same ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+///
+/// Renders 'num_records' invoice records through our report template (assets/report.html), first
+/// loading the template fresh for every record, then with a TemplateRenderer that loads it once,
+/// and prints records per second for both.
+///
+/// Sets up the Platform and creates the Renderer, so it must run in a process of its own.
+/// Returns the process exit code.
+///
+int RunTemplateBenchmark(uint32_t num_records);
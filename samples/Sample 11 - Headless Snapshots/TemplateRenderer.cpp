@@ -0,0 +1,106 @@
+#include "TemplateRenderer.h"
+#include <chrono>
+#include <thread>
+
+///
+/// Give up on a template if it hasn't loaded after this many milliseconds.
+///
+#define TEMPLATE_TIMEOUT_MS 30000
+
+//
+// Installed once the template has loaded: keeps a copy of the body as it was before any record
+// touched it, render(record) puts a fresh copy of it in place and fills it in.
+//
+static const char* kTemplateScript = R"JS(
+(function() {
+  if (window.__template)
+    return;
+
+  var pristine = document.body.cloneNode(true);
+
+  window.__template = {
+    render: function(record) {
+      document.documentElement.replaceChild(pristine.cloneNode(true), document.body);
+      window.scrollTo(0, 0);
+      renderRecord(record);
+      return "ok";
+    }
+  };
+})();
+)JS";
+
+TemplateRenderer::TemplateRenderer(Renderer* renderer, uint32_t width, uint32_t height)
+  : renderer_(renderer) {
+  ViewConfig view_config;
+  view_config.is_accelerated = false;
+
+  view_ = renderer_->CreateView(width, height, view_config, nullptr);
+  view_->set_load_listener(this);
+}
+
+TemplateRenderer::~TemplateRenderer() {
+  view_->set_load_listener(nullptr);
+  view_ = nullptr;
+}
+
+bool TemplateRenderer::Load(const std::string& url, std::string& error) {
+  auto start = std::chrono::steady_clock::now();
+
+  load_state_ = LoadState::Loading;
+  load_error_.clear();
+  view_->LoadURL(url.c_str());
+
+  while (load_state_ == LoadState::Loading) {
+    renderer_->Update();
+
+    if (std::chrono::steady_clock::now() - start >
+        std::chrono::milliseconds(TEMPLATE_TIMEOUT_MS)) {
+      load_state_ = LoadState::Failed;
+      load_error_ = "Timed out loading " + url;
+      break;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  if (load_state_ != LoadState::Loaded) {
+    error = load_error_;
+    return false;
+  }
+
+  view_->EvaluateScript(kTemplateScript);
+  return true;
+}
+
+bool TemplateRenderer::RenderRecord(const std::string& json, std::string& error) {
+  ///
+  /// JSON is a JavaScript literal, so the record can go straight into the call.
+  ///
+  String exception;
+  String result = view_->EvaluateScript(("__template.render(" + json + ")").c_str(), &exception);
+  if (std::string(result.utf8().data()) != "ok") {
+    error = exception.empty() ? "Template did not render" : exception.utf8().data();
+    return false;
+  }
+
+  renderer_->Update();
+  renderer_->Render();
+  return true;
+}
+
+void TemplateRenderer::OnFinishLoading(ultralight::View* caller, uint64_t frame_id,
+                                       bool is_main_frame, const String& url) {
+  if (is_main_frame && load_state_ == LoadState::Loading)
+    load_state_ = LoadState::Loaded;
+}
+
+void TemplateRenderer::OnFailLoading(ultralight::View* caller, uint64_t frame_id,
+                                     bool is_main_frame, const String& url,
+                                     const String& description, const String& error_domain,
+                                     int error_code) {
+  if (is_main_frame) {
+    load_state_ = LoadState::Failed;
+    load_error_ = std::string("Could not load ") + url.utf8().data() + ": " +
+                  description.utf8().data();
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <string>
+
+using namespace ultralight;
+
+///
+/// Renders many records through one page template, loading the template only once.
+///
+/// Loading the same template for every record means parsing its HTML and CSS and compiling its
+/// scripts over and over, when only the data differs. Instead we load the template once, keep a
+/// pristine copy of its <body>, and for each record swap in a fresh copy of that body and call
+/// the template's global renderRecord(record) function with the record's JSON.
+///
+/// Swapping the body resets the DOM (and scroll position) between records. Anything else a
+/// template keeps (global variables, listeners on window or document) carries over, so
+/// renderRecord() should only touch the body it's given.
+///
+class TemplateRenderer : public LoadListener {
+public:
+  TemplateRenderer(Renderer* renderer, uint32_t width, uint32_t height);
+  virtual ~TemplateRenderer();
+
+  ///
+  /// Load the template at 'url' and wait for it. Returns false and sets 'error' on failure.
+  ///
+  bool Load(const std::string& url, std::string& error);
+
+  ///
+  /// Reset the page, call renderRecord() with 'json' and render it. Returns false and sets
+  /// 'error' if the template threw.
+  ///
+  bool RenderRecord(const std::string& json, std::string& error);
+
+  RefPtr<View> view() { return view_; }
+
+  ///
+  /// Inherited from LoadListener
+  ///
+  virtual void OnFinishLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                               const String& url) override;
+  virtual void OnFailLoading(ultralight::View* caller, uint64_t frame_id, bool is_main_frame,
+                             const String& url, const String& description,
+                             const String& error_domain, int error_code) override;
+
+protected:
+  enum class LoadState { Loading, Loaded, Failed };
+
+  Renderer* renderer_;
+  RefPtr<View> view_;
+  LoadState load_state_ = LoadState::Loading;
+  std::string load_error_;
+};
@@ -0,0 +1,239 @@
+#include "VirtualClock.h"
+#include <cstdio>
+
+//
+// Installed into every page before any of its own scripts run.
+//
+// Nothing on the page sees real time anymore: clocks start at a fixed date (or zero) and only
+// move when advance() is called, which runs every timer and animation frame that comes due in
+// order, as fast as the callbacks allow.
+//
+static const char* kVirtualClockScript = R"JS(
+(function() {
+  if (window.__virtualClock)
+    return;
+
+  var FRAME_INTERVAL = 1000 / 60;
+  var START_DATE = Date.UTC(2020, 0, 1);
+  var MAX_CALLBACKS_PER_ADVANCE = 100000;
+
+  var now = 0;
+  var lastSync = 0;
+  var pauseStyle = null;
+
+  function invoke(callback, args) {
+    try {
+      if (typeof callback === "function")
+        callback.apply(window, args);
+      else
+        (0, eval)(String(callback));
+    } catch (e) {
+      console.error(e && e.stack ? e.stack : String(e));
+    }
+  }
+
+  // Clocks
+
+  var NativeDate = Date;
+  function VirtualDate() {
+    if (!(this instanceof VirtualDate))
+      return new NativeDate(START_DATE + now).toString();
+    if (!arguments.length)
+      return new NativeDate(START_DATE + now);
+    var args = [null].concat(Array.prototype.slice.call(arguments));
+    return new (Function.prototype.bind.apply(NativeDate, args))();
+  }
+  VirtualDate.prototype = NativeDate.prototype;
+  VirtualDate.now = function() { return START_DATE + now; };
+  VirtualDate.UTC = NativeDate.UTC;
+  VirtualDate.parse = NativeDate.parse;
+  window.Date = VirtualDate;
+
+  try {
+    Object.defineProperty(performance, "now", { configurable: true,
+      value: function() { return now; } });
+  } catch (e) {}
+
+  var seed = 0x2F6B3A1D;
+  Math.random = function() {
+    seed = (seed + 0x6D2B79F5) | 0;
+    var t = Math.imul(seed ^ (seed >>> 15), 1 | seed);
+    t = (t + Math.imul(t ^ (t >>> 7), 61 | t)) ^ t;
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+
+  // Timers
+
+  var timers = [];
+  var nextTimerId = 1;
+  var nextSequence = 1;
+
+  function addTimer(callback, delay, args, repeat) {
+    var id = nextTimerId++;
+    delay = Math.max(Number(delay) || 0, repeat ? 1 : 0);
+    timers.push({ id: id, time: now + delay, sequence: nextSequence++, delay: delay,
+                  callback: callback, args: args, repeat: repeat });
+    return id;
+  }
+
+  function clearTimer(id) {
+    for (var i = 0; i < timers.length; i++) {
+      if (timers[i].id === id) {
+        timers.splice(i, 1);
+        return;
+      }
+    }
+  }
+
+  // Earliest timer, timers due at the same time run in the order they were scheduled.
+  function nextTimer() {
+    var next = null;
+    for (var i = 0; i < timers.length; i++) {
+      var timer = timers[i];
+      if (!next || timer.time < next.time ||
+          (timer.time == next.time && timer.sequence < next.sequence))
+        next = timer;
+    }
+    return next;
+  }
+
+  window.setTimeout = function(callback, delay) {
+    return addTimer(callback, delay, Array.prototype.slice.call(arguments, 2), false);
+  };
+
+  window.setInterval = function(callback, delay) {
+    return addTimer(callback, delay, Array.prototype.slice.call(arguments, 2), true);
+  };
+
+  window.clearTimeout = clearTimer;
+  window.clearInterval = clearTimer;
+
+  // Animation frames
+
+  var frames = [];
+  var nextFrameId = 1;
+  var lastFrame = 0;
+
+  // Frames land on multiples of FRAME_INTERVAL, the next one is the first we haven't run yet
+  // that isn't in the past.
+  function nextFrameTime() {
+    var index = Math.max(lastFrame + 1, Math.ceil(now / FRAME_INTERVAL - 1e-6));
+    return index * FRAME_INTERVAL;
+  }
+
+  window.requestAnimationFrame = function(callback) {
+    var id = nextFrameId++;
+    frames.push({ id: id, callback: callback });
+    return id;
+  };
+
+  window.cancelAnimationFrame = function(id) {
+    for (var i = 0; i < frames.length; i++) {
+      if (frames[i].id === id) {
+        frames.splice(i, 1);
+        return;
+      }
+    }
+  };
+
+  // CSS animations
+
+  function syncAnimations() {
+    if (document.getAnimations) {
+      document.getAnimations().forEach(function(animation) {
+        try {
+          if (window.CSSTransition && animation instanceof CSSTransition) {
+            animation.finish();
+            return;
+          }
+
+          // Animations count from the step they first showed up in.
+          if (animation.__virtualStart === undefined)
+            animation.__virtualStart = lastSync;
+          animation.pause();
+          animation.currentTime = now - animation.__virtualStart;
+        } catch (e) {}
+      });
+    } else {
+      var parent = document.head || document.documentElement;
+      if (!parent)
+        return;
+
+      if (!pauseStyle) {
+        pauseStyle = document.createElement("style");
+        parent.appendChild(pauseStyle);
+      }
+
+      pauseStyle.textContent =
+        "*, *::before, *::after { animation-play-state: paused !important; " +
+        "animation-delay: " + (-now) + "ms !important; transition: none !important; }";
+    }
+
+    lastSync = now;
+  }
+
+  function advance(ms) {
+    var target = now + Math.max(Number(ms) || 0, 0);
+    var timersRun = 0;
+    var framesRun = 0;
+    var callbacks = 0;
+
+    while (callbacks < MAX_CALLBACKS_PER_ADVANCE) {
+      var timer = nextTimer();
+      var timerTime = timer ? Math.max(timer.time, now) : Infinity;
+      var frameTime = frames.length ? nextFrameTime() : Infinity;
+      if (Math.min(timerTime, frameTime) > target)
+        break;
+
+      if (timerTime <= frameTime) {
+        now = timerTime;
+        if (timer.repeat) {
+          timer.time = now + timer.delay;
+          timer.sequence = nextSequence++;
+        } else {
+          clearTimer(timer.id);
+        }
+
+        invoke(timer.callback, timer.args);
+        timersRun++;
+        callbacks++;
+      } else {
+        now = frameTime;
+        lastFrame = Math.round(frameTime / FRAME_INTERVAL);
+        var pending = frames;
+        frames = [];
+        for (var i = 0; i < pending.length; i++)
+          invoke(pending[i].callback, [now]);
+
+        framesRun++;
+        callbacks += pending.length;
+      }
+    }
+
+    now = target;
+    syncAnimations();
+    return timersRun + " " + framesRun;
+  }
+
+  window.__virtualClock = { advance: advance };
+})();
+)JS";
+
+void VirtualClock::Install(View* view) {
+  view->EvaluateScript(kVirtualClockScript);
+}
+
+bool VirtualClock::Advance(View* view, double ms) {
+  char script[96];
+  snprintf(script, sizeof(script), "window.__virtualClock ? __virtualClock.advance(%.3f) : ''",
+           ms);
+  String result = view->EvaluateScript(script);
+
+  unsigned long long timers_run, frames_run;
+  if (sscanf(result.utf8().data(), "%llu %llu", &timers_run, &frames_run) != 2)
+    return false;
+
+  stats_.timers_run += timers_run;
+  stats_.frames_run += frames_run;
+  return true;
+}
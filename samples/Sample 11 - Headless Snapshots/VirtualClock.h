@@ -0,0 +1,50 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+
+using namespace ultralight;
+
+///
+/// How much page time we advance between calls to Renderer::Update() (so resources the page
+/// requests in between still get a chance to load).
+///
+#define VIRTUAL_TIME_STEP_MS 100
+
+///
+/// Runs a page on a virtual clock instead of the real one, so a snapshot of an animated page
+/// can skip ahead through seconds of page time in a few milliseconds and come out the same
+/// every run.
+///
+/// WebCore's timers run on real time, so the clock is a script we install into the page before
+/// any of its own scripts run. It replaces:
+///
+///  - Date, Date.now() and performance.now(), which start at a fixed date / zero.
+///  - setTimeout/setInterval and requestAnimationFrame, which only fire when we advance time
+///    (animation frames every 1/60th of a second of page time).
+///  - Math.random(), which becomes a seeded generator.
+///
+/// CSS animations are paused and seeked to the virtual time (through the Web Animations API
+/// where available, otherwise with a negative animation-delay), CSS transitions are skipped to
+/// their end.
+///
+class VirtualClock {
+public:
+  struct Stats {
+    uint64_t timers_run = 0;
+    uint64_t frames_run = 0;
+  };
+
+  // Installs the virtual clock into a new page, call this from OnWindowObjectReady.
+  void Install(View* view);
+
+  ///
+  /// Advance the page's clock by 'ms', running every timer and animation frame that comes due
+  /// along the way in order. Returns false if the page has no virtual clock installed.
+  ///
+  bool Advance(View* view, double ms);
+
+  // Totals over every call to Advance().
+  const Stats& stats() const { return stats_; }
+
+protected:
+  Stats stats_;
+};
@@ -0,0 +1,395 @@
+#include <Ultralight/Ultralight.h>
+#include "ImageBenchmark.h"
+#include "LayoutBenchmark.h"
+#include "RasterBenchmark.h"
+#include "ShardPool.h"
+#include "TemplateBenchmark.h"
+#include "SnapshotWorker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+///
+/// Most shards the benchmark goes up to.
+///
+#define MAX_BENCHMARK_SHARDS 32
+
+///
+///  Welcome to Sample 11!
+///
+///  In this sample we'll render snapshots of many pages at once, using every core.
+///
+///  A Renderer (and the Platform handlers it uses) is a per-process singleton and renders on the
+///  thread that calls Update() / Render(), so one process can only snapshot one page at a time.
+///  To go faster we run several worker processes ("shards"), each with its own Renderer, and
+///  hand jobs to whichever is least busy.
+///
+///  Usage:
+///
+///    Sample11 [--shards N] [--virtual-time MS] [--idle MS] [--full-page]
+///             [--element SELECTOR] [url ...]
+///
+///                                          Save a snapshot of each url (default: our sample
+///                                          page) to snapshot_<n>.png, using N shards (default:
+///                                          one per core). With --virtual-time, each page is run
+///                                          MS milliseconds ahead on a VirtualClock first, so
+///                                          animated pages snapshot the same every run. With
+///                                          --idle, each page is rendered once it has stayed idle
+///                                          (no requests, timers, fonts, images or painting
+///                                          pending) for MS milliseconds, see QuiescenceDetector.
+///                                          --full-page captures each whole page instead of
+///                                          just the viewport, --element just the first element
+///                                          matching SELECTOR, see TallCapture.
+///
+///    Sample11 bench [max_shards] [jobs]     Render our sample page 'jobs' times (default 64)
+///                                          with 1, 2, 4, ... up to max_shards shards (default:
+///                                          one per core) and print the throughput of each.
+///
+///    Sample11 layout-bench [pages]          Compare layout-only Views (no surface, never
+///                                          painted, see NullSurface) against normal CPU Views:
+///                                          pages per second loading our sample page 'pages'
+///                                          times (default 200) and reading its geometry, and
+///                                          resident memory per loaded View.
+///
+///    Sample11 template-bench [records]      Render 'records' invoices (default 500) through a
+///                                          report template, loading it fresh for each record
+///                                          vs. loading it once with a TemplateRenderer, and
+///                                          compare records per second.
+///
+///    Sample11 image-bench [images]          Load a page of 'images' large images (default 120)
+///                                          at 60 FPS all at once, staged a few per frame, and
+///                                          pre-scaled to display size, and compare the frame-
+///                                          time spikes of each, see ImageBenchmark.
+///
+///    Sample11 raster-bench [max_threads]    Paint a 2x scale View on the CPU with 1, 2, 4, ...
+///    [pages]                               and max_threads renderer threads (default 16):
+///                                          pages per second loading our sample page 'pages'
+///                                          times (default 50) and milliseconds per animation
+///                                          frame, see RasterBenchmark.
+///
+///  Workers are this same executable started with "--worker <index>", see ShardPool.
+///
+
+static const char* kSnapshotUsage =
+  "Usage: Sample11 [--shards N] [--virtual-time MS] [--idle MS] [--full-page]\n"
+  "                [--element SELECTOR] [url ...]";
+
+static uint32_t DefaultShardCount() {
+  uint32_t cores = std::thread::hardware_concurrency();
+  return std::max(1u, std::min(cores, (uint32_t)MAX_BENCHMARK_SHARDS));
+}
+
+static int Snapshot(const std::string& executable_path, uint32_t num_shards,
+                    const SnapshotJob& options, const std::vector<std::string>& urls) {
+  ShardPool pool(executable_path, num_shards);
+  if (!pool.num_running()) {
+    std::cerr << "Could not start any workers" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Started " << pool.num_running() << " shards" << std::endl;
+
+  for (size_t i = 0; i < urls.size(); ++i) {
+    SnapshotJob job = options;
+    job.url = urls[i];
+    job.png_path = "snapshot_" + std::to_string(i) + ".png";
+    pool.Submit(job);
+  }
+
+  pool.WaitAll();
+
+  int failures = 0;
+  for (auto& completed : pool.completed()) {
+    if (completed.result.success) {
+      std::cout << "[shard " << completed.shard << "] Saved " << completed.job.url << " to "
+                << completed.job.png_path << " (" << completed.result.ms << " ms";
+      if (completed.job.virtual_time_ms) {
+        std::cout << ", " << completed.result.timers_run << " timers and "
+                  << completed.result.frames_run << " animation frames on the virtual clock";
+      }
+      std::cout << ")" << std::endl;
+    } else {
+      std::cout << "[shard " << completed.shard << "] Failed " << completed.job.url << ": "
+                << completed.result.error << std::endl;
+      failures++;
+    }
+  }
+
+  return failures ? 1 : 0;
+}
+
+static int Benchmark(const std::string& executable_path, uint32_t max_shards,
+                     uint32_t num_jobs) {
+  std::vector<uint32_t> shard_counts;
+  for (uint32_t count = 1; count < max_shards; count *= 2)
+    shard_counts.push_back(count);
+  shard_counts.push_back(max_shards);
+
+  std::cout << "Rendering file:///page.html " << num_jobs << " times per run ("
+            << std::thread::hardware_concurrency() << " cores)" << std::endl << std::endl
+            << " shards   seconds    jobs/s   speedup   efficiency" << std::endl;
+
+  double baseline_rate = 0;
+  for (uint32_t num_shards : shard_counts) {
+    ///
+    /// Workers are started (and have created their Renderer) before we start timing.
+    ///
+    ShardPool pool(executable_path, num_shards);
+    if (pool.num_running() != num_shards) {
+      std::cerr << "Only " << pool.num_running() << " of " << num_shards
+                << " workers started" << std::endl;
+      return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < num_jobs; ++i) {
+      SnapshotJob job;
+      job.url = "file:///page.html";
+      pool.Submit(job);
+    }
+    pool.WaitAll();
+
+    double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+    size_t failures = 0;
+    for (auto& completed : pool.completed())
+      if (!completed.result.success)
+        failures++;
+
+    double rate = num_jobs / seconds;
+    if (num_shards == 1)
+      baseline_rate = rate;
+    double speedup = baseline_rate > 0 ? rate / baseline_rate : 0;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << std::setw(7) << num_shards << std::setw(10) << seconds
+              << std::setw(10) << rate << std::setw(9) << speedup << "x"
+              << std::setw(12) << std::setprecision(0) << speedup / num_shards * 100 << "%";
+    if (failures)
+      std::cout << "   (" << failures << " failed)";
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
+
+///
+/// Run this executable again with 'args' and wait for it to exit, returns whether it exited
+/// with 0. Benchmarks run each configuration in a child of its own, the Renderer and Platform
+/// can only be set up once per process.
+///
+static bool RunChild(const std::string& executable_path, const std::string& args) {
+  std::string command = "\"" + executable_path + "\" " + args;
+#ifdef _WIN32
+  ///
+  /// cmd.exe strips the outermost quotes from the command line.
+  ///
+  command = "\"" + command + "\"";
+#endif
+
+  ///
+  /// Whatever we printed so far has to come before the child's output.
+  ///
+  std::cout << std::flush;
+  return std::system(command.c_str()) == 0;
+}
+
+static int LayoutBenchmark(const std::string& executable_path, uint32_t num_pages) {
+  std::cout << "Loading file:///page.html " << num_pages << " times per mode, "
+            << LAYOUT_BENCHMARK_VIEWS << " Views at once for memory" << std::endl << std::endl
+            << "    mode    pages/s   MB per View" << std::endl;
+
+  ///
+  /// Each mode runs in a fresh process, the Renderer and Platform can only be set up once per
+  /// process and memory is measured from a clean baseline.
+  ///
+  for (const char* mode : { "cpu", "layout" }) {
+    if (!RunChild(executable_path,
+                  std::string("--layout-bench-run ") + mode + " " + std::to_string(num_pages))) {
+      std::cerr << "Benchmark run for " << mode << " Views failed" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int ImageBenchmark(const std::string& executable_path, uint32_t num_images) {
+  std::string directory = WriteImageBenchmarkFiles(num_images);
+  if (directory.empty()) {
+    std::cerr << "Could not write the benchmark images to a temporary directory" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Loading " << num_images << " images drawn at 80x60 per mode" << std::endl
+            << std::endl << "          mode   load ms  frames   p95 ms   worst ms  over 16.7ms"
+            << std::endl;
+
+  ///
+  /// Each mode runs in a fresh process, so no mode finds images the last one already decoded.
+  ///
+  int result = 0;
+  for (const char* mode : { "eager", "staged", "display-size" }) {
+    if (!RunChild(executable_path, std::string("--image-bench-run ") + mode + " " +
+                                   std::to_string(num_images) + " \"" + directory + "\"")) {
+      std::cerr << "Benchmark run for " << mode << " images failed" << std::endl;
+      result = 1;
+      break;
+    }
+  }
+
+  RemoveImageBenchmarkFiles(directory, num_images);
+  return result;
+}
+
+static int RasterBenchmark(const std::string& executable_path, uint32_t max_threads,
+                           uint32_t num_pages) {
+  std::cout << "Painting a 1920x1080 View at 2x scale, " << num_pages << " page loads and "
+            << "an animation per thread count" << std::endl << std::endl
+            << "  threads   page loads/s   ms per anim frame" << std::endl;
+
+  ///
+  /// Each thread count runs in a fresh process, the Config can only be set once per process.
+  ///
+  ///
+  /// Powers of two, then 'max_threads' itself if it isn't one.
+  ///
+  for (uint32_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    if (!RunChild(executable_path, "--raster-bench-run " + std::to_string(threads) + " " +
+                                   std::to_string(num_pages))) {
+      std::cerr << "Benchmark run with " << threads << " threads failed" << std::endl;
+      return 1;
+    }
+
+    if (threads == max_threads)
+      break;
+  }
+
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2 && !strcmp(argv[1], "--worker")) {
+    SnapshotWorker worker((uint32_t)atoi(argv[2]));
+    return worker.Run(std::cin, std::cout);
+  }
+
+  if (argc > 3 && !strcmp(argv[1], "--layout-bench-run"))
+    return RunLayoutBenchmark(!strcmp(argv[2], "layout"), (uint32_t)atoi(argv[3]));
+
+  if (argc > 3 && !strcmp(argv[1], "--raster-bench-run"))
+    return RunRasterBenchmark((uint32_t)atoi(argv[2]), (uint32_t)atoi(argv[3]));
+
+  if (argc > 4 && !strcmp(argv[1], "--image-bench-run"))
+    return RunImageBenchmark(argv[4], argv[2], (uint32_t)atoi(argv[3]));
+
+  if (argc > 1 && !strcmp(argv[1], "template-bench")) {
+    uint32_t num_records = argc > 2 ? (uint32_t)atoi(argv[2]) : 500;
+    if (num_records < 1) {
+      std::cerr << "Usage: Sample11 template-bench [records]" << std::endl;
+      return 1;
+    }
+
+    return RunTemplateBenchmark(num_records);
+  }
+
+  std::string executable_path = ShardPool::GetExecutablePath(argv[0]);
+
+  if (argc > 1 && !strcmp(argv[1], "layout-bench")) {
+    uint32_t num_pages = argc > 2 ? (uint32_t)atoi(argv[2]) : 200;
+    if (num_pages < 1) {
+      std::cerr << "Usage: Sample11 layout-bench [pages]" << std::endl;
+      return 1;
+    }
+
+    return LayoutBenchmark(executable_path, num_pages);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "image-bench")) {
+    uint32_t num_images = argc > 2 ? (uint32_t)atoi(argv[2]) : 120;
+    if (num_images < 1 || num_images > IMAGE_BENCHMARK_MAX_IMAGES) {
+      std::cerr << "Usage: Sample11 image-bench [images], up to " << IMAGE_BENCHMARK_MAX_IMAGES
+                << " images" << std::endl;
+      return 1;
+    }
+
+    return ImageBenchmark(executable_path, num_images);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "raster-bench")) {
+    uint32_t max_threads = argc > 2 ? (uint32_t)atoi(argv[2]) : MAX_RASTER_BENCHMARK_THREADS;
+    uint32_t num_pages = argc > 3 ? (uint32_t)atoi(argv[3]) : 50;
+    if (max_threads < 1 || num_pages < 1) {
+      std::cerr << "Usage: Sample11 raster-bench [max_threads] [pages]" << std::endl;
+      return 1;
+    }
+
+    return RasterBenchmark(executable_path,
+                           std::min(max_threads, (uint32_t)MAX_RASTER_BENCHMARK_THREADS),
+                           num_pages);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    uint32_t max_shards = argc > 2 ? (uint32_t)atoi(argv[2]) : DefaultShardCount();
+    uint32_t num_jobs = argc > 3 ? (uint32_t)atoi(argv[3]) : 64;
+    if (max_shards < 1 || num_jobs < 1) {
+      std::cerr << "Usage: Sample11 bench [max_shards] [jobs]" << std::endl;
+      return 1;
+    }
+
+    return Benchmark(executable_path, std::min(max_shards, (uint32_t)MAX_BENCHMARK_SHARDS),
+                     num_jobs);
+  }
+
+  uint32_t num_shards = DefaultShardCount();
+  SnapshotJob options;
+  std::vector<std::string> urls;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--", 2)) {
+      urls.push_back(arg);
+      continue;
+    }
+
+    bool takes_value = !strcmp(arg, "--shards") || !strcmp(arg, "--virtual-time") ||
+                       !strcmp(arg, "--idle") || !strcmp(arg, "--element");
+    if (!takes_value && strcmp(arg, "--full-page")) {
+      std::cerr << "Unknown option: " << arg << std::endl << kSnapshotUsage << std::endl;
+      return 1;
+    }
+
+    if (takes_value && i + 1 >= argc) {
+      std::cerr << "Missing value for " << arg << std::endl << kSnapshotUsage << std::endl;
+      return 1;
+    }
+
+    if (!strcmp(arg, "--shards"))
+      num_shards = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(arg, "--virtual-time"))
+      options.virtual_time_ms = (uint32_t)std::max(0, atoi(argv[++i]));
+    else if (!strcmp(arg, "--idle"))
+      options.idle_ms = (uint32_t)std::max(0, atoi(argv[++i]));
+    else if (!strcmp(arg, "--element"))
+      options.selector = argv[++i];
+    else
+      options.full_page = true;
+  }
+
+  if (urls.empty())
+    urls.push_back("file:///page.html");
+
+  ///
+  /// No point in starting more shards than we have pages.
+  ///
+  num_shards = std::min(num_shards, (uint32_t)urls.size());
+
+  return Snapshot(executable_path, num_shards, options, urls);
+}
@@ -0,0 +1,218 @@
+#include "CAPIExtras.h"
+#include <string.h>
+
+///
+/// Get a ULString holding 'length' bytes of UTF-8 at 'data' (which may contain nulls and doesn't
+/// need to be null-terminated). Pass it to ReleaseBorrowedString() when done.
+///
+/// This still creates a ULString per call, the C API has no way to wrap the caller's memory. What
+/// bindings save is creating and destroying it themselves, two more calls across the boundary.
+///
+static ULString BorrowString(const char* data, size_t length) {
+  return ulCreateStringUTF8(data, length);
+}
+
+static void ReleaseBorrowedString(ULString str) {
+  ulDestroyString(str);
+}
+
+void ulxViewLoadURLUTF8(ULView view, const char* url, size_t url_length) {
+  ULString str = BorrowString(url, url_length);
+  ulViewLoadURL(view, str);
+  ReleaseBorrowedString(str);
+}
+
+void ulxViewLoadHTMLUTF8(ULView view, const char* html, size_t html_length) {
+  ULString str = BorrowString(html, html_length);
+  ulViewLoadHTML(view, str);
+  ReleaseBorrowedString(str);
+}
+
+ULString ulxViewEvaluateScriptUTF8(ULView view, const char* js, size_t js_length,
+                                   ULString* exception) {
+  ULString str = BorrowString(js, js_length);
+  ULString result = ulViewEvaluateScript(view, str, exception);
+  ReleaseBorrowedString(str);
+  return result;
+}
+
+size_t ulxStringCopyUTF8(ULString str, char* buffer, size_t capacity) {
+  const ULChar16* data = ulStringGetData(str);
+  size_t length = ulStringGetLength(str);
+  size_t needed = 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    unsigned int c = (unsigned short)data[i];
+
+    ///
+    /// Combine surrogate pairs, unpaired surrogates become U+FFFD.
+    ///
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length &&
+        (unsigned short)data[i + 1] >= 0xDC00 && (unsigned short)data[i + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + ((unsigned short)data[i + 1] - 0xDC00);
+      i++;
+    } else if (c >= 0xD800 && c <= 0xDFFF) {
+      c = 0xFFFD;
+    }
+
+    char bytes[4];
+    size_t num_bytes;
+    if (c < 0x80) {
+      bytes[0] = (char)c;
+      num_bytes = 1;
+    } else if (c < 0x800) {
+      bytes[0] = (char)(0xC0 | (c >> 6));
+      bytes[1] = (char)(0x80 | (c & 0x3F));
+      num_bytes = 2;
+    } else if (c < 0x10000) {
+      bytes[0] = (char)(0xE0 | (c >> 12));
+      bytes[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+      bytes[2] = (char)(0x80 | (c & 0x3F));
+      num_bytes = 3;
+    } else {
+      bytes[0] = (char)(0xF0 | (c >> 18));
+      bytes[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+      bytes[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+      bytes[3] = (char)(0x80 | (c & 0x3F));
+      num_bytes = 4;
+    }
+
+    // Never write part of a character.
+    if (needed + num_bytes <= capacity)
+      memcpy(buffer + needed, bytes, num_bytes);
+    else
+      capacity = needed;
+
+    needed += num_bytes;
+  }
+
+  return needed;
+}
+
+bool ulxBitmapLock(ULBitmap bitmap, ULXPixels* out) {
+  if (!bitmap || ulBitmapIsEmpty(bitmap))
+    return false;
+
+  out->pixels = ulBitmapLockPixels(bitmap);
+  out->width = ulBitmapGetWidth(bitmap);
+  out->height = ulBitmapGetHeight(bitmap);
+  out->row_bytes = ulBitmapGetRowBytes(bitmap);
+  out->bpp = ulBitmapGetBpp(bitmap);
+  out->format = ulBitmapGetFormat(bitmap);
+  out->dirty_bounds.left = 0;
+  out->dirty_bounds.top = 0;
+  out->dirty_bounds.right = (int)out->width;
+  out->dirty_bounds.bottom = (int)out->height;
+  return true;
+}
+
+void ulxBitmapUnlock(ULBitmap bitmap) {
+  ulBitmapUnlockPixels(bitmap);
+}
+
+bool ulxSurfaceLock(ULSurface surface, ULXPixels* out) {
+  if (!surface)
+    return false;
+
+  ULIntRect dirty = ulSurfaceGetDirtyBounds(surface);
+  if (dirty.right <= dirty.left || dirty.bottom <= dirty.top)
+    return false;
+
+  out->pixels = ulSurfaceLockPixels(surface);
+  out->width = ulSurfaceGetWidth(surface);
+  out->height = ulSurfaceGetHeight(surface);
+  out->row_bytes = ulSurfaceGetRowBytes(surface);
+  out->bpp = 4;
+  out->format = kBitmapFormat_BGRA8_UNORM_SRGB;
+  out->dirty_bounds = dirty;
+  return true;
+}
+
+void ulxSurfaceUnlock(ULSurface surface, bool clear_dirty_bounds) {
+  ulSurfaceUnlockPixels(surface);
+
+  if (clear_dirty_bounds)
+    ulSurfaceClearDirtyBounds(surface);
+}
+
+void ulxViewsResize(ULView* views, const unsigned int* sizes, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    ulViewResize(views[i], sizes[i * 2], sizes[i * 2 + 1]);
+}
+
+void ulxOverlaysResize(ULOverlay* overlays, const unsigned int* sizes, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    ulOverlayResize(overlays[i], sizes[i * 2], sizes[i * 2 + 1]);
+}
+
+void ulxViewsLoadURLUTF8(ULView* views, const char* const* urls, const size_t* url_lengths,
+                         size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    ulxViewLoadURLUTF8(views[i], urls[i], url_lengths[i]);
+}
+
+void ulxFireMouseEvents(const ULXMouseEvent* events, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const ULXMouseEvent* e = &events[i];
+    ULMouseEvent evt = ulCreateMouseEvent(e->type, e->x, e->y, e->button);
+    ulViewFireMouseEvent(e->view, evt);
+    ulDestroyMouseEvent(evt);
+  }
+}
+
+void ulxFireScrollEvents(const ULXScrollEvent* events, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const ULXScrollEvent* e = &events[i];
+    ULScrollEvent evt = ulCreateScrollEvent(e->type, e->delta_x, e->delta_y);
+    ulViewFireScrollEvent(e->view, evt);
+    ulDestroyScrollEvent(evt);
+  }
+}
+
+void ulxFireKeyEvents(const ULXKeyEvent* events, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const ULXKeyEvent* e = &events[i];
+    ULString text = ulCreateStringUTF8(e->text ? e->text : "", e->text ? e->text_length : 0);
+    ULString unmodified_text = ulCreateStringUTF8(e->unmodified_text ? e->unmodified_text : "",
+      e->unmodified_text ? e->unmodified_text_length : 0);
+    ULKeyEvent evt = ulCreateKeyEvent(e->type, e->modifiers, e->virtual_key_code,
+      e->native_key_code, text, unmodified_text, e->is_keypad, e->is_auto_repeat,
+      e->is_system_key);
+    ulViewFireKeyEvent(e->view, evt);
+    ulDestroyKeyEvent(evt);
+    ulDestroyString(text);
+    ulDestroyString(unmodified_text);
+  }
+}
+
+size_t ulxViewsGetDirtyBounds(ULView* views, ULIntRect* out_bounds, size_t count,
+                              bool clear_dirty_bounds) {
+  size_t num_dirty = 0;
+  for (size_t i = 0; i < count; ++i) {
+    ULSurface surface = ulViewGetSurface(views[i]);
+    ULIntRect empty = { 0, 0, 0, 0 };
+    out_bounds[i] = surface ? ulSurfaceGetDirtyBounds(surface) : empty;
+
+    if (out_bounds[i].right <= out_bounds[i].left || out_bounds[i].bottom <= out_bounds[i].top) {
+      out_bounds[i] = empty;
+      continue;
+    }
+
+    num_dirty++;
+    if (clear_dirty_bounds)
+      ulSurfaceClearDirtyBounds(surface);
+  }
+
+  return num_dirty;
+}
+
+size_t ulxViewsGetNeedsPaint(ULView* views, bool* out_needs_paint, size_t count) {
+  size_t num_needs_paint = 0;
+  for (size_t i = 0; i < count; ++i) {
+    out_needs_paint[i] = ulViewGetNeedsPaint(views[i]);
+    if (out_needs_paint[i])
+      num_needs_paint++;
+  }
+
+  return num_needs_paint;
+}
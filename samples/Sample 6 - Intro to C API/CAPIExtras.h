@@ -0,0 +1,166 @@
+#pragma once
+#include <AppCore/CAPI.h>
+
+///
+///  Extra C API entry points for language bindings.
+///
+///  These are built on top of the regular C API and are meant for bindings (Rust, Go, ...) where
+///  every call across the boundary shows up in profiles:
+///
+///   - Functions taking a UTF-8 pointer + length read the caller's memory (it doesn't need to be
+///     null-terminated or outlive the call) so bindings don't have to create and destroy a
+///     ULString around each call. One is still created internally (with ulCreateStringUTF8, so
+///     any UTF-8 works), these save calls, not allocations.
+///
+///   - Pixel access returns everything needed to read a bitmap or surface (pointer, stride, size,
+///     format and dirty bounds) from a single lock call.
+///
+///   - Batch functions resize, load, send input to and query many Views in one call, so driving
+///     a frame for N Views takes a constant number of calls instead of several per View.
+///
+///  Like the rest of the API, these may only be called from the thread the Renderer (or App)
+///  was created on.
+///
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///
+/// Load a URL into a View from a UTF-8 string that isn't null-terminated.
+///
+void ulxViewLoadURLUTF8(ULView view, const char* url, size_t url_length);
+
+///
+/// Load a string of HTML into a View from a UTF-8 string that isn't null-terminated.
+///
+void ulxViewLoadHTMLUTF8(ULView view, const char* html, size_t html_length);
+
+///
+/// Evaluate a UTF-8 string of JavaScript in a View, see ulViewEvaluateScript() for the meaning of
+/// 'exception' and the returned string (owned by the View, don't destroy it).
+///
+ULString ulxViewEvaluateScriptUTF8(ULView view, const char* js, size_t js_length,
+                                   ULString* exception);
+
+///
+/// Convert a string to UTF-8 in a buffer you provide. At most 'capacity' bytes are written (the
+/// output is not null-terminated), returns the number of bytes the whole string needs-- call it
+/// again with a larger buffer if that's more than 'capacity'.
+///
+size_t ulxStringCopyUTF8(ULString str, char* buffer, size_t capacity);
+
+///
+/// A locked view of a bitmap's or surface's pixels. Rows are 'row_bytes' apart, which may be
+/// more than 'width' * 'bpp'.
+///
+typedef struct {
+  void* pixels;
+  unsigned int width;
+  unsigned int height;
+  unsigned int row_bytes;
+  unsigned int bpp;
+  ULBitmapFormat format;
+
+  ///
+  /// The part of a surface that changed since it was last unlocked with clear_dirty_bounds set
+  /// (the whole bitmap for bitmaps).
+  ///
+  ULIntRect dirty_bounds;
+} ULXPixels;
+
+///
+/// Lock a bitmap's pixels, returns false (and doesn't lock) if the bitmap is empty.
+///
+bool ulxBitmapLock(ULBitmap bitmap, ULXPixels* out);
+
+void ulxBitmapUnlock(ULBitmap bitmap);
+
+///
+/// Lock the pixels of a surface (from ulViewGetSurface), returns false (and doesn't lock) if
+/// 'surface' is null (the View is accelerated) or nothing changed since you last cleared its
+/// dirty bounds. Surfaces are always BGRA8_UNORM_SRGB.
+///
+bool ulxSurfaceLock(ULSurface surface, ULXPixels* out);
+
+///
+/// Unlock a surface locked by ulxSurfaceLock(), optionally clearing its dirty bounds once you've
+/// copied them.
+///
+void ulxSurfaceUnlock(ULSurface surface, bool clear_dirty_bounds);
+
+///
+/// Resize 'count' Views, 'sizes' holds a width and height for each.
+///
+void ulxViewsResize(ULView* views, const unsigned int* sizes, size_t count);
+
+///
+/// Resize 'count' Overlays (and their Views), 'sizes' holds a width and height for each.
+///
+void ulxOverlaysResize(ULOverlay* overlays, const unsigned int* sizes, size_t count);
+
+///
+/// Load a URL into each of 'count' Views, 'urls' and 'url_lengths' hold a UTF-8 string for each
+/// (see ulxViewLoadURLUTF8).
+///
+void ulxViewsLoadURLUTF8(ULView* views, const char* const* urls, const size_t* url_lengths,
+                         size_t count);
+
+typedef struct {
+  ULView view;
+  ULMouseEventType type;
+  int x;
+  int y;
+  ULMouseButton button;
+} ULXMouseEvent;
+
+typedef struct {
+  ULView view;
+  ULScrollEventType type;
+  int delta_x;
+  int delta_y;
+} ULXScrollEvent;
+
+///
+/// See ulCreateKeyEvent() for what each field means, 'text' and 'unmodified_text' are UTF-8 and
+/// may be null.
+///
+typedef struct {
+  ULView view;
+  ULKeyEventType type;
+  unsigned int modifiers;
+  int virtual_key_code;
+  int native_key_code;
+  const char* text;
+  size_t text_length;
+  const char* unmodified_text;
+  size_t unmodified_text_length;
+  bool is_keypad;
+  bool is_auto_repeat;
+  bool is_system_key;
+} ULXKeyEvent;
+
+///
+/// Fire 'count' input events, in order, each at its own View.
+///
+void ulxFireMouseEvents(const ULXMouseEvent* events, size_t count);
+
+void ulxFireScrollEvents(const ULXScrollEvent* events, size_t count);
+
+void ulxFireKeyEvents(const ULXKeyEvent* events, size_t count);
+
+///
+/// Get the dirty bounds of each View's surface (empty if it has none or nothing changed), then
+/// optionally clear them. Returns the number of Views with something to repaint.
+///
+size_t ulxViewsGetDirtyBounds(ULView* views, ULIntRect* out_bounds, size_t count,
+                              bool clear_dirty_bounds);
+
+///
+/// Get whether each View needs to be painted, returns the number of Views that do.
+///
+size_t ulxViewsGetNeedsPaint(ULView* views, bool* out_needs_paint, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,6 @@
 #include <AppCore/CAPI.h>
 #include <JavaScriptCore/JavaScript.h>
+#include "CAPIExtras.h"
 
 ///
 ///  Welcome to Sample 6!
@@ -22,6 +23,13 @@
 ///  Both Ultralight and JavaScriptCore follow the same paradigm when it comes to
 ///  ownership/destruction: You should explicitly Destroy/Release anything you Create.
 ///
+///  __Bindings__
+///
+///  CAPIExtras.h has some extra entry points meant for language bindings: ones that take UTF-8
+///  strings as pointer + length (the caller doesn't create and destroy a ULString), ones that lock
+///  a bitmap or surface and return its pixels, stride and dirty bounds in one call, and batch
+///  versions of per-View calls (resizing, loading, input events, dirty state) that take arrays.
+///
 
 /// Various globals
 ULApp app = 0;
@@ -118,9 +126,12 @@ void Init() {
   ///  **Note**: You can configure the base path for the FileSystem in the Settings we passed to
   ///            ulCreateApp earlier.
   ///
-  ULString url = ulCreateString("file:///app.html");
-  ulViewLoadURL(view, url);
-  ulDestroyString(url);
+  ///  **Note**: This creates a ULString, passes it to ulViewLoadURL() and destroys it for us,
+  ///            and works on any UTF-8 string (it doesn't need a terminating null). It saves us
+  ///            the calls, not the ULString.
+  ///
+  const char url[] = "file:///app.html";
+  ulxViewLoadURLUTF8(view, url, sizeof(url) - 1);
 }
 
 ///
@@ -0,0 +1,146 @@
+#include "GLStreamBuffer.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+
+///
+/// glBufferStorage is GL 4.4 (or GL_ARB_buffer_storage), newer than the GL 3.3 functions our
+/// loader provides, so we look it up ourselves.
+///
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC_)(GLenum target, GLsizeiptr size,
+                                                const void* data, GLbitfield flags);
+
+static PFNGLBUFFERSTORAGEPROC_ GetBufferStorage() {
+  static bool loaded = false;
+  static PFNGLBUFFERSTORAGEPROC_ buffer_storage = nullptr;
+  if (!loaded) {
+    loaded = true;
+    if (glfwExtensionSupported("GL_ARB_buffer_storage"))
+      buffer_storage = (PFNGLBUFFERSTORAGEPROC_)glfwGetProcAddress("glBufferStorage");
+  }
+  return buffer_storage;
+}
+
+// Block until the GPU is done with everything queued before 'fence', then delete it.
+static void WaitForFence(GLsync& fence) {
+  if (!fence)
+    return;
+
+  while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+  glDeleteSync(fence);
+  fence = 0;
+}
+
+///
+/// We only ever bind our buffer to GL_COPY_WRITE_BUFFER to create and map it, that target
+/// isn't used for drawing so it doesn't disturb any vertex array state.
+///
+GLStreamBuffer::GLStreamBuffer(size_t segment_size) {
+  Create(segment_size);
+}
+
+GLStreamBuffer::~GLStreamBuffer() {
+  Destroy();
+}
+
+void GLStreamBuffer::Begin(size_t size) {
+  segment_ = (segment_ + 1) % STREAM_BUFFER_SEGMENTS;
+  used_ = 0;
+
+  if (size > segment_size_) {
+    ///
+    /// This frame doesn't fit, wait for the GPU to finish with every segment and reallocate.
+    ///
+    size_t new_size = std::max(size, segment_size_ * 2);
+    Destroy();
+    Create(new_size);
+    segment_ = 0;
+  }
+
+  WaitForFence(fences_[segment_]);
+
+  size_t offset = segment_ * segment_size_;
+  if (persistent_) {
+    data_ = persistent_data_ + offset;
+    return;
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+  data_ = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, segment_size_,
+    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void* GLStreamBuffer::Allocate(size_t size, size_t alignment, size_t& offset) {
+  if (!data_)
+    return nullptr;
+
+  size_t segment_start = segment_ * segment_size_;
+  size_t start = segment_start + used_;
+  start = (start + alignment - 1) / alignment * alignment;
+  if (start + size > segment_start + segment_size_)
+    return nullptr;
+
+  used_ = start + size - segment_start;
+  offset = start;
+  return data_ + (start - segment_start);
+}
+
+void GLStreamBuffer::End() {
+  if (!persistent_ && data_) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  data_ = nullptr;
+}
+
+void GLStreamBuffer::Fence() {
+  if (fences_[segment_])
+    glDeleteSync(fences_[segment_]);
+  fences_[segment_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GLStreamBuffer::Create(size_t segment_size) {
+  segment_size_ = segment_size;
+  size_t total_size = segment_size_ * STREAM_BUFFER_SEGMENTS;
+
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+
+  PFNGLBUFFERSTORAGEPROC_ buffer_storage = GetBufferStorage();
+  if (buffer_storage) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    buffer_storage(GL_COPY_WRITE_BUFFER, total_size, nullptr, flags);
+    persistent_data_ = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total_size, flags);
+  }
+
+  persistent_ = persistent_data_ != nullptr;
+  if (!persistent_)
+    glBufferData(GL_COPY_WRITE_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GLStreamBuffer::Destroy() {
+  for (auto& fence : fences_)
+    WaitForFence(fence);
+
+  if (persistent_) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  glDeleteBuffers(1, &buffer_);
+  buffer_ = 0;
+  persistent_data_ = nullptr;
+  persistent_ = false;
+}
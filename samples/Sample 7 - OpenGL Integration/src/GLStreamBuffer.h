@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+///
+/// Number of frames we let the GPU lag behind, each gets its own segment of a GLStreamBuffer.
+///
+#define STREAM_BUFFER_SEGMENTS 3
+
+///
+/// A ring of buffer memory we write a frame's worth of data into (eg, vertices or indices).
+///
+/// The buffer is split into STREAM_BUFFER_SEGMENTS segments. Each frame writes into the next
+/// segment and fences it once its draws have been queued, a segment is only written to again
+/// after its fence has signaled so we never overwrite data the GPU may still be reading.
+///
+/// When GL_ARB_buffer_storage is available the buffer is mapped once (persistent and coherent)
+/// and stays mapped. Otherwise (eg, macOS) each frame maps its segment unsynchronized, which is
+/// safe thanks to the fences.
+///
+class GLStreamBuffer {
+public:
+  GLStreamBuffer(size_t segment_size);
+  ~GLStreamBuffer();
+
+  GLuint buffer() const { return buffer_; }
+  bool is_persistent() const { return persistent_; }
+
+  ///
+  /// Start writing a frame of up to 'size' bytes into the next segment (waiting for the GPU to
+  /// finish with it if needed). Segments grow to fit, which reallocates the buffer, check
+  /// buffer() afterwards.
+  ///
+  void Begin(size_t size);
+
+  ///
+  /// Reserve 'size' bytes at an absolute buffer offset that is a multiple of 'alignment'.
+  /// Returns where to write them, or null if the frame doesn't fit what was passed to Begin().
+  ///
+  void* Allocate(size_t size, size_t alignment, size_t& offset);
+
+  ///
+  /// Finish writing, everything allocated since Begin() may be drawn from after this.
+  ///
+  void End();
+
+  ///
+  /// Call once the draws that read this frame's data have been issued.
+  ///
+  void Fence();
+
+protected:
+  void Create(size_t segment_size);
+  void Destroy();
+
+  GLuint buffer_ = 0;
+  bool persistent_ = false;
+  uint8_t* persistent_data_ = nullptr;
+  uint8_t* data_ = nullptr;         // Start of the current segment while writing
+  size_t segment_size_ = 0;
+  size_t segment_ = 0;
+  size_t used_ = 0;
+  GLsync fences_[STREAM_BUFFER_SEGMENTS] = {};
+};
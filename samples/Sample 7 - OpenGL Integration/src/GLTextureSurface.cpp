@@ -5,6 +5,8 @@
 #include <sstream>
 #include <string>
 
+uint64_t GLTextureSurface::next_id_ = 0;
+
 ///
 /// Custom Surface implementation that allows Ultralight to paint directly
 /// into an OpenGL PBO (pixel buffer object).
@@ -22,13 +24,11 @@ public:
 
   virtual ~GLPBOTextureSurface() {
     ///
-    /// Destroy our PBO and texture.
+    /// Destroy our PBO.
     ///
     if (pbo_id_) {
       glDeleteBuffers(1, &pbo_id_);
       pbo_id_ = 0;
-      glDeleteTextures(1, &texture_id_);
-      texture_id_ = 0;
     }
   }
 
@@ -64,13 +64,11 @@ public:
       return;
 
     ///
-    /// Destroy any existing PBO and texture.
+    /// Destroy any existing PBO.
     ///
     if (pbo_id_) {
       glDeleteBuffers(1, &pbo_id_);
       pbo_id_ = 0;
-      glDeleteTextures(1, &texture_id_);
-      texture_id_ = 0;
     }
 
     width_ = width;
@@ -85,51 +83,29 @@ public:
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_id_);
     glBufferData(GL_PIXEL_UNPACK_BUFFER, size_, 0, GL_DYNAMIC_DRAW);
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-
-    ///
-    /// Create our Texture object.
-    ///
-    glGenTextures(1, &texture_id_);
-    glBindTexture(GL_TEXTURE_2D, texture_id_);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-    glBindTexture(GL_TEXTURE_2D, 0);
   }
 
-  virtual GLuint GetTextureAndSyncIfNeeded() {
+  virtual void UploadToLayer(GLuint texture_array, GLint layer,
+                             const ultralight::IntRect& rect) override {
     ///
-    /// This is called when our application wants to draw this Surface to
-    /// an OpenGL quad. (We return an OpenGL texture handle)
+    /// This is called when our application wants to draw this Surface.
     ///
-    /// We take this opportunity to upload the PBO to the texture if the
-    /// pixels have changed since the last call (indicated by dirty_bounds()
-    /// being non-empty)
+    /// We upload the changed part of our PBO (pixel buffer object) straight into
+    /// the texture array. Setting the unpack row length lets GL pick the rect out
+    /// of our full-size rows, the last argument is an offset into the PBO.
     ///
-    if (!dirty_bounds().IsEmpty()) {
-      ///
-      /// Update our Texture from our PBO (pixel buffer object)
-      ///
-      glBindTexture(GL_TEXTURE_2D, texture_id_);
-      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_id_);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_,
-        0, GL_BGRA, GL_UNSIGNED_BYTE, 0);
-      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-      glBindTexture(GL_TEXTURE_2D, 0);
-
-      ///
-      /// Clear our Surface's dirty bounds to indicate we've handled any
-      /// pending modifications to our pixels.
-      ///
-      ClearDirtyBounds();
-    }
-
-    return texture_id_;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_id_);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width_);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.left, rect.top, layer, rect.width(),
+      rect.height(), 1, GL_BGRA, GL_UNSIGNED_BYTE,
+      (const void*)((size_t)rect.top * row_bytes_ + (size_t)rect.left * 4));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
   }
 
 protected:
-  GLuint texture_id_;
   GLuint pbo_id_ = 0;
   uint32_t width_;
   uint32_t height_;
@@ -172,12 +148,7 @@ public:
     Resize(width, height);
   }
 
-  virtual ~GLBitmapTextureSurface() {
-    if (bitmap_) {
-      bitmap_ = nullptr;
-      glDeleteTextures(1, &texture_id_);
-    }
-  }
+  virtual ~GLBitmapTextureSurface() {}
 
   virtual uint32_t width() const override { return bitmap_->width(); }
 
@@ -195,38 +166,22 @@ public:
     if (bitmap_ && bitmap_->width() == width && bitmap_->height() == height)
       return;
 
-    if (bitmap_) {
-      bitmap_ = nullptr;
-      glDeleteTextures(1, &texture_id_);
-    }
-
     bitmap_ = ultralight::Bitmap::Create(width, height, ultralight::BitmapFormat::BGRA8_UNORM_SRGB);
-
-    glGenTextures(1, &texture_id_);
-    glBindTexture(GL_TEXTURE_2D, texture_id_);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
   }
 
-  virtual GLuint GetTextureAndSyncIfNeeded() {
-    if (!dirty_bounds().IsEmpty()) {
-      // Update texture from bitmap
-      void* pixels = bitmap_->LockPixels();
-      glBindTexture(GL_TEXTURE_2D, texture_id_);
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmap_->width(), bitmap_->height(),
-        0, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
-      bitmap_->UnlockPixels();
-
-      // Clear dirty bounds
-      ClearDirtyBounds();
-    }
-
-    return texture_id_;
+  virtual void UploadToLayer(GLuint texture_array, GLint layer,
+                             const ultralight::IntRect& rect) override {
+    const uint8_t* pixels = (const uint8_t*)bitmap_->LockPixels();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap_->row_bytes() / 4);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.left, rect.top, layer, rect.width(),
+      rect.height(), 1, GL_BGRA, GL_UNSIGNED_BYTE,
+      pixels + (size_t)rect.top * bitmap_->row_bytes() + (size_t)rect.left * 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    bitmap_->UnlockPixels();
   }
 
 protected:
-  GLuint texture_id_;
   ultralight::RefPtr<ultralight::Bitmap> bitmap_;
-};
\ No newline at end of file
+};
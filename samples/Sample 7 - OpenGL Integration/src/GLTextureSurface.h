@@ -5,9 +5,24 @@
 
 class GLTextureSurface : public ultralight::Surface {
 public:
+  GLTextureSurface() : id_(++next_id_) {}
   virtual ~GLTextureSurface() {}
 
-  virtual GLuint GetTextureAndSyncIfNeeded() = 0;
+  ///
+  /// Unique for the lifetime of the process (unlike our address, which a new Surface may get
+  /// once we're destroyed).
+  ///
+  uint64_t id() const { return id_; }
+
+  ///
+  /// Upload 'rect' of our pixels into a layer of a GL_TEXTURE_2D_ARRAY (at the same offset).
+  ///
+  virtual void UploadToLayer(GLuint texture_array, GLint layer,
+                             const ultralight::IntRect& rect) = 0;
+
+protected:
+  uint64_t id_;
+  static uint64_t next_id_;
 };
 
 class GLTextureSurfaceFactory : public ultralight::SurfaceFactory {
@@ -0,0 +1,660 @@
+#include "GPUDriverGL.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// Forces the next BindRenderBuffer() to bind, used whenever someone else may have bound a
+// framebuffer.
+static const uint32_t kUnknownRenderBuffer = 0xFFFFFFFF;
+
+///
+/// Values of our 'texture_1_mode' uniform.
+///
+enum TextureMode {
+  TextureMode_None = 0,
+  TextureMode_BGRA = 1,
+  TextureMode_Alpha = 2,
+};
+
+static const char* kVertexShader = R"GLSL(
+layout(location = 0) in vec2 in_position;
+layout(location = 1) in vec4 in_color;
+layout(location = 3) in vec2 in_obj;
+#ifndef FILL_PATH
+layout(location = 2) in vec2 in_tex;
+layout(location = 4) in vec4 in_data0;
+#endif
+
+uniform mat4 transform;
+uniform vec2 viewport_size;
+
+out vec4 ex_color;
+out vec2 ex_tex;
+out vec2 ex_obj;
+flat out int ex_fill_type;
+
+void main() {
+  // 'transform' maps to render buffer pixels, we keep row 0 at the bottom of the texture so
+  // render buffers are laid out like every other texture (first row = top of the page).
+  vec4 position = transform * vec4(in_position, 0.0, 1.0);
+  gl_Position = vec4(position.xy / position.w / viewport_size * 2.0 - 1.0, 0.0, 1.0);
+  ex_color = in_color;
+  ex_obj = in_obj;
+#ifdef FILL_PATH
+  ex_tex = vec2(0.0);
+  ex_fill_type = -1;
+#else
+  ex_tex = in_tex;
+  ex_fill_type = int(in_data0.x + 0.5);
+#endif
+}
+)GLSL";
+
+static const char* kFragmentShader = R"GLSL(
+uniform sampler2D texture_1;
+uniform int texture_1_mode;
+uniform int clip_size;
+uniform mat4 clip[8];
+
+in vec4 ex_color;
+in vec2 ex_tex;
+in vec2 ex_obj;
+flat in int ex_fill_type;
+
+out vec4 out_color;
+
+// Coverage of a rounded-rect clip: origin and size, corner radii (x and y packed as two 16-bit
+// integers per float), then an affine transform into the clip's space and an 'inverse' flag.
+float ClipCoverage(mat4 clip, vec2 p) {
+  vec2 size = clip[0].zw;
+  vec2 q = vec2(p.x * clip[2].x + p.y * clip[2].z + clip[3].x,
+                p.x * clip[2].y + p.y * clip[2].w + clip[3].y) - clip[0].xy;
+
+  int corner = q.x < size.x * 0.5 ? (q.y < size.y * 0.5 ? 0 : 3) :
+                                    (q.y < size.y * 0.5 ? 1 : 2);
+  float radius_x = floor(clip[1][corner] / 65536.0);
+  float radius_y = floor(clip[1][corner] - radius_x * 65536.0);
+
+  vec2 d = max(-q, q - size);
+  float distance = min(max(d.x, d.y), 0.0) + length(max(d, 0.0));
+
+  if (radius_x > 0.0 && radius_y > 0.0) {
+    bool left = corner == 0 || corner == 3;
+    bool top = corner == 0 || corner == 1;
+    vec2 center = vec2(left ? radius_x : size.x - radius_x, top ? radius_y : size.y - radius_y);
+    if ((left ? q.x < center.x : q.x > center.x) && (top ? q.y < center.y : q.y > center.y))
+      distance = (length((q - center) / vec2(radius_x, radius_y)) - 1.0) * min(radius_x, radius_y);
+  }
+
+  if (clip[3].z != 0.0)
+    distance = -distance;
+
+  return clamp(0.5 - distance, 0.0, 1.0);
+}
+
+void main() {
+  vec4 color = ex_color;
+
+  // Fill types are stored in the first component of each vertex's data0, only image (1) and
+  // glyph (9) fills sample texture 1.
+  if (texture_1_mode != 0 && (ex_fill_type == 1 || ex_fill_type == 9)) {
+    vec4 texel = texture(texture_1, ex_tex);
+    color *= texture_1_mode == 2 ? vec4(texel.r) : texel;
+  }
+
+  for (int i = 0; i < clip_size; i++)
+    color *= ClipCoverage(clip[i], ex_obj);
+
+  out_color = color;
+}
+)GLSL";
+
+static GLuint CompileShader(GLenum type, const std::string& source) {
+  GLuint shader = glCreateShader(type);
+  const char* source_str = source.c_str();
+  glShaderSource(shader, 1, &source_str, nullptr);
+  glCompileShader(shader);
+
+  GLint status = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (!status) {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    fprintf(stderr, "Error compiling shader: %s\n", log);
+  }
+
+  return shader;
+}
+
+static size_t VertexSize(VertexBufferFormat format) {
+  return format == VertexBufferFormat::_2f_4ub_2f ? sizeof(Vertex_2f_4ub_2f)
+                                                  : sizeof(Vertex_2f_4ub_2f_2f_28f);
+}
+
+GPUDriverGL::GPUDriverGL() {
+  atlas_.reset(new TextureAtlas(ATLAS_SIZE));
+  vertex_stream_.reset(new GLStreamBuffer(VERTEX_STREAM_SIZE));
+  index_stream_.reset(new GLStreamBuffer(INDEX_STREAM_SIZE));
+
+  glGenVertexArrays(1, &fill_vao_);
+  glGenVertexArrays(1, &path_vao_);
+  SetupVertexArrays();
+
+  fill_program_ = CreateProgram(false);
+  path_program_ = CreateProgram(true);
+}
+
+GPUDriverGL::~GPUDriverGL() {
+  for (auto& i : render_buffers_)
+    glDeleteFramebuffers(1, &i.second);
+  for (auto& i : textures_)
+    ReleaseTexture(i.second);
+
+  glDeleteProgram(fill_program_.program);
+  glDeleteProgram(path_program_.program);
+  glDeleteVertexArrays(1, &fill_vao_);
+  glDeleteVertexArrays(1, &path_vao_);
+}
+
+GLuint GPUDriverGL::GetGLTexture(uint32_t texture_id) const {
+  return ResolveTexture(texture_id);
+}
+
+void GPUDriverGL::CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  LoadTexture(textures_[texture_id], bitmap);
+}
+
+void GPUDriverGL::UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) {
+  auto i = textures_.find(texture_id);
+  if (i == textures_.end())
+    return;
+
+  Texture& texture = i->second;
+
+  ///
+  /// Same-size images in our atlas are updated in place.
+  ///
+  if (!texture.texture && bitmap->width() == texture.width &&
+      bitmap->height() == texture.height && !bitmap->IsEmpty()) {
+    atlas_->Upload(texture.atlas_rect, (const uint8_t*)bitmap->LockPixels(), bitmap->row_bytes());
+    bitmap->UnlockPixels();
+    return;
+  }
+
+  ReleaseTexture(texture);
+  LoadTexture(texture, bitmap);
+}
+
+void GPUDriverGL::DestroyTexture(uint32_t texture_id) {
+  auto i = textures_.find(texture_id);
+  if (i == textures_.end())
+    return;
+
+  ReleaseTexture(i->second);
+  textures_.erase(i);
+}
+
+void GPUDriverGL::CreateRenderBuffer(uint32_t render_buffer_id, const RenderBuffer& buffer) {
+  GLuint framebuffer = 0;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         ResolveTexture(buffer.texture_id), 0);
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+    fprintf(stderr, "Render buffer %u is incomplete (0x%x)\n", render_buffer_id, status);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  bound_render_buffer_ = kUnknownRenderBuffer;
+
+  render_buffers_[render_buffer_id] = framebuffer;
+}
+
+void GPUDriverGL::DestroyRenderBuffer(uint32_t render_buffer_id) {
+  auto i = render_buffers_.find(render_buffer_id);
+  if (i == render_buffers_.end())
+    return;
+
+  glDeleteFramebuffers(1, &i->second);
+  render_buffers_.erase(i);
+}
+
+void GPUDriverGL::CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                 const IndexBuffer& indices) {
+  UpdateGeometry(geometry_id, vertices, indices);
+}
+
+void GPUDriverGL::UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                                 const IndexBuffer& indices) {
+  ///
+  /// We don't upload geometry here, it's streamed to the GPU along with the commands that use
+  /// it (so it can be batched with other geometry).
+  ///
+  Geometry& geometry = geometry_[geometry_id];
+  geometry.format = vertices.format;
+  geometry.vertices.assign(vertices.data, vertices.data + vertices.size);
+  geometry.indices.assign((const IndexType*)indices.data,
+                          (const IndexType*)(indices.data + indices.size));
+}
+
+void GPUDriverGL::DestroyGeometry(uint32_t geometry_id) {
+  geometry_.erase(geometry_id);
+}
+
+void GPUDriverGL::UpdateCommandList(const CommandList& list) {
+  command_list_.insert(command_list_.end(), list.commands, list.commands + list.size);
+}
+
+void GPUDriverGL::DrawCommandList() {
+  if (command_list_.empty())
+    return;
+
+  BuildBatches();
+  StreamBatches();
+
+  bound_render_buffer_ = kUnknownRenderBuffer;
+
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+
+  for (const Batch& batch : batches_)
+    DrawBatch(batch);
+
+  ///
+  /// The stream segments we just wrote can be reused once the GPU is done with these draws.
+  ///
+  vertex_stream_->Fence();
+  index_stream_->Fence();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDisable(GL_SCISSOR_TEST);
+  glDisable(GL_BLEND);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindVertexArray(0);
+  glUseProgram(0);
+
+  num_commands_ += command_list_.size();
+  command_list_.clear();
+}
+
+void GPUDriverGL::LoadTexture(Texture& texture, RefPtr<Bitmap> bitmap) {
+  texture.width = bitmap->width();
+  texture.height = bitmap->height();
+  texture.is_alpha = bitmap->format() == BitmapFormat::A8_UNORM;
+  texture.texture = 0;
+
+  ///
+  /// Small color images go in our atlas. Render buffer textures (empty bitmaps) and glyph
+  /// textures are never atlased.
+  ///
+  if (!bitmap->IsEmpty() && !texture.is_alpha && texture.width <= ATLAS_MAX_IMAGE_SIZE &&
+      texture.height <= ATLAS_MAX_IMAGE_SIZE &&
+      atlas_->Allocate(texture.width, texture.height, texture.atlas_rect, texture.atlas_slot)) {
+    atlas_->Upload(texture.atlas_rect, (const uint8_t*)bitmap->LockPixels(), bitmap->row_bytes());
+    bitmap->UnlockPixels();
+    return;
+  }
+
+  glGenTextures(1, &texture.texture);
+  glBindTexture(GL_TEXTURE_2D, texture.texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  if (bitmap->IsEmpty()) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texture.width, texture.height, 0, GL_BGRA,
+                 GL_UNSIGNED_BYTE, nullptr);
+  } else {
+    uint32_t bpp = texture.is_alpha ? 1 : 4;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap->row_bytes() / bpp);
+    glTexImage2D(GL_TEXTURE_2D, 0, texture.is_alpha ? GL_R8 : GL_RGBA8, texture.width,
+                 texture.height, 0, texture.is_alpha ? GL_RED : GL_BGRA, GL_UNSIGNED_BYTE,
+                 bitmap->LockPixels());
+    bitmap->UnlockPixels();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GPUDriverGL::ReleaseTexture(Texture& texture) {
+  if (texture.texture)
+    glDeleteTextures(1, &texture.texture);
+  else
+    atlas_->Free(texture.atlas_slot);
+
+  texture.texture = 0;
+}
+
+GLuint GPUDriverGL::ResolveTexture(uint32_t texture_id, const Texture** texture) const {
+  auto i = textures_.find(texture_id);
+  if (i == textures_.end())
+    return 0;
+
+  if (texture)
+    *texture = &i->second;
+
+  return i->second.texture ? i->second.texture : atlas_->texture();
+}
+
+bool GPUDriverGL::CanBatch(const GPUState& a, const GPUState& b) const {
+  if (a.render_buffer_id != b.render_buffer_id ||
+      (uint8_t)a.shader_type != (uint8_t)b.shader_type || a.enable_blend != b.enable_blend ||
+      a.viewport_width != b.viewport_width || a.viewport_height != b.viewport_height ||
+      a.clip_size != b.clip_size || a.enable_scissor != b.enable_scissor)
+    return false;
+
+  if (memcmp(a.transform.data, b.transform.data, sizeof(a.transform.data)))
+    return false;
+
+  for (uint8_t i = 0; i < a.clip_size && i < 8; ++i) {
+    if (memcmp(a.clip[i].data, b.clip[i].data, sizeof(a.clip[i].data)))
+      return false;
+  }
+
+  if (a.enable_scissor &&
+      (a.scissor_rect.left != b.scissor_rect.left || a.scissor_rect.top != b.scissor_rect.top ||
+       a.scissor_rect.right != b.scissor_rect.right ||
+       a.scissor_rect.bottom != b.scissor_rect.bottom))
+    return false;
+
+  ///
+  /// Different images can share a batch as long as they live in the same GL texture.
+  ///
+  return ResolveTexture(a.texture_1_id) == ResolveTexture(b.texture_1_id);
+}
+
+void GPUDriverGL::BuildBatches() {
+  parts_.clear();
+  batches_.clear();
+  vertex_bytes_ = 0;
+  index_bytes_ = 0;
+
+  for (size_t i = 0; i < command_list_.size(); ++i) {
+    const Command& command = command_list_[i];
+
+    if ((uint8_t)command.command_type == (uint8_t)CommandType::ClearRenderBuffer) {
+      batches_.push_back({ i, true, 0, 0, 0, 0, 0, 0 });
+      continue;
+    }
+
+    auto geometry = geometry_.find(command.geometry_id);
+    if (geometry == geometry_.end())
+      continue;
+
+    ///
+    /// Only the vertices this command's indices refer to are streamed.
+    ///
+    const Geometry& g = geometry->second;
+    size_t stride = VertexSize(g.format);
+    size_t num_vertices = g.vertices.size() / stride;
+    size_t first = command.indices_offset;
+    size_t last = std::min(first + command.indices_count, g.indices.size());
+    if (first >= last)
+      continue;
+
+    IndexType min_index = g.indices[first], max_index = g.indices[first];
+    for (size_t j = first; j < last; ++j) {
+      min_index = std::min(min_index, g.indices[j]);
+      max_index = std::max(max_index, g.indices[j]);
+    }
+    if (max_index >= num_vertices)
+      continue;
+
+    Batch* batch = batches_.empty() ? nullptr : &batches_.back();
+    if (!batch || batch->is_clear || parts_[batch->first_part].geometry->format != g.format ||
+        !CanBatch(command_list_[batch->command].gpu_state, command.gpu_state)) {
+      batches_.push_back({ i, false, parts_.size(), 0, 0, 0, 0, 0 });
+      batch = &batches_.back();
+
+      // Room to align the batch's first vertex and index.
+      vertex_bytes_ += stride;
+      index_bytes_ += sizeof(IndexType);
+    }
+
+    parts_.push_back({ i, &g, min_index, max_index });
+    batch->num_parts++;
+    batch->num_vertices += max_index - min_index + 1;
+    batch->num_indices += last - first;
+    vertex_bytes_ += (max_index - min_index + 1) * stride;
+    index_bytes_ += (last - first) * sizeof(IndexType);
+  }
+}
+
+void GPUDriverGL::StreamBatches() {
+  vertex_stream_->Begin(vertex_bytes_);
+  index_stream_->Begin(index_bytes_);
+
+  for (Batch& batch : batches_) {
+    if (batch.is_clear)
+      continue;
+
+    const Geometry* first_geometry = parts_[batch.first_part].geometry;
+    size_t stride = VertexSize(first_geometry->format);
+    bool is_path = first_geometry->format == VertexBufferFormat::_2f_4ub_2f;
+
+    ///
+    /// Vertices start at a multiple of the vertex size so they can be addressed with a base
+    /// vertex, indices are rebased to count from the batch's first vertex.
+    ///
+    size_t vertex_offset = 0;
+    uint8_t* vertices = (uint8_t*)vertex_stream_->Allocate(batch.num_vertices * stride, stride,
+                                                           vertex_offset);
+    IndexType* indices = (IndexType*)index_stream_->Allocate(
+      batch.num_indices * sizeof(IndexType), sizeof(IndexType), batch.index_offset);
+    if (!vertices || !indices) {
+      batch.num_indices = 0;
+      continue;
+    }
+
+    batch.base_vertex = (GLint)(vertex_offset / stride);
+
+    const Texture* texture = nullptr;
+    ResolveTexture(command_list_[batch.command].gpu_state.texture_1_id, &texture);
+    bool remap_tex = !is_path && texture && !texture->texture;
+    float atlas_size = (float)atlas_->size();
+
+    IndexType next_vertex = 0;
+    for (size_t p = batch.first_part; p < batch.first_part + batch.num_parts; ++p) {
+      const BatchPart& part = parts_[p];
+      const Command& command = command_list_[part.command];
+      size_t count = part.max_index - part.min_index + 1;
+
+      memcpy(vertices, part.geometry->vertices.data() + part.min_index * stride, count * stride);
+
+      ///
+      /// Move texture coordinates into the image's spot in our atlas.
+      ///
+      if (remap_tex) {
+        const Texture* part_texture = nullptr;
+        ResolveTexture(command.gpu_state.texture_1_id, &part_texture);
+        const IntRect& rect = part_texture->atlas_rect;
+        for (size_t v = 0; v < count; ++v) {
+          Vertex_2f_4ub_2f_2f_28f* vertex = (Vertex_2f_4ub_2f_2f_28f*)(vertices + v * stride);
+          vertex->tex[0] = (rect.left + vertex->tex[0] * rect.width()) / atlas_size;
+          vertex->tex[1] = (rect.top + vertex->tex[1] * rect.height()) / atlas_size;
+        }
+      }
+
+      const IndexType* src = part.geometry->indices.data() + command.indices_offset;
+      size_t num_indices = std::min((size_t)command.indices_count,
+                                    part.geometry->indices.size() - command.indices_offset);
+      for (size_t i = 0; i < num_indices; ++i)
+        *indices++ = src[i] - part.min_index + next_vertex;
+
+      vertices += count * stride;
+      next_vertex += (IndexType)count;
+    }
+  }
+
+  vertex_stream_->End();
+  index_stream_->End();
+
+  if (vertex_stream_->buffer() != vao_vertex_buffer_ ||
+      index_stream_->buffer() != vao_index_buffer_)
+    SetupVertexArrays();
+}
+
+void GPUDriverGL::DrawBatch(const Batch& batch) {
+  const GPUState& state = command_list_[batch.command].gpu_state;
+  BindRenderBuffer(state.render_buffer_id);
+
+  glViewport(0, 0, state.viewport_width, state.viewport_height);
+
+  if (batch.is_clear) {
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return;
+  }
+
+  if (!batch.num_indices)
+    return;
+
+  if (state.enable_scissor) {
+    ///
+    /// Row 0 of a render buffer is its top (see the vertex shader) so the scissor rect doesn't
+    /// need to be flipped.
+    ///
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(state.scissor_rect.left, state.scissor_rect.top, state.scissor_rect.width(),
+              state.scissor_rect.height());
+  } else {
+    glDisable(GL_SCISSOR_TEST);
+  }
+
+  if (state.enable_blend) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  } else {
+    glDisable(GL_BLEND);
+  }
+
+  bool is_path = parts_[batch.first_part].geometry->format == VertexBufferFormat::_2f_4ub_2f;
+  const Program& program = is_path ? path_program_ : fill_program_;
+  glUseProgram(program.program);
+
+  ///
+  /// GPUState is packed, copy its matrices out before handing them to GL.
+  ///
+  GLfloat transform[16];
+  memcpy(transform, state.transform.data, sizeof(transform));
+  glUniformMatrix4fv(program.transform, 1, GL_FALSE, transform);
+  glUniform2f(program.viewport_size, (GLfloat)state.viewport_width,
+              (GLfloat)state.viewport_height);
+
+  GLfloat clip[8 * 16];
+  GLint clip_size = std::min((GLint)state.clip_size, 8);
+  for (GLint i = 0; i < clip_size; ++i)
+    memcpy(clip + i * 16, state.clip[i].data, sizeof(GLfloat) * 16);
+  glUniform1i(program.clip_size, clip_size);
+  if (clip_size)
+    glUniformMatrix4fv(program.clip, clip_size, GL_FALSE, clip);
+
+  const Texture* texture = nullptr;
+  GLuint gl_texture = ResolveTexture(state.texture_1_id, &texture);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, gl_texture);
+  glUniform1i(program.texture_1_mode, !texture ? TextureMode_None :
+                                      texture->is_alpha ? TextureMode_Alpha : TextureMode_BGRA);
+
+  glBindVertexArray(is_path ? path_vao_ : fill_vao_);
+  glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)batch.num_indices, GL_UNSIGNED_INT,
+                           (const void*)batch.index_offset, batch.base_vertex);
+  num_draw_calls_++;
+}
+
+void GPUDriverGL::BindRenderBuffer(uint32_t render_buffer_id) {
+  if (render_buffer_id == bound_render_buffer_)
+    return;
+
+  auto i = render_buffers_.find(render_buffer_id);
+  glBindFramebuffer(GL_FRAMEBUFFER, i == render_buffers_.end() ? 0 : i->second);
+  bound_render_buffer_ = render_buffer_id;
+}
+
+void GPUDriverGL::SetupVertexArrays() {
+  vao_vertex_buffer_ = vertex_stream_->buffer();
+  vao_index_buffer_ = index_stream_->buffer();
+
+  ///
+  /// Both vertex formats start with position, color and (eventually) object coordinates at the
+  /// same attribute locations so the shaders can share them.
+  ///
+  glBindVertexArray(fill_vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, vao_vertex_buffer_);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao_index_buffer_);
+  GLsizei stride = sizeof(Vertex_2f_4ub_2f_2f_28f);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f_2f_28f, pos));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f_2f_28f, color));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f_2f_28f, tex));
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f_2f_28f, obj));
+  glEnableVertexAttribArray(4);
+  glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f_2f_28f, data0));
+
+  glBindVertexArray(path_vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, vao_vertex_buffer_);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao_index_buffer_);
+  stride = sizeof(Vertex_2f_4ub_2f);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f, pos));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f, color));
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride,
+                        (const void*)offsetof(Vertex_2f_4ub_2f, obj));
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GPUDriverGL::Program GPUDriverGL::CreateProgram(bool is_path) {
+  std::string header = is_path ? "#version 330 core\n#define FILL_PATH\n" : "#version 330 core\n";
+  GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, header + kVertexShader);
+  GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, header + kFragmentShader);
+
+  Program program;
+  program.program = glCreateProgram();
+  glAttachShader(program.program, vertex_shader);
+  glAttachShader(program.program, fragment_shader);
+  glLinkProgram(program.program);
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint status = 0;
+  glGetProgramiv(program.program, GL_LINK_STATUS, &status);
+  if (!status) {
+    char log[1024];
+    glGetProgramInfoLog(program.program, sizeof(log), nullptr, log);
+    fprintf(stderr, "Error linking shader program: %s\n", log);
+  }
+
+  program.transform = glGetUniformLocation(program.program, "transform");
+  program.viewport_size = glGetUniformLocation(program.program, "viewport_size");
+  program.texture_1_mode = glGetUniformLocation(program.program, "texture_1_mode");
+  program.clip_size = glGetUniformLocation(program.program, "clip_size");
+  program.clip = glGetUniformLocation(program.program, "clip");
+
+  glUseProgram(program.program);
+  glUniform1i(glGetUniformLocation(program.program, "texture_1"), 0);
+  glUseProgram(0);
+
+  return program;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <Ultralight/Ultralight.h>
+#include <Ultralight/platform/GPUDriver.h>
+#include <glad/glad.h>
+#include <map>
+#include <memory>
+#include <vector>
+#include "GLStreamBuffer.h"
+#include "TextureAtlas.h"
+
+///
+/// Constants for configuring the GPUDriver.
+///
+#define ATLAS_SIZE              2048        // Width and height of our texture atlas
+#define ATLAS_MAX_IMAGE_SIZE    256         // Larger textures get a GL texture of their own
+#define VERTEX_STREAM_SIZE      (4 << 20)   // Initial bytes of vertices per frame
+#define INDEX_STREAM_SIZE       (1 << 20)   // Initial bytes of indices per frame
+
+using namespace ultralight;
+
+///
+/// An OpenGL 3.3 core GPUDriver, used to render accelerated Views straight into GL textures.
+///
+/// Geometry is kept on the CPU and every frame the vertices and indices each command uses are
+/// streamed into a pair of GLStreamBuffers (persistently mapped when the driver supports it).
+/// Consecutive draws with the same state are merged into a single draw call as we go, indices
+/// are rebased so one batch can span many geometries.
+///
+/// Small images are packed into a TextureAtlas (with their texture coordinates remapped while
+/// streaming) so draws that sample different images can still be batched.
+///
+/// The shaders implement the Fill shader's solid, image and glyph fills, the FillPath shader,
+/// rounded-rect clips and scissoring. Other fill types (gradients, SDF rects and rounded rects,
+/// box shadows, ...) are drawn with their vertex color, so most pages don't look right yet and the
+/// sample only uses this driver when asked to (--gpu).
+///
+class GPUDriverGL : public GPUDriver {
+public:
+  GPUDriverGL();
+  virtual ~GPUDriverGL();
+
+  bool HasCommandsPending() const { return !command_list_.empty(); }
+
+  ///
+  /// Execute (and clear) all commands received via UpdateCommandList(). Leaves the default
+  /// framebuffer bound, and blending and scissoring disabled.
+  ///
+  void DrawCommandList();
+
+  ///
+  /// The GL texture backing a texture ID (eg, a View's render target), 0 if there is none.
+  ///
+  GLuint GetGLTexture(uint32_t texture_id) const;
+
+  size_t num_commands() const { return num_commands_; }
+  size_t num_draw_calls() const { return num_draw_calls_; }
+  size_t num_atlas_images() const { return atlas_->num_images(); }
+  bool is_persistent() const { return vertex_stream_->is_persistent(); }
+
+  // Inherited from GPUDriver
+  virtual void BeginSynchronize() override {}
+  virtual void EndSynchronize() override {}
+  virtual uint32_t NextTextureId() override { return next_texture_id_++; }
+  virtual void CreateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void UpdateTexture(uint32_t texture_id, RefPtr<Bitmap> bitmap) override;
+  virtual void DestroyTexture(uint32_t texture_id) override;
+  virtual uint32_t NextRenderBufferId() override { return next_render_buffer_id_++; }
+  virtual void CreateRenderBuffer(uint32_t render_buffer_id, const RenderBuffer& buffer) override;
+  virtual void DestroyRenderBuffer(uint32_t render_buffer_id) override;
+  virtual uint32_t NextGeometryId() override { return next_geometry_id_++; }
+  virtual void CreateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void UpdateGeometry(uint32_t geometry_id, const VertexBuffer& vertices,
+                              const IndexBuffer& indices) override;
+  virtual void DestroyGeometry(uint32_t geometry_id) override;
+  virtual void UpdateCommandList(const CommandList& list) override;
+
+protected:
+  struct Texture {
+    GLuint texture = 0;         // 0 if the image lives in our atlas
+    IntRect atlas_rect;
+    IntRect atlas_slot;         // All the atlas space reserved for the image, see TextureAtlas
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool is_alpha = false;      // A8 (eg, glyphs)
+  };
+
+  struct Geometry {
+    VertexBufferFormat format;
+    std::vector<uint8_t> vertices;
+    std::vector<IndexType> indices;
+  };
+
+  struct Program {
+    GLuint program = 0;
+    GLint transform = -1;
+    GLint viewport_size = -1;
+    GLint texture_1_mode = -1;
+    GLint clip_size = -1;
+    GLint clip = -1;
+  };
+
+  // The range of a command's geometry that goes into a batch.
+  struct BatchPart {
+    size_t command;
+    const Geometry* geometry;
+    IndexType min_index;
+    IndexType max_index;
+  };
+
+  // A clear, or commands that are drawn together using the state of the first.
+  struct Batch {
+    size_t command;
+    bool is_clear;
+    size_t first_part;
+    size_t num_parts;
+    size_t num_vertices;
+    size_t num_indices;
+    size_t index_offset;        // In bytes
+    GLint base_vertex;
+  };
+
+  void LoadTexture(Texture& texture, RefPtr<Bitmap> bitmap);
+  void ReleaseTexture(Texture& texture);
+  GLuint ResolveTexture(uint32_t texture_id, const Texture** texture = nullptr) const;
+  bool CanBatch(const GPUState& a, const GPUState& b) const;
+  void BuildBatches();
+  void StreamBatches();
+  void DrawBatch(const Batch& batch);
+  void BindRenderBuffer(uint32_t render_buffer_id);
+  void SetupVertexArrays();
+  Program CreateProgram(bool is_path);
+
+  uint32_t next_texture_id_ = 1;
+  uint32_t next_render_buffer_id_ = 1;
+  uint32_t next_geometry_id_ = 1;
+  std::map<uint32_t, Texture> textures_;
+  std::map<uint32_t, GLuint> render_buffers_;   // Render buffer ID -> framebuffer
+  std::map<uint32_t, Geometry> geometry_;
+  std::vector<Command> command_list_;
+
+  std::unique_ptr<TextureAtlas> atlas_;
+  std::unique_ptr<GLStreamBuffer> vertex_stream_;
+  std::unique_ptr<GLStreamBuffer> index_stream_;
+  GLuint fill_vao_ = 0;
+  GLuint path_vao_ = 0;
+  GLuint vao_vertex_buffer_ = 0;
+  GLuint vao_index_buffer_ = 0;
+  Program fill_program_;
+  Program path_program_;
+
+  std::vector<BatchPart> parts_;
+  std::vector<Batch> batches_;
+  size_t vertex_bytes_ = 0;
+  size_t index_bytes_ = 0;
+  uint32_t bound_render_buffer_ = 0xFFFFFFFF;
+
+  size_t num_commands_ = 0;
+  size_t num_draw_calls_ = 0;
+};
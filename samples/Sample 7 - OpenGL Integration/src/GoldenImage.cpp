@@ -0,0 +1,58 @@
+#include "GoldenImage.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+bool RGBImage::Load(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+
+  std::string magic;
+  int max_value = 0;
+  file >> magic >> width >> height >> max_value;
+  if (!file || magic != "P6" || max_value != 255 || !width || !height)
+    return false;
+
+  // Exactly one whitespace character separates the header from the pixel data.
+  file.get();
+
+  pixels.resize((size_t)width * height * 3);
+  file.read((char*)pixels.data(), pixels.size());
+  return file.gcount() == (std::streamsize)pixels.size();
+}
+
+bool RGBImage::Save(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+
+  file << "P6\n" << width << " " << height << "\n255\n";
+  file.write((const char*)pixels.data(), pixels.size());
+  return file.good();
+}
+
+ImageDiff CompareImages(const RGBImage& expected, const RGBImage& actual, int tolerance) {
+  ImageDiff diff;
+
+  if (expected.width != actual.width || expected.height != actual.height) {
+    diff.mismatched_pixels = std::max((size_t)expected.width * expected.height,
+                                      (size_t)actual.width * actual.height);
+    diff.max_channel_difference = 255;
+    return diff;
+  }
+
+  size_t num_pixels = (size_t)actual.width * actual.height;
+  for (size_t i = 0; i < num_pixels; ++i) {
+    int pixel_difference = 0;
+    for (size_t c = 0; c < 3; ++c)
+      pixel_difference = std::max(pixel_difference,
+        std::abs((int)expected.pixels[i * 3 + c] - (int)actual.pixels[i * 3 + c]));
+
+    diff.max_channel_difference = std::max(diff.max_channel_difference, pixel_difference);
+    if (pixel_difference > tolerance)
+      diff.mismatched_pixels++;
+  }
+
+  return diff;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///
+/// A tightly-packed RGB image, top row first. Stored on disk as binary PPM (P6) so goldens can
+/// be read and written without any image library.
+///
+struct RGBImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> pixels;
+
+  bool Load(const std::string& path);
+  bool Save(const std::string& path) const;
+};
+
+struct ImageDiff {
+  size_t mismatched_pixels = 0;
+  int max_channel_difference = 0;
+};
+
+///
+/// Compare two images of the same size. A pixel is mismatched when any of its channels differ by
+/// more than 'tolerance', a little slack is needed since rasterization and filtering vary
+/// slightly between drivers (eg, llvmpipe vs a hardware GPU).
+///
+ImageDiff CompareImages(const RGBImage& expected, const RGBImage& actual, int tolerance);
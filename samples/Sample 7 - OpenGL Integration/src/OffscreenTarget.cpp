@@ -0,0 +1,62 @@
+#include "OffscreenTarget.h"
+#include <cstdio>
+#include <cstring>
+
+OffscreenTarget::OffscreenTarget(uint32_t width, uint32_t height) {
+  glGenFramebuffers(1, &framebuffer_);
+  glGenRenderbuffers(1, &color_buffer_);
+  Resize(width, height);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  glDeleteRenderbuffers(1, &color_buffer_);
+  glDeleteFramebuffers(1, &framebuffer_);
+}
+
+void OffscreenTarget::Resize(uint32_t width, uint32_t height) {
+  if (width == width_ && height == height_)
+    return;
+
+  width_ = width;
+  height_ = height;
+
+  glBindRenderbuffer(GL_RENDERBUFFER, color_buffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer_);
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+    fprintf(stderr, "Offscreen framebuffer is incomplete (0x%x)\n", status);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenTarget::Bind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+}
+
+void OffscreenTarget::ReadPixels(std::vector<uint8_t>& rgb) {
+  size_t row_bytes = (size_t)width_ * 3;
+  rgb.resize(row_bytes * height_);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+  glReadPixels(0, 0, width_, height_, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  ///
+  /// GL returns the bottom row first, flip so images are stored the way they are viewed.
+  ///
+  std::vector<uint8_t> row(row_bytes);
+  for (uint32_t y = 0; y < height_ / 2; ++y) {
+    uint8_t* top = &rgb[y * row_bytes];
+    uint8_t* bottom = &rgb[(height_ - 1 - y) * row_bytes];
+    memcpy(row.data(), top, row_bytes);
+    memcpy(top, bottom, row_bytes);
+    memcpy(bottom, row.data(), row_bytes);
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+///
+/// An RGBA8 framebuffer object we composite into when running headless, so frames can be read
+/// back regardless of whether the context has a visible default framebuffer.
+///
+class OffscreenTarget {
+public:
+  OffscreenTarget(uint32_t width, uint32_t height);
+  ~OffscreenTarget();
+
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+
+  void Resize(uint32_t width, uint32_t height);
+
+  ///
+  /// Bind as the draw framebuffer, all subsequent drawing goes here.
+  ///
+  void Bind();
+
+  ///
+  /// Read back the current contents as tightly-packed RGB rows, top row first.
+  ///
+  void ReadPixels(std::vector<uint8_t>& rgb);
+
+protected:
+  GLuint framebuffer_ = 0;
+  GLuint color_buffer_ = 0;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+};
@@ -1,32 +1,79 @@
 #include "Sample.h"
 #include "GLTextureSurface.h"
+#include "GoldenImage.h"
 #include "WebTile.h"
 #include <AppCore/Platform.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <math.h>
+#include <string.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <thread>
 #include <chrono>
 
-// The vertices of our 3D quad
-const GLfloat GVertices[] = {
-  -1.0f, -1.0f, 0.0f,
-   1.0f, -1.0f, 0.0f,
-  -1.0f,  1.0f, 0.0f,
-   1.0f,  1.0f, 0.0f,
-};
-
-// The UV texture coordinates of our 3D quad
-const GLshort GTextures[] = {
-  0, 1,
-  1, 1,
-  0, 0,
-  1, 0,
-};
+// Column-major 4x4 matrix helpers for building tile transforms.
+static void MatrixIdentity(GLfloat m[16]) {
+  memset(m, 0, sizeof(GLfloat) * 16);
+  m[0] = m[5] = m[10] = m[15] = 1;
+}
+
+// result = a * b (result may not alias a or b)
+static void MatrixMultiply(const GLfloat a[16], const GLfloat b[16], GLfloat result[16]) {
+  for (int col = 0; col < 4; ++col) {
+    for (int row = 0; row < 4; ++row) {
+      GLfloat sum = 0;
+      for (int k = 0; k < 4; ++k)
+        sum += a[k * 4 + row] * b[col * 4 + k];
+      result[col * 4 + row] = sum;
+    }
+  }
+}
+
+// m = m * translate(x, y, z)
+static void MatrixTranslate(GLfloat m[16], GLfloat x, GLfloat y, GLfloat z) {
+  GLfloat t[16], result[16];
+  MatrixIdentity(t);
+  t[12] = x;
+  t[13] = y;
+  t[14] = z;
+  MatrixMultiply(m, t, result);
+  memcpy(m, result, sizeof(result));
+}
+
+// m = m * scale(x, y, z)
+static void MatrixScale(GLfloat m[16], GLfloat x, GLfloat y, GLfloat z) {
+  GLfloat s[16], result[16];
+  MatrixIdentity(s);
+  s[0] = x;
+  s[5] = y;
+  s[10] = z;
+  MatrixMultiply(m, s, result);
+  memcpy(m, result, sizeof(result));
+}
+
+// Milliseconds elapsed since 'start'.
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void PrintTimings(const char* name, std::vector<double> times) {
+  if (times.empty())
+    return;
+
+  std::sort(times.begin(), times.end());
+  double total = 0;
+  for (double time : times)
+    total += time;
+
+  printf("%s: avg %.3f ms, median %.3f ms, p95 %.3f ms, max %.3f ms\n", name,
+         total / times.size(), times[times.size() / 2], times[times.size() * 95 / 100],
+         times.back());
+}
 
 extern "C" {
 
@@ -37,37 +84,54 @@ static void GLFW_error_callback(int error, const char* description) {
 
 }
 
-Sample::Sample() {
+Sample::Sample(const SampleOptions& options) : options_(options) {
   glfwSetErrorCallback(GLFW_error_callback);
 
   if (!glfwInit())
     exit(EXIT_FAILURE);
 
-  const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-  int monitor_width = mode->width;
-  int monitor_height = mode->height;
+  int refresh_rate = 60;
 
-  // Make initial window size 80% of monitor's dimensions
-  width_ = static_cast<int>(monitor_width * 0.8);
-  height_ = static_cast<int>(monitor_height * 0.8);
+  if (options_.headless) {
+    ///
+    /// There may not be a monitor when headless, use the size we were given.
+    ///
+    width_ = (int)options_.width;
+    height_ = (int)options_.height;
+  } else {
+    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    int monitor_width = mode->width;
+    int monitor_height = mode->height;
+    refresh_rate = mode->refreshRate;
 
-  // Clamp initial window width to 1920 pixels
-  if (width_ > 1920) width_ = 1920;
+    // Make initial window size 80% of monitor's dimensions
+    width_ = static_cast<int>(monitor_width * 0.8);
+    height_ = static_cast<int>(monitor_height * 0.8);
+
+    // Clamp initial window width to 1920 pixels
+    if (width_ > 1920) width_ = 1920;
+  }
 
-  window_.reset(new Window(width_, height_, false));
+  window_.reset(new Window(width_, height_, false, options_.headless));
   window_->MoveToCenter();
   window_->set_listener(this);
   window_->SetTitle("Ultralight Sample 7 - OpenGL Integration");
 
   width_ = window_->width();
   height_ = window_->height();
-  
-  glOrtho(0, width_, 0, height_, -1, 1);
-  glEnable(GL_TEXTURE_2D);
+
+  compositor_.reset(new TileCompositor());
+
+  ///
+  /// When headless we composite into our own framebuffer so frames can be
+  /// read back.
+  ///
+  if (options_.headless)
+    offscreen_target_.reset(new OffscreenTarget(width_, height_));
 
   Config config;
-  config.scroll_timer_delay = 1.0 / (mode->refreshRate);
-  config.animation_timer_delay = 1.0 / (mode->refreshRate);
+  config.scroll_timer_delay = 1.0 / refresh_rate;
+  config.animation_timer_delay = 1.0 / refresh_rate;
 
   ///
   /// Pass our configuration to the Platform singleton so that the library
@@ -103,9 +167,20 @@ Sample::Sample() {
   ///
   /// Use a custom factory to create Surfaces backed by an OpenGL texture.
   ///
+  /// These are only used by CPU-rendered Views (the default, see --gpu).
+  ///
   surface_factory_.reset(new GLTextureSurfaceFactory());
   Platform::instance().set_surface_factory(surface_factory_.get());
 
+  ///
+  /// With --gpu our Views are accelerated and render with our own GPUDriver, straight into
+  /// textures we can composite without uploading anything.
+  ///
+  if (options_.gpu_views) {
+    gpu_driver_.reset(new GPUDriverGL());
+    Platform::instance().set_gpu_driver(gpu_driver_.get());
+  }
+
   ///
   /// Create our Renderer (you should only create this once per application).
   /// 
@@ -118,6 +193,24 @@ Sample::Sample() {
 
   addWebTileWithURL("file:///welcome.html", width_, height_);
 
+  if (options_.headless) {
+    ///
+    /// Lay out a few WebTiles side-by-side (not zoomed in) so every frame
+    /// exercises the perspective transforms and reflections, not just a 1:1
+    /// blit of the active WebTile.
+    ///
+    for (int i = 1; i < HEADLESS_TILE_COUNT; i++)
+      addWebTileWithURL("file:///welcome.html", width_, height_);
+
+    active_web_tile_ = HEADLESS_TILE_COUNT / 2;
+    offset_ = active_web_tile_;
+    web_tiles_[active_web_tile_]->view()->Focus();
+    zoom_direction_ = false;
+    zoom_start_ = -1;
+    zoom_end_ = 0;
+    return;
+  }
+
   // Set our first WebTile as active
   active_web_tile_ = 0;
   web_tiles_[0]->view()->Focus();
@@ -128,20 +221,28 @@ Sample::Sample() {
 }
 
 Sample::~Sample() {
+  std::cout << "Input: received " << window_->events_received() << " events, dispatched "
+            << window_->events_dispatched() << std::endl;
+
   web_tiles_.clear();
 
   renderer_ = nullptr;
 
+  gpu_driver_.reset();
+  offscreen_target_.reset();
+  compositor_.reset();
+
   glfwTerminate();
 }
 
 void Sample::addWebTileWithURL(const std::string& url, int width,
                                     int height) {
-  WebTile* tile = new WebTile(renderer_, width, height, window_->scale());
+  WebTile* tile = new WebTile(renderer_, width, height, window_->scale(), gpu_driver_ != nullptr);
 
-  tile->view()->LoadURL(url.c_str());
   tile->view()->set_view_listener(this);
   tile->view()->set_load_listener(this);
+  tile->view()->LoadURL(url.c_str());
+  pending_loads_++;
 
   web_tiles_.push_back(std::unique_ptr<WebTile>(tile));
 }
@@ -177,6 +278,12 @@ void Sample::Run() {
     else
       glfwPollEvents();
 
+    ///
+    /// Send the input we received to our Views (coalesced down to at most one
+    /// mouse move and one scroll per run of events).
+    ///
+    window_->DispatchInput();
+
     ///
     /// Allow Ultralight to update internal timers, JavaScript callbacks, and
     /// other resource callbacks.
@@ -217,6 +324,112 @@ void Sample::Run() {
   }
 }
 
+int Sample::RunHeadless() {
+  ///
+  /// Keep rendering until every WebTile has finished loading.
+  ///
+  auto load_start = std::chrono::steady_clock::now();
+  while (pending_loads_ > 0) {
+    if (MillisecondsSince(load_start) > HEADLESS_LOAD_TIMEOUT * 1000.0) {
+      fprintf(stderr, "Timed out waiting for %d WebTile(s) to load.\n", pending_loads_);
+      return EXIT_FAILURE;
+    }
+
+    glfwPollEvents();
+    window_->DispatchInput();
+    renderer_->Update();
+    renderer_->Render();
+    draw();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(4));
+  }
+
+  ///
+  /// Render our frames as fast as we can, timing each phase.
+  ///
+  size_t draw_calls_before = compositor_->num_draw_calls();
+  size_t driver_commands_before = gpu_driver_ ? gpu_driver_->num_commands() : 0;
+  size_t driver_draw_calls_before = gpu_driver_ ? gpu_driver_->num_draw_calls() : 0;
+  record_timings_ = true;
+
+  for (int i = 0; i < options_.frames; i++) {
+    ///
+    /// Input queued on the window (by GLFW or a script driving the run) reaches our Views the
+    /// same way it does in Run().
+    ///
+    glfwPollEvents();
+    window_->DispatchInput();
+    renderer_->Update();
+    renderer_->Render();
+
+    if (options_.full_upload)
+      compositor_->InvalidateLayers();
+
+    draw();
+  }
+
+  record_timings_ = false;
+
+  printf("Rendered %d frames at %dx%d (%d WebTiles)\n", options_.frames, width_, height_,
+         (int)web_tiles_.size());
+  PrintTimings(gpu_driver_ ? "GPUDriver" : "Upload", upload_times_);
+  PrintTimings("Draw", draw_times_);
+  if (options_.frames > 0) {
+    printf("Draw calls per frame: %.2f\n",
+           (compositor_->num_draw_calls() - draw_calls_before) / (double)options_.frames);
+
+    if (gpu_driver_) {
+      printf("GPUDriver per frame: %.2f commands in %.2f draw calls (%s stream buffers, "
+             "%zu images in atlas)\n",
+             (gpu_driver_->num_commands() - driver_commands_before) / (double)options_.frames,
+             (gpu_driver_->num_draw_calls() - driver_draw_calls_before) / (double)options_.frames,
+             gpu_driver_->is_persistent() ? "persistent" : "mapped", gpu_driver_->num_atlas_images());
+    }
+  }
+
+  if (options_.golden_path.empty())
+    return EXIT_SUCCESS;
+
+  return CompareWithGolden();
+}
+
+int Sample::CompareWithGolden() {
+  RGBImage actual;
+  actual.width = (uint32_t)width_;
+  actual.height = (uint32_t)height_;
+  offscreen_target_->ReadPixels(actual.pixels);
+
+  RGBImage expected;
+  if (options_.update_golden || !expected.Load(options_.golden_path)) {
+    if (!actual.Save(options_.golden_path)) {
+      fprintf(stderr, "Could not write golden image: %s\n", options_.golden_path.c_str());
+      return EXIT_FAILURE;
+    }
+
+    printf("Wrote golden image: %s\n", options_.golden_path.c_str());
+    return EXIT_SUCCESS;
+  }
+
+  ImageDiff diff = CompareImages(expected, actual, options_.tolerance);
+  size_t max_mismatched = (size_t)(actual.width * (size_t)actual.height * GOLDEN_MAX_MISMATCH);
+
+  printf("Golden comparison: %zu mismatched pixels (max channel difference %d)\n",
+         diff.mismatched_pixels, diff.max_channel_difference);
+
+  if (diff.mismatched_pixels > max_mismatched) {
+    ///
+    /// Keep the frame we rendered next to the golden so the two can be
+    /// compared by eye.
+    ///
+    std::string actual_path = options_.golden_path + ".actual.ppm";
+    actual.Save(actual_path);
+    fprintf(stderr, "Frame does not match golden image, wrote: %s\n", actual_path.c_str());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
 void Sample::draw() {
   double curTime = glfwGetTime();
   double zoom = 0;
@@ -235,58 +448,67 @@ void Sample::draw() {
     }
   }
 
-  if (is_active_web_tile_focused_) {
-    GLTextureSurface* surface = web_tiles_[active_web_tile_]->surface();
-
-    if (surface) {
-      int tileWidth = surface->width();
-      int tileHeight = surface->height();
-
-      glViewport(0,0,width_,height_);
-      glOrtho(0, width_, 0, height_, -1, 1);
-      glClear(GL_COLOR_BUFFER_BIT);
-      glMatrixMode(GL_PROJECTION);
-      glLoadIdentity();
-      glScalef(1,1,1);
-      glBindTexture(GL_TEXTURE_2D, surface->GetTextureAndSyncIfNeeded());
-      glColor4f(1,1,1,1);
-      glBegin(GL_QUADS);
-      glTexCoord2f(0,1);
-      glVertex3f(0, 0, 0.0f);
-      glTexCoord2f(1,1);
-      glVertex3f((GLfloat)tileWidth, 0, 0.0f);
-      glTexCoord2f(1,0);
-      glVertex3f((GLfloat)tileWidth, (GLfloat)tileHeight, 0.0f);
-      glTexCoord2f(0,0);
-      glVertex3f(0, (GLfloat)tileHeight, 0.0f);
-      glEnd();
-      glBindTexture(GL_TEXTURE_2D, 0);
-      window_->PresentFrame();
-    }
+  ///
+  /// When recording timings we wait for the GPU to go idle around each phase
+  /// so we measure the work itself, not just the time to queue it.
+  ///
+  if (record_timings_)
+    glFinish();
+
+  auto phase_start = std::chrono::steady_clock::now();
+
+  if (gpu_driver_) {
+    ///
+    /// Draw the command lists our Views generated during Render() into their render targets.
+    ///
+    gpu_driver_->DrawCommandList();
   } else {
-    glViewport(0,0,width_,height_);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
-    glClearColor(0,0,0,0);
-    glVertexPointer(3,GL_FLOAT,0,GVertices);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glTexCoordPointer(2, GL_SHORT, 0, GTextures);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glColorPointer(4, GL_FLOAT, 0, color_);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glEnable(GL_TEXTURE_2D);
+    ///
+    /// Upload any tiles that were re-painted since the last frame.
+    ///
+    std::vector<GLTextureSurface*> surfaces;
+    for (auto& tile : web_tiles_)
+      surfaces.push_back(tile->surface());
+    compositor_->UploadSurfaces(surfaces);
+  }
+
+  if (record_timings_) {
+    glFinish();
+    upload_times_.push_back(MillisecondsSince(phase_start));
+    phase_start = std::chrono::steady_clock::now();
+  }
+
+  if (offscreen_target_)
+    offscreen_target_->Bind();
+
+  compositor_->BeginFrame(width_, height_);
+
 #if TRANSPARENT
-    glEnable (GL_BLEND);
-    glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 #endif
-    glClear(GL_COLOR_BUFFER_BIT);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glScalef(1,1,1);
-    glTranslatef(0, 0, 0.5);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
 
+  if (is_active_web_tile_focused_) {
+    RefPtr<View> view = web_tiles_[active_web_tile_]->view();
+
+    ///
+    /// Draw the active tile 1:1 with the window's pixels, anchored to the
+    /// bottom-left corner.
+    ///
+    GLfloat tileWidth = view->width() / (GLfloat)width_;
+    GLfloat tileHeight = view->height() / (GLfloat)height_;
+
+    GLfloat m[16];
+    MatrixIdentity(m);
+    MatrixTranslate(m, tileWidth - 1, tileHeight - 1, 0);
+    MatrixScale(m, tileWidth, tileHeight, 1);
+
+    GLfloat colors[16];
+    for (int i = 0; i < 16; i++)
+      colors[i] = 1.0;
+
+    addTileInstance(active_web_tile_, m, colors);
+  } else {
     int i, len = (int)web_tiles_.size();
     int mid = (int)floor(offset_ + 0.5);
     int iStartPos = mid - (int)web_tiles_.size();
@@ -306,17 +528,22 @@ void Sample::draw() {
       drawTile(i, i - offset_, 0);
 
     drawTile(mid, mid - offset_, zoom);
+  }
+
+  ///
+  /// Draw every tile and reflection we queued above in one go.
+  ///
+  compositor_->Flush();
 
-    window_->PresentFrame();
+  if (record_timings_) {
+    glFinish();
+    draw_times_.push_back(MillisecondsSince(phase_start));
   }
+
+  window_->PresentFrame();
 }
 
 void Sample::drawTile(int index, double off, double zoom) {
-  GLTextureSurface* surface = web_tiles_[index]->surface();
-
-  if (!surface)
-    return;
-
   GLfloat m[16];
   memset(m,0,sizeof(m));
   m[10] = 1;
@@ -341,59 +568,79 @@ void Sample::drawTile(int index, double off, double zoom) {
 
   trans += f * 1.1;
 
+  GLfloat color[16];
   for (int i = 0; i < 16; i++)
-    color_[i] = 1.0;
+    color[i] = 1.0;
 
   if (f >= 0) {
-    color_[0] = color_[1] = color_[2] = 1 -
+    color[0] = color[1] = color[2] = 1 -
                                       (GLfloat)(f / FLANKSPREAD);
-    color_[8] = color_[9] = color_[10] = 1 -
+    color[8] = color[9] = color[10] = 1 -
                                       (GLfloat)(f / FLANKSPREAD);
   } else {
-    color_[4] = color_[5] = color_[6] = 1 -
+    color[4] = color[5] = color[6] = 1 -
                                       (GLfloat)(-f / FLANKSPREAD);
-    color_[12] = color_[13] = color_[14] = 1 -
+    color[12] = color[13] = color[14] = 1 -
                                       (GLfloat)(-f / FLANKSPREAD);
   }
 
+  ///
+  /// The projection just pushes everything back a bit, see translate(0, 0, 0.5).
+  ///
+  GLfloat transform[16], tile[16];
+  MatrixIdentity(transform);
+  MatrixTranslate(transform, 0, 0, 0.5f);
+  MatrixTranslate(transform, (GLfloat)trans, 0, 0);
+  MatrixScale(transform, (GLfloat)sc, (GLfloat)sc, 1);
+  MatrixMultiply(transform, m, tile);
 
-  glPushMatrix();
-  glBindTexture(GL_TEXTURE_2D, surface->GetTextureAndSyncIfNeeded());
-  glTranslatef((GLfloat)trans, 0, 0);
-  glScalef((GLfloat)sc, (GLfloat)sc, 1);
-  glMultMatrixf(m);
-  glColorPointer(4, GL_FLOAT, 0, color_);
-  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
+  addTileInstance(index, tile, color);
 
   // Draw reflection:
 
-  glTranslatef(0,-2,0);
-  glScalef(1,-1,1);
+  MatrixTranslate(tile, 0, -2, 0);
+  MatrixScale(tile, 1, -1, 1);
 
   const double darkness = 4.0;
 
   for (int i = 0; i < 16; i += 4) {
-    color_[i] = color_[i + 1] = color_[i + 2] = 
+    color[i] = color[i + 1] = color[i + 2] = 
       (GLfloat)(1.0 / darkness + 0.05);
   }
 
   if (f >= 0) {
-    color_[0] = color_[1] = color_[2] =
+    color[0] = color[1] = color[2] =
                            (GLfloat)((1- (f / FLANKSPREAD)) / darkness + 0.05);
 
   } else {
-    color_[4] = color_[5] = color_[6] =
+    color[4] = color[5] = color[6] =
                            (GLfloat)((1-(-f / FLANKSPREAD)) / darkness + 0.05);
 
   }
 
-  color_[8] = color_[9] = color_[10] = 0;
-  color_[12] = color_[13] = color_[14] = 0;
+  color[8] = color[9] = color[10] = 0;
+  color[12] = color[13] = color[14] = 0;
+
+  addTileInstance(index, tile, color);
+}
+
+void Sample::addTileInstance(int index, const GLfloat transform[16], const GLfloat colors[16]) {
+  if (!gpu_driver_) {
+    compositor_->AddInstance(index, transform, colors);
+    return;
+  }
 
-  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
-  glBindTexture(GL_TEXTURE_2D, 0);
+  ///
+  /// Accelerated Views render into a texture owned by our GPUDriver, we sample it directly. The
+  /// texture may be larger than the View so only part of it is used.
+  ///
+  RenderTarget target = web_tiles_[index]->view()->render_target();
+  if (target.is_empty)
+    return;
 
-  glPopMatrix();
+  compositor_->AddTextureInstance(gpu_driver_->GetGLTexture(target.texture_id),
+                                  target.uv_coords.right, target.uv_coords.bottom, transform,
+                                  colors);
 }
 
 void Sample::updateAnimationAtTime(double elapsed) {
@@ -577,8 +824,6 @@ void Sample::OnResize(uint32_t width, uint32_t height) {
   for (auto& i : web_tiles_) {
     i->view()->Resize(width, height);
   }
-
-  glViewport(0,0,width_,height_);
 }
 
 void Sample::OnChangeFocus(bool focused) {
@@ -704,7 +949,7 @@ RefPtr<View> Sample::OnCreateChildView(ultralight::View* caller,
   bool is_popup,
   const IntRect& popup_rect) {
   ViewConfig view_config;
-  view_config.is_accelerated = false;
+  view_config.is_accelerated = gpu_driver_ != nullptr;
   view_config.initial_device_scale = window_->scale();
   RefPtr<View> new_view = renderer_->CreateView(width_, height_, view_config, nullptr);
   WebTile* new_tile = new WebTile(new_view);
@@ -717,6 +962,14 @@ RefPtr<View> Sample::OnCreateChildView(ultralight::View* caller,
   return new_view;
 }
 
+void Sample::OnFinishLoading(ultralight::View* caller,
+  uint64_t frame_id,
+  bool is_main_frame,
+  const String& url) {
+  if (is_main_frame && pending_loads_ > 0)
+    pending_loads_--;
+}
+
 void Sample::OnFailLoading(ultralight::View* caller,
   uint64_t frame_id,
   bool is_main_frame,
@@ -724,6 +977,8 @@ void Sample::OnFailLoading(ultralight::View* caller,
   const String& description,
   const String& error_domain,
   int error_code) {
+  if (is_main_frame && pending_loads_ > 0)
+    pending_loads_--;
 }
 
 void Sample::LogMessage(LogLevel log_level,
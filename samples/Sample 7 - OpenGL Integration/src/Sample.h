@@ -5,6 +5,9 @@
 #include <memory>
 #include <Ultralight/platform/Logger.h>
 #include "GLTextureSurface.h"
+#include "GPUDriverGL.h"
+#include "OffscreenTarget.h"
+#include "TileCompositor.h"
 #include "Window.h"
 
 ///
@@ -17,10 +20,32 @@
 #define ZOOMTIME            0.3     // Speed to zoom in/out of a WebTile
 #define TRANSPARENT         1       // Whether or not we should use transparency
 
+///
+/// Constants for headless runs.
+///
+#define HEADLESS_TILE_COUNT     3     // Number of WebTiles to lay out side-by-side
+#define HEADLESS_LOAD_TIMEOUT   30.0  // Seconds to wait for all WebTiles to load
+#define GOLDEN_MAX_MISMATCH     0.001 // Fraction of pixels allowed to differ from the golden
+
 class WebTile;
 
 using namespace ultralight;
 
+///
+/// Command-line options, see main.cpp.
+///
+struct SampleOptions {
+  bool headless = false;
+  bool gpu_views = false;
+  uint32_t width = 1280;
+  uint32_t height = 720;
+  int frames = 120;
+  bool full_upload = false;
+  std::string golden_path;
+  bool update_golden = false;
+  int tolerance = 8;
+};
+
 ///
 /// Sample is responsible for all high-level logic.
 ///
@@ -29,17 +54,27 @@ class Sample : public WindowListener,
                public LoadListener,
                public Logger {
  public:
-  Sample();
+  Sample(const SampleOptions& options);
   ~Sample();
 
   void addWebTileWithURL(const std::string& url, int width, int height);
 
   void Run();
 
+  ///
+  /// Render a fixed number of frames offscreen once all WebTiles have loaded, then print how
+  /// long uploads and draws took and compare the last frame against a golden image.
+  ///
+  /// Returns the process exit code.
+  ///
+  int RunHeadless();
+
   void draw();
 
   void drawTile(int index, double off, double zoom);
 
+  void addTileInstance(int index, const GLfloat transform[16], const GLfloat colors[16]);
+
   void updateAnimationAtTime(double elapsed);
 
   void endAnimation();
@@ -89,6 +124,11 @@ class Sample : public WindowListener,
   /// Inherited from LoadListener:                                          ///
   /////////////////////////////////////////////////////////////////////////////
 
+  virtual void OnFinishLoading(ultralight::View* caller,
+                               uint64_t frame_id,
+                               bool is_main_frame,
+                               const String& url) override;
+
   virtual void OnFailLoading(ultralight::View* caller,
                              uint64_t frame_id,
                              bool is_main_frame,
@@ -105,6 +145,9 @@ class Sample : public WindowListener,
                           const String& message) override;
 
  protected:
+  int CompareWithGolden();
+
+  SampleOptions options_;
   bool should_quit_ = false;
   bool is_animating_ = false;
   bool is_dragging_ = false;
@@ -121,9 +164,15 @@ class Sample : public WindowListener,
   double zoom_end_;
   int active_web_tile_ = -1;
   int width_, height_;
+  int pending_loads_ = 0;
+  bool record_timings_ = false;
+  std::vector<double> upload_times_;
+  std::vector<double> draw_times_;
   std::vector<std::unique_ptr<WebTile>> web_tiles_;
-  GLfloat color_[16];
   RefPtr<Renderer> renderer_;
   std::unique_ptr<GLTextureSurfaceFactory> surface_factory_;
+  std::unique_ptr<GPUDriverGL> gpu_driver_;
+  std::unique_ptr<TileCompositor> compositor_;
+  std::unique_ptr<OffscreenTarget> offscreen_target_;
   std::unique_ptr<Window> window_;
 };
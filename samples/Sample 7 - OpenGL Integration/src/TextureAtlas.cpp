@@ -0,0 +1,198 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+
+using ultralight::IntRect;
+
+TextureAtlas::TextureAtlas(uint32_t size) : size_(size) {
+  glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size_, size_, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TextureAtlas::~TextureAtlas() {
+  glDeleteTextures(1, &texture_);
+}
+
+bool TextureAtlas::Allocate(uint32_t width, uint32_t height, IntRect& rect, IntRect& slot) {
+  uint32_t slot_width = width + ATLAS_GUTTER * 2;
+  uint32_t slot_height = height + ATLAS_GUTTER * 2;
+  if (slot_width > size_ || slot_height > size_)
+    return false;
+
+  ///
+  /// Prefer the smallest freed slot the image fits in.
+  ///
+  auto best = free_slots_.end();
+  for (auto i = free_slots_.begin(); i != free_slots_.end(); ++i) {
+    if ((uint32_t)i->width() < slot_width || (uint32_t)i->height() < slot_height)
+      continue;
+    if (best == free_slots_.end() ||
+        i->width() * i->height() < best->width() * best->height())
+      best = i;
+  }
+
+  if (best != free_slots_.end()) {
+    ///
+    /// Only take what we need, the parts to the right of and below the image stay free.
+    ///
+    IntRect free_slot = *best;
+    free_slots_.erase(best);
+    slot = { free_slot.left, free_slot.top, free_slot.left + (int)slot_width,
+             free_slot.top + (int)slot_height };
+    if (free_slot.right > slot.right)
+      free_slots_.push_back({ slot.right, free_slot.top, free_slot.right, free_slot.bottom });
+    if (free_slot.bottom > slot.bottom)
+      free_slots_.push_back({ free_slot.left, slot.bottom, slot.right, free_slot.bottom });
+  } else {
+    ///
+    /// Otherwise use the first shelf that's tall enough (but not wastefully so) and has room
+    /// left, or start a new shelf.
+    ///
+    Shelf* shelf = nullptr;
+    for (auto& i : shelves_) {
+      if (i.height >= slot_height && i.height <= slot_height * 2 &&
+          i.used_width + slot_width <= size_) {
+        shelf = &i;
+        break;
+      }
+    }
+
+    if (!shelf) {
+      if (next_shelf_y_ + slot_height > size_)
+        return false;
+
+      shelves_.push_back({ next_shelf_y_, slot_height, 0, 0 });
+      next_shelf_y_ += slot_height;
+      shelf = &shelves_.back();
+    }
+
+    slot = { (int)shelf->used_width, (int)shelf->y, (int)(shelf->used_width + slot_width),
+             (int)(shelf->y + shelf->height) };
+    shelf->used_width += slot_width;
+  }
+
+  ///
+  /// Images keep the top-left of their slot. A slot on a shelf taller than the image stays that
+  /// tall, the space below the image is unused until the slot is freed again.
+  ///
+  rect = { slot.left + ATLAS_GUTTER, slot.top + ATLAS_GUTTER,
+           slot.left + ATLAS_GUTTER + (int)width, slot.top + ATLAS_GUTTER + (int)height };
+  ShelfAt(slot.top).num_images++;
+  num_images_++;
+  return true;
+}
+
+void TextureAtlas::Free(const IntRect& slot) {
+  num_images_--;
+
+  ///
+  /// Once a shelf is empty, all of it is free again no matter how it was split up.
+  ///
+  Shelf& slot_shelf = ShelfAt(slot.top);
+  if (--slot_shelf.num_images == 0) {
+    free_slots_.erase(std::remove_if(free_slots_.begin(), free_slots_.end(),
+      [&](const IntRect& i) { return &ShelfAt(i.top) == &slot_shelf; }), free_slots_.end());
+    slot_shelf.used_width = 0;
+    return;
+  }
+
+  ///
+  /// Merge with free neighbors on our shelf that share a whole edge with us, until there are none
+  /// left. Pieces split off a slot in Allocate() join back up this way.
+  ///
+  IntRect merged = slot;
+  for (bool found = true; found;) {
+    found = false;
+    for (auto i = free_slots_.begin(); i != free_slots_.end(); ++i) {
+      if (&ShelfAt(i->top) != &slot_shelf)
+        continue;
+
+      bool same_rows = i->top == merged.top && i->bottom == merged.bottom;
+      bool same_columns = i->left == merged.left && i->right == merged.right;
+      if ((same_rows && (i->right == merged.left || i->left == merged.right)) ||
+          (same_columns && (i->bottom == merged.top || i->top == merged.bottom))) {
+        merged = { std::min(i->left, merged.left), std::min(i->top, merged.top),
+                   std::max(i->right, merged.right), std::max(i->bottom, merged.bottom) };
+        free_slots_.erase(i);
+        found = true;
+        break;
+      }
+    }
+  }
+
+  ///
+  /// A slot at the end of its shelf goes back to the shelf, along with any free slots that then
+  /// end up at its end.
+  ///
+  for (auto& shelf : shelves_) {
+    if (merged.top != (int)shelf.y || merged.bottom != (int)(shelf.y + shelf.height))
+      continue;
+
+    while (merged.right == (int)shelf.used_width) {
+      shelf.used_width = (uint32_t)merged.left;
+
+      auto tail = std::find_if(free_slots_.begin(), free_slots_.end(), [&](const IntRect& i) {
+        return i.top == merged.top && i.bottom == merged.bottom &&
+               i.right == (int)shelf.used_width;
+      });
+      if (tail == free_slots_.end())
+        return;
+
+      merged = *tail;
+      free_slots_.erase(tail);
+    }
+    break;
+  }
+
+  free_slots_.push_back(merged);
+}
+
+TextureAtlas::Shelf& TextureAtlas::ShelfAt(int y) {
+  for (auto& shelf : shelves_) {
+    if (y >= (int)shelf.y && y < (int)(shelf.y + shelf.height))
+      return shelf;
+  }
+  return shelves_.back();
+}
+
+void TextureAtlas::Upload(const IntRect& rect, const uint8_t* pixels, uint32_t row_bytes) {
+  uint32_t width = (uint32_t)rect.width();
+  uint32_t height = (uint32_t)rect.height();
+  uint32_t padded_width = width + ATLAS_GUTTER * 2;
+  uint32_t padded_height = height + ATLAS_GUTTER * 2;
+  size_t padded_row_bytes = (size_t)padded_width * 4;
+  padded_.resize(padded_row_bytes * padded_height);
+
+  ///
+  /// Copy the image into the middle of our scratch buffer, extending each row into the left and
+  /// right gutter, then repeat the first and last rows into the top and bottom gutter.
+  ///
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* src = pixels + (size_t)y * row_bytes;
+    uint8_t* dest = padded_.data() + (y + ATLAS_GUTTER) * padded_row_bytes;
+    for (uint32_t x = 0; x < ATLAS_GUTTER; ++x) {
+      memcpy(dest + x * 4, src, 4);
+      memcpy(dest + (ATLAS_GUTTER + width + x) * 4, src + (width - 1) * 4, 4);
+    }
+    memcpy(dest + ATLAS_GUTTER * 4, src, (size_t)width * 4);
+  }
+  for (uint32_t y = 0; y < ATLAS_GUTTER; ++y) {
+    memcpy(padded_.data() + y * padded_row_bytes,
+           padded_.data() + ATLAS_GUTTER * padded_row_bytes, padded_row_bytes);
+    memcpy(padded_.data() + (ATLAS_GUTTER + height + y) * padded_row_bytes,
+           padded_.data() + (ATLAS_GUTTER + height - 1) * padded_row_bytes, padded_row_bytes);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, rect.left - ATLAS_GUTTER, rect.top - ATLAS_GUTTER,
+                  padded_width, padded_height, GL_BGRA, GL_UNSIGNED_BYTE, padded_.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <Ultralight/Geometry.h>
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+///
+/// Pixels of padding around every image in a TextureAtlas. The gutter repeats the image's edge
+/// pixels so bilinear filtering at the edges doesn't pick up a neighbor.
+///
+#define ATLAS_GUTTER 1
+
+///
+/// Packs many small BGRA images into one GL_RGBA8 texture so draws that sample different images
+/// can share a texture binding (and be batched together).
+///
+/// Images are placed on "shelves": rows as tall as the first image placed on them, filled left to
+/// right. Freed slots are merged with free neighbors they share a whole edge with (or given back
+/// to the end of their shelf) and handed out again to images that fit inside them, with whatever
+/// part of the slot an image doesn't need staying free. A shelf whose images are all freed is
+/// emptied entirely.
+///
+class TextureAtlas {
+public:
+  TextureAtlas(uint32_t size);
+  ~TextureAtlas();
+
+  GLuint texture() const { return texture_; }
+  uint32_t size() const { return size_; }
+  size_t num_images() const { return num_images_; }
+
+  ///
+  /// Reserve room for a 'width' x 'height' image, 'rect' receives where it goes (not including
+  /// the gutter) and 'slot' all the space reserved for it, which may be larger. Returns false if
+  /// the atlas is full.
+  ///
+  bool Allocate(uint32_t width, uint32_t height, ultralight::IntRect& rect,
+                ultralight::IntRect& slot);
+
+  ///
+  /// Release a slot returned by Allocate().
+  ///
+  void Free(const ultralight::IntRect& slot);
+
+  ///
+  /// Upload premultiplied BGRA pixels into 'rect' (and its gutter).
+  ///
+  void Upload(const ultralight::IntRect& rect, const uint8_t* pixels, uint32_t row_bytes);
+
+protected:
+  struct Shelf {
+    uint32_t y;
+    uint32_t height;
+    uint32_t used_width;
+    uint32_t num_images;
+  };
+
+  Shelf& ShelfAt(int y);
+
+  GLuint texture_ = 0;
+  uint32_t size_;
+  uint32_t next_shelf_y_ = 0;
+  size_t num_images_ = 0;
+  std::vector<Shelf> shelves_;
+  std::vector<ultralight::IntRect> free_slots_;
+  std::vector<uint8_t> padded_;                   // Scratch space for Upload()
+};
@@ -0,0 +1,305 @@
+#include "TileCompositor.h"
+#include "GLTextureSurface.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using ultralight::IntRect;
+
+// Keeps the shader's uniform array (and the buffer we upload every draw) reasonably small.
+#define MAX_INSTANCES_PER_DRAW 256
+
+static const char* kVertexShader = R"GLSL(
+layout(location = 0) in vec2 in_position;
+layout(location = 1) in vec2 in_uv;
+
+struct Instance {
+  mat4 transform;
+  vec4 colors[4];
+  vec4 params;
+};
+
+layout(std140) uniform Instances {
+  Instance instances[MAX_INSTANCES];
+};
+
+out vec4 ex_color;
+out vec3 ex_uv;
+flat out float ex_is_texture;
+
+void main() {
+  Instance instance = instances[gl_InstanceID];
+  gl_Position = instance.transform * vec4(in_position, 0.0, 1.0);
+  ex_color = instance.colors[gl_VertexID];
+  ex_uv = vec3(in_uv * instance.params.yz, instance.params.x);
+  ex_is_texture = instance.params.w;
+}
+)GLSL";
+
+static const char* kFragmentShader = R"GLSL(
+uniform sampler2DArray tiles;
+uniform sampler2D tile_texture;
+
+in vec4 ex_color;
+in vec3 ex_uv;
+flat in float ex_is_texture;
+
+out vec4 out_color;
+
+void main() {
+  vec4 texel = ex_is_texture > 0.5 ? texture(tile_texture, ex_uv.xy) : texture(tiles, ex_uv);
+  out_color = texel * ex_color;
+}
+)GLSL";
+
+// A quad spanning [-1, 1] as a triangle strip: x, y, u, v
+static const GLfloat kQuadVertices[] = {
+  -1.0f, -1.0f, 0.0f, 1.0f,
+   1.0f, -1.0f, 1.0f, 1.0f,
+  -1.0f,  1.0f, 0.0f, 0.0f,
+   1.0f,  1.0f, 1.0f, 0.0f,
+};
+
+static GLuint CompileShader(GLenum type, const std::string& source) {
+  GLuint shader = glCreateShader(type);
+  const char* source_str = source.c_str();
+  glShaderSource(shader, 1, &source_str, nullptr);
+  glCompileShader(shader);
+
+  GLint status = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (!status) {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    fprintf(stderr, "Error compiling shader: %s\n", log);
+  }
+
+  return shader;
+}
+
+TileCompositor::TileCompositor() {
+  ///
+  /// Fit as many instances in our uniform block as the driver allows.
+  ///
+  GLint max_block_size = 0;
+  glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_block_size);
+  max_instances_per_draw_ = std::min((size_t)max_block_size / sizeof(Instance),
+                                     (size_t)MAX_INSTANCES_PER_DRAW);
+
+  std::string header = "#version 330 core\n#define MAX_INSTANCES " +
+                       std::to_string(max_instances_per_draw_) + "\n";
+  GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, header + kVertexShader);
+  GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, header + kFragmentShader);
+
+  program_ = glCreateProgram();
+  glAttachShader(program_, vertex_shader);
+  glAttachShader(program_, fragment_shader);
+  glLinkProgram(program_);
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint status = 0;
+  glGetProgramiv(program_, GL_LINK_STATUS, &status);
+  if (!status) {
+    char log[1024];
+    glGetProgramInfoLog(program_, sizeof(log), nullptr, log);
+    fprintf(stderr, "Error linking shader program: %s\n", log);
+  }
+
+  glUseProgram(program_);
+  glUniform1i(glGetUniformLocation(program_, "tiles"), 0);
+  glUniform1i(glGetUniformLocation(program_, "tile_texture"), 1);
+  glUniformBlockBinding(program_, glGetUniformBlockIndex(program_, "Instances"), 0);
+  glUseProgram(0);
+
+  ///
+  /// All instances share one quad.
+  ///
+  glGenVertexArrays(1, &vao_);
+  glBindVertexArray(vao_);
+  glGenBuffers(1, &vbo_);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kQuadVertices), kQuadVertices, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (const void*)0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
+                        (const void*)(2 * sizeof(GLfloat)));
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glGenBuffers(1, &ubo_);
+}
+
+TileCompositor::~TileCompositor() {
+  if (texture_array_)
+    glDeleteTextures(1, &texture_array_);
+  glDeleteBuffers(1, &ubo_);
+  glDeleteBuffers(1, &vbo_);
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteProgram(program_);
+}
+
+void TileCompositor::UploadSurfaces(const std::vector<GLTextureSurface*>& surfaces) {
+  uint32_t width = 1, height = 1;
+  for (auto surface : surfaces) {
+    if (surface) {
+      width = std::max(width, surface->width());
+      height = std::max(height, surface->height());
+    }
+  }
+
+  uint32_t layers = std::max(array_layers_, 4u);
+  while (layers < surfaces.size())
+    layers *= 2;
+
+  if (width != array_width_ || height != array_height_ || layers != array_layers_)
+    ResizeTextureArray(width, height, layers);
+
+  for (size_t i = 0; i < surfaces.size(); ++i) {
+    GLTextureSurface* surface = surfaces[i];
+    Layer& layer = layers_[i];
+    if (!surface) {
+      layer = Layer();
+      continue;
+    }
+
+    ///
+    /// Only upload the part of the Surface that changed, unless this layer last held a
+    /// different Surface (eg, a tile was closed and the ones after it moved down a layer) or
+    /// the Surface was resized since.
+    ///
+    IntRect bounds = { 0, 0, (int)surface->width(), (int)surface->height() };
+    IntRect rect = bounds;
+    if (layer.surface_id == surface->id() && layer.width == surface->width() &&
+        layer.height == surface->height()) {
+      if (surface->dirty_bounds().IsEmpty())
+        continue;
+      rect = surface->dirty_bounds().Intersect(bounds);
+    }
+
+    if (!rect.IsEmpty())
+      surface->UploadToLayer(texture_array_, (GLint)i, rect);
+
+    surface->ClearDirtyBounds();
+    layer.surface_id = surface->id();
+    layer.width = surface->width();
+    layer.height = surface->height();
+  }
+}
+
+void TileCompositor::InvalidateLayers() {
+  std::fill(layers_.begin(), layers_.end(), Layer());
+}
+
+void TileCompositor::BeginFrame(int width, int height) {
+  glViewport(0, 0, width, height);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_BLEND);
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  instances_.clear();
+  instance_textures_.clear();
+}
+
+void TileCompositor::AddInstance(int layer, const GLfloat transform[16],
+                                 const GLfloat colors[16]) {
+  if (layer < 0 || layer >= (int)layers_.size() || !layers_[layer].surface_id)
+    return;
+
+  GLfloat params[4] = { (GLfloat)layer, layers_[layer].width / (GLfloat)array_width_,
+                        layers_[layer].height / (GLfloat)array_height_, 0 };
+  QueueInstance(0, transform, colors, params);
+}
+
+void TileCompositor::AddTextureInstance(GLuint texture, GLfloat uv_width, GLfloat uv_height,
+                                        const GLfloat transform[16], const GLfloat colors[16]) {
+  if (!texture)
+    return;
+
+  GLfloat params[4] = { 0, uv_width, uv_height, 1 };
+  QueueInstance(texture, transform, colors, params);
+}
+
+void TileCompositor::QueueInstance(GLuint texture, const GLfloat transform[16],
+                                   const GLfloat colors[16], const GLfloat params[4]) {
+  Instance instance;
+  std::copy(transform, transform + 16, instance.transform);
+  std::copy(colors, colors + 16, instance.colors);
+  std::copy(params, params + 4, instance.params);
+  instances_.push_back(instance);
+  instance_textures_.push_back(texture);
+}
+
+void TileCompositor::Flush() {
+  if (instances_.empty())
+    return;
+
+  glUseProgram(program_);
+  glBindVertexArray(vao_);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_);
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+  glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo_);
+
+  ///
+  /// Everything that samples our texture array normally fits in a single draw, we only split up
+  /// if there are more instances than fit in the uniform block or the texture changes.
+  ///
+  size_t count = 0;
+  for (size_t first = 0; first < instances_.size(); first += count) {
+    GLuint texture = instance_textures_[first];
+    count = 1;
+    while (first + count < instances_.size() && count < max_instances_per_draw_ &&
+           instance_textures_[first + count] == texture)
+      count++;
+
+    if (texture) {
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Orphan the buffer so we don't wait on a previous draw that is still reading it.
+    glBufferData(GL_UNIFORM_BUFFER, max_instances_per_draw_ * sizeof(Instance), nullptr,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(Instance), &instances_[first]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+    num_draw_calls_++;
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glBindVertexArray(0);
+  glUseProgram(0);
+
+  instances_.clear();
+  instance_textures_.clear();
+}
+
+void TileCompositor::ResizeTextureArray(uint32_t width, uint32_t height, uint32_t layers) {
+  if (texture_array_)
+    glDeleteTextures(1, &texture_array_);
+
+  array_width_ = width;
+  array_height_ = height;
+  array_layers_ = layers;
+
+  glGenTextures(1, &texture_array_);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_BGRA,
+               GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  // Every layer needs to be uploaded again.
+  layers_.assign(layers, Layer());
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+
+class GLTextureSurface;
+
+///
+/// Draws WebTiles (and their reflections) with as few instanced draw calls as possible.
+///
+/// Every tile's Surface (CPU-rendered Views, the default) is uploaded into a layer of one
+/// GL_TEXTURE_2D_ARRAY so all tiles can be sampled from the same draw. Only each Surface's dirty
+/// bounds are uploaded again, as long as its layer still holds it. Each instance (a tile or a
+/// reflection) has its transform, corner colors and texture layer stored in a uniform buffer that
+/// the vertex shader indexes with gl_InstanceID.
+///
+/// Tiles rendered by a GPUDriver (--gpu) are sampled straight from their render target instead,
+/// these are drawn with one instanced draw per run of instances that share a texture (a tile and
+/// its reflection), so the single draw only holds for CPU-rendered tiles.
+///
+/// Requires an OpenGL 3.3 core context.
+///
+class TileCompositor {
+public:
+  TileCompositor();
+  ~TileCompositor();
+
+  ///
+  /// Upload any Surfaces that changed since the last frame. Surface 'i' is uploaded into layer
+  /// 'i' of our texture array (null Surfaces are skipped).
+  ///
+  void UploadSurfaces(const std::vector<GLTextureSurface*>& surfaces);
+
+  ///
+  /// Forget what every layer holds so the next UploadSurfaces() re-uploads all Surfaces in full
+  /// (used to benchmark worst-case uploads).
+  ///
+  void InvalidateLayers();
+
+  ///
+  /// Clear the framebuffer and start a new batch of instances.
+  ///
+  void BeginFrame(int width, int height);
+
+  ///
+  /// Queue a quad spanning [-1, 1] that is transformed by 'transform' (column-major) and
+  /// textured with the Surface in 'layer'. The RGBA colors of the four corners (in triangle strip
+  /// order: bottom-left, bottom-right, top-left, top-right) modulate the texture.
+  ///
+  void AddInstance(int layer, const GLfloat transform[16], const GLfloat colors[16]);
+
+  ///
+  /// Same as AddInstance() but textured with a GL_TEXTURE_2D, of which only the top-left
+  /// 'uv_width' x 'uv_height' (in texture coordinates) is used.
+  ///
+  void AddTextureInstance(GLuint texture, GLfloat uv_width, GLfloat uv_height,
+                          const GLfloat transform[16], const GLfloat colors[16]);
+
+  ///
+  /// Draw all queued instances.
+  ///
+  void Flush();
+
+  size_t num_draw_calls() const { return num_draw_calls_; }
+
+protected:
+  struct Instance {
+    GLfloat transform[16];
+    GLfloat colors[16];
+    GLfloat params[4]; // x = layer, y/z = UV scale, w = 1 if sampling a GL_TEXTURE_2D
+  };
+
+  void QueueInstance(GLuint texture, const GLfloat transform[16], const GLfloat colors[16],
+                     const GLfloat params[4]);
+
+  void ResizeTextureArray(uint32_t width, uint32_t height, uint32_t layers);
+
+  ///
+  /// What each layer of our texture array holds: the pixels of the Surface with this id (0 if
+  /// none) at this size, up to date except for the Surface's dirty bounds.
+  ///
+  struct Layer {
+    uint64_t surface_id = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  GLuint program_ = 0;
+  GLuint vao_ = 0;
+  GLuint vbo_ = 0;
+  GLuint ubo_ = 0;
+  GLuint texture_array_ = 0;
+  uint32_t array_width_ = 0;
+  uint32_t array_height_ = 0;
+  uint32_t array_layers_ = 0;
+  size_t max_instances_per_draw_ = 0;
+  size_t num_draw_calls_ = 0;
+  std::vector<Layer> layers_;
+  std::vector<Instance> instances_;
+  std::vector<GLuint> instance_textures_;   // 0 for instances that sample our texture array
+};
@@ -6,10 +6,11 @@
 #define TEX_FORMAT	GL_RGB
 #endif
 
-WebTile::WebTile(RefPtr<Renderer> renderer, int width, int height, double scale) {
+WebTile::WebTile(RefPtr<Renderer> renderer, int width, int height, double scale,
+                 bool is_accelerated) {
   ViewConfig view_config;
   view_config.initial_device_scale = scale;
-  view_config.is_accelerated = false;
+  view_config.is_accelerated = is_accelerated;
   view_ = renderer->CreateView(width, height, view_config, nullptr);
 }
 
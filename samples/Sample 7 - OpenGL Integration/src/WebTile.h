@@ -4,10 +4,11 @@
 
 using namespace ultralight;
 
-// A "WebTile" is a View backed by an OpenGL texture.
+// A "WebTile" is a View backed by an OpenGL texture (a Surface we upload, or the render target
+// of an accelerated View).
 class WebTile {
 public:
-  WebTile(RefPtr<Renderer> renderer, int width, int height, double scale);
+  WebTile(RefPtr<Renderer> renderer, int width, int height, double scale, bool is_accelerated);
 
   WebTile(RefPtr<View> existing_view);
 
@@ -10,9 +10,6 @@ extern "C" {
 static void WindowGLFW_key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
   Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
-  WindowListener* listener = win->listener();
-  if (!listener)
-    return;
 
   ultralight::KeyEvent evt;
   evt.type = action == GLFW_PRESS || action == GLFW_REPEAT ?
@@ -21,7 +18,7 @@ static void WindowGLFW_key_callback(GLFWwindow* window, int key, int scancode, i
   evt.native_key_code = scancode;
   ultralight::GetKeyIdentifierFromVirtualKeyCode(evt.virtual_key_code, evt.key_identifier);
   evt.modifiers = GLFWModsToUltralightMods(mods);
-  listener->OnKeyEvent(evt);
+  win->QueueKeyEvent(evt);
 
   if (evt.type == ultralight::KeyEvent::kType_RawKeyDown &&
     (key == GLFW_KEY_ENTER || key == GLFW_KEY_TAB)) {
@@ -32,16 +29,13 @@ static void WindowGLFW_key_callback(GLFWwindow* window, int key, int scancode, i
       key == GLFW_KEY_ENTER ? ultralight::String("\r") : ultralight::String("\t");
     evt.text = text;
     evt.unmodified_text = text;
-    listener->OnKeyEvent(evt);
+    win->QueueKeyEvent(evt);
   }
 }
 
 static void WindowGLFW_char_callback(GLFWwindow* window, unsigned int codepoint)
 {
   Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
-  WindowListener* listener = win->listener();
-  if (!listener)
-    return;
 
   // Consume backquote since we're using it for expose toggle
   if (codepoint == '`')
@@ -55,36 +49,24 @@ static void WindowGLFW_char_callback(GLFWwindow* window, unsigned int codepoint)
   evt.text = text;
   evt.unmodified_text = text;
 
-  listener->OnKeyEvent(evt);
+  win->QueueKeyEvent(evt);
 }
 
 static void WindowGLFW_cursor_pos_callback(GLFWwindow* window, double xpos, double ypos)
 {
   Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
-  WindowListener* listener = win->listener();
-  if (!listener)
-    return;
 
   ultralight::MouseEvent evt;
   evt.type = ultralight::MouseEvent::kType_MouseMoved;
   evt.x = win->PixelsToDevice((int)xpos);
   evt.y = win->PixelsToDevice((int)ypos);
-  evt.button = ultralight::MouseEvent::kButton_None;
-  if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
-    evt.button = ultralight::MouseEvent::kButton_Left;
-  else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_MIDDLE) == GLFW_PRESS)
-    evt.button = ultralight::MouseEvent::kButton_Middle;
-  else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
-    evt.button = ultralight::MouseEvent::kButton_Right;
-  listener->OnMouseEvent(evt);
+  evt.button = win->pressed_mouse_button();
+  win->QueueMouseEvent(evt);
 }
 
 static void WindowGLFW_mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
   Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
-  WindowListener* listener = win->listener();
-  if (!listener)
-    return;
 
   ultralight::MouseEvent evt;
   evt.type = action == GLFW_PRESS ? ultralight::MouseEvent::kType_MouseDown : 
@@ -105,21 +87,19 @@ static void WindowGLFW_mouse_button_callback(GLFWwindow* window, int button, int
     evt.button = ultralight::MouseEvent::kButton_Right;
     break;
   }
-  listener->OnMouseEvent(evt);
+  win->SetMouseButtonState(evt.button, action == GLFW_PRESS);
+  win->QueueMouseEvent(evt);
 }
 
 static void WindowGLFW_scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
   Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
-  WindowListener* listener = win->listener();
-  if (!listener)
-    return;
 
   ultralight::ScrollEvent evt;
   evt.type = ultralight::ScrollEvent::kType_ScrollByPixel;
   evt.delta_x = win->PixelsToDevice((int)xoffset * 32);
   evt.delta_y = win->PixelsToDevice((int)yoffset * 32);
-  listener->OnScrollEvent(evt);
+  win->QueueScrollEvent(evt);
 }
 
 static void WindowGLFW_framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -144,9 +124,16 @@ static void WindowGLFW_focus_callback(GLFWwindow* window, int focused)
 
 } // extern "C"
 
-Window::Window(uint32_t width, uint32_t height, bool enable_vsync) {
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+Window::Window(uint32_t width, uint32_t height, bool enable_vsync, bool headless)
+  : headless_(headless) {
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#if __APPLE__
+  // macOS only hands out core contexts that are forward-compatible.
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+  glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
 
   GLFWwindow* win = glfwCreateWindow(width, height, "", NULL, NULL);
   window_ = win;
@@ -198,6 +185,9 @@ Window::~Window() {
 }
 
 void Window::MoveToCenter() {
+  if (headless_)
+    return;
+
   int monitorX, monitorY;
   glfwGetMonitorPos(glfwGetPrimaryMonitor(), &monitorX, &monitorY);
 
@@ -228,6 +218,10 @@ uint32_t Window::height() const {
 }
 
 double Window::scale() const {
+  // There may not be a monitor at all when headless, always render at 1x.
+  if (headless_)
+    return 1.0;
+
   float xscale, yscale;
   glfwGetMonitorContentScale(glfwGetPrimaryMonitor(), &xscale, &yscale);
   return (double)xscale;
@@ -280,9 +274,111 @@ int Window::PixelsToDevice(int val) const {
 }
 
 void Window::PresentFrame() {
+  if (headless_)
+    return;
+
   glfwSwapBuffers(window_);
 }
 
+void Window::QueueKeyEvent(const KeyEvent& evt) {
+  events_received_++;
+
+  InputEvent input;
+  input.type = InputEvent::kType_Key;
+  input.key = evt;
+  input_queue_.push_back(input);
+}
+
+void Window::QueueMouseEvent(const MouseEvent& evt) {
+  events_received_++;
+
+  // Only the last position of a run of moves matters. Presses and releases break the run so
+  // they still see the cursor where it was when they happened.
+  if (evt.type == MouseEvent::kType_MouseMoved && !input_queue_.empty()) {
+    InputEvent& last = input_queue_.back();
+    if (last.type == InputEvent::kType_Mouse && last.mouse.type == MouseEvent::kType_MouseMoved) {
+      last.mouse = evt;
+      return;
+    }
+  }
+
+  InputEvent input;
+  input.type = InputEvent::kType_Mouse;
+  input.mouse = evt;
+  input_queue_.push_back(input);
+}
+
+void Window::QueueScrollEvent(const ScrollEvent& evt) {
+  events_received_++;
+
+  if (!input_queue_.empty()) {
+    InputEvent& last = input_queue_.back();
+    if (last.type == InputEvent::kType_Scroll && last.scroll.type == evt.type) {
+      last.scroll.delta_x += evt.delta_x;
+      last.scroll.delta_y += evt.delta_y;
+      return;
+    }
+  }
+
+  InputEvent input;
+  input.type = InputEvent::kType_Scroll;
+  input.scroll = evt;
+  input_queue_.push_back(input);
+}
+
+void Window::DispatchInput() {
+  // Listeners may pump events themselves, dispatch from a separate queue.
+  dispatch_queue_.swap(input_queue_);
+
+  for (auto& input : dispatch_queue_) {
+    if (!listener_)
+      break;
+
+    events_dispatched_++;
+
+    switch (input.type) {
+    case InputEvent::kType_Key:
+      listener_->OnKeyEvent(input.key);
+      break;
+    case InputEvent::kType_Mouse:
+      listener_->OnMouseEvent(input.mouse);
+      break;
+    case InputEvent::kType_Scroll:
+      listener_->OnScrollEvent(input.scroll);
+      break;
+    }
+  }
+
+  dispatch_queue_.clear();
+}
+
+void Window::SetMouseButtonState(MouseEvent::Button button, bool pressed) {
+  switch (button) {
+  case MouseEvent::kButton_Left:
+    left_button_down_ = pressed;
+    break;
+  case MouseEvent::kButton_Middle:
+    middle_button_down_ = pressed;
+    break;
+  case MouseEvent::kButton_Right:
+    right_button_down_ = pressed;
+    break;
+  default:
+    break;
+  }
+}
+
+MouseEvent::Button Window::pressed_mouse_button() const {
+  if (left_button_down_)
+    return MouseEvent::kButton_Left;
+  else if (middle_button_down_)
+    return MouseEvent::kButton_Middle;
+  else if (right_button_down_)
+    return MouseEvent::kButton_Right;
+
+  return MouseEvent::kButton_None;
+}
+
 using namespace ultralight;
 using namespace ultralight::KeyCodes;
 
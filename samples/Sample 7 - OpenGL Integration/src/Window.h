@@ -1,5 +1,6 @@
 #pragma once
 #include <Ultralight/Ultralight.h>
+#include <vector>
 
 typedef struct GLFWwindow GLFWwindow;
 typedef struct GLFWcursor GLFWcursor;
@@ -20,7 +21,11 @@ public:
 
 class Window {
 public:
-  Window(uint32_t width, uint32_t height, bool enable_vsync);
+  ///
+  /// A headless window is never shown, it only exists to own a GL context. (Build GLFW with
+  /// GLFW_USE_OSMESA to create one on machines without a display or GPU.)
+  ///
+  Window(uint32_t width, uint32_t height, bool enable_vsync, bool headless = false);
   ~Window();
 
   void set_listener(WindowListener* listener) { listener_ = listener; }
@@ -41,11 +46,45 @@ public:
 
   void PresentFrame();
 
+  ///
+  /// Input from GLFW is queued as it arrives and sent to the listener here, once per frame.
+  /// Consecutive mouse moves are coalesced into the last one and consecutive scrolls are summed.
+  ///
+  void DispatchInput();
+
+  uint64_t events_received() const { return events_received_; }
+  uint64_t events_dispatched() const { return events_dispatched_; }
+
+  bool is_headless() const { return headless_; }
+
   GLFWwindow* handle() { return window_; }
 
+  // Called from the GLFW callbacks
+  void QueueKeyEvent(const KeyEvent& evt);
+  void QueueMouseEvent(const MouseEvent& evt);
+  void QueueScrollEvent(const ScrollEvent& evt);
+  void SetMouseButtonState(MouseEvent::Button button, bool pressed);
+  MouseEvent::Button pressed_mouse_button() const;
+
 protected:
+  struct InputEvent {
+    enum Type { kType_Key, kType_Mouse, kType_Scroll } type;
+    KeyEvent key;
+    MouseEvent mouse;
+    ScrollEvent scroll;
+  };
+
+  std::vector<InputEvent> input_queue_;
+  std::vector<InputEvent> dispatch_queue_;
+  uint64_t events_received_ = 0;
+  uint64_t events_dispatched_ = 0;
+  bool left_button_down_ = false;
+  bool middle_button_down_ = false;
+  bool right_button_down_ = false;
+
   WindowListener* listener_ = nullptr;
   GLFWwindow* window_ = nullptr;
+  bool headless_ = false;
   GLFWcursor* cursor_ibeam_;
   GLFWcursor* cursor_crosshair_;
   GLFWcursor* cursor_hand_;
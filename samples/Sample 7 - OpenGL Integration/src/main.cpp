@@ -1,7 +1,68 @@
 #include "Sample.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
+///
+/// Usage: Sample7 [--gpu] [--headless] [--frames N] [--size WIDTHxHEIGHT] [--full-upload]
+///                [--golden FILE.ppm] [--update-golden] [--tolerance N]
+///
+///   --gpu            Render Views with our OpenGL GPUDriver instead of on the CPU (uploaded
+///                    through PBOs). Experimental: gradients, rounded rects, box shadows and the
+///                    other fill types the driver doesn't implement yet come out as flat quads,
+///                    see GPUDriverGL.
+///   --headless       Render offscreen without showing a window, then print upload/draw timings.
+///                    Build with -DGLFW_USE_OSMESA=ON to run on machines without a display or GPU.
+///   --frames N       Number of frames to time once all pages have loaded.
+///   --size WxH       Size of the offscreen framebuffer.
+///   --full-upload    Re-upload every tile each frame instead of only the parts that changed
+///                    (doesn't apply with --gpu).
+///   --golden FILE    Compare the last frame against FILE (written if it doesn't exist yet).
+///   --update-golden  Overwrite the golden image with the last frame.
+///   --tolerance N    Per-channel difference allowed before a pixel counts as mismatched.
+///
 int main(int argc, char *argv[]) {
-  Sample sample;
+  SampleOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (!strcmp(arg, "--headless")) {
+      options.headless = true;
+    } else if (!strcmp(arg, "--gpu")) {
+      options.gpu_views = true;
+    } else if (!strcmp(arg, "--full-upload")) {
+      options.full_upload = true;
+    } else if (!strcmp(arg, "--update-golden")) {
+      options.update_golden = true;
+    } else if (!strcmp(arg, "--frames") && value) {
+      options.frames = atoi(value);
+      i++;
+    } else if (!strcmp(arg, "--size") && value) {
+      if (sscanf(value, "%ux%u", &options.width, &options.height) != 2 ||
+          !options.width || !options.height) {
+        fprintf(stderr, "Invalid size: %s\n", value);
+        return EXIT_FAILURE;
+      }
+      i++;
+    } else if (!strcmp(arg, "--golden") && value) {
+      options.golden_path = value;
+      i++;
+    } else if (!strcmp(arg, "--tolerance") && value) {
+      options.tolerance = atoi(value);
+      i++;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  Sample sample(options);
+
+  if (options.headless)
+    return sample.RunHeadless();
+
   sample.Run();
 
   return 0;
@@ -5,6 +5,12 @@
 
 Browser::Browser()  {
   Settings settings;
+
+  // Tab thumbnails are read back from each View's Surface, which only exists when Views are
+  // rendered on the CPU (the SDK can't read back GPU render targets). Turn this off to render
+  // with the GPU instead, the UI then disables tab previews on the new tab page and says so.
+  settings.force_cpu_renderer = true;
+
   Config config;
   config.scroll_timer_delay = 1.0 / 90.0;
   app_ = App::Create(settings, config);
@@ -16,9 +22,11 @@ Browser::Browser()  {
   // Create the UI
   ui_.reset(new UI(window_));
   window_->set_listener(ui_.get());
+  app_->set_listener(ui_.get());
 }
 
 Browser::~Browser() {
+  app_->set_listener(nullptr);
   window_->set_listener(nullptr);
 
   ui_.reset();
@@ -0,0 +1,132 @@
+#include "ResourceCache.h"
+#include <chrono>
+#include <cstring>
+
+static const char* kCachedExtensions[] = { ".js", ".css", ".png", ".jpg", ".jpeg", ".gif",
+                                           ".svg", ".webp" };
+
+// 64-bit FNV-1a.
+static uint64_t HashBytes(const uint8_t* data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+ResourceCache::ResourceCache(FileSystem* fallback, size_t max_bytes)
+  : fallback_(fallback), max_bytes_(max_bytes) {
+}
+
+ResourceCache::~ResourceCache() {
+}
+
+bool ResourceCache::FileExists(const String& file_path) {
+  if (paths_.count(file_path.utf8().data()))
+    return true;
+
+  return fallback_->FileExists(file_path);
+}
+
+String ResourceCache::GetFileMimeType(const String& file_path) {
+  return fallback_->GetFileMimeType(file_path);
+}
+
+String ResourceCache::GetFileCharset(const String& file_path) {
+  return fallback_->GetFileCharset(file_path);
+}
+
+RefPtr<Buffer> ResourceCache::OpenFile(const String& file_path) {
+  std::string path = file_path.utf8().data();
+  if (!IsCachedPath(path))
+    return fallback_->OpenFile(file_path);
+
+  auto cached = paths_.find(path);
+  if (cached != paths_.end()) {
+    stats_.hits++;
+    cached->second->second.last_used = ++counter_;
+    return cached->second->second.buffer;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  RefPtr<Buffer> buffer = fallback_->OpenFile(file_path);
+  stats_.read_ms += std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+  stats_.misses++;
+
+  if (!buffer)
+    return nullptr;
+
+  auto content = AddContent(buffer);
+  content->second.last_used = ++counter_;
+  paths_[path] = content;
+
+  // Hold on to what we return, in case it's evicted right away.
+  buffer = content->second.buffer;
+  EvictContents();
+  return buffer;
+}
+
+bool ResourceCache::IsCachedPath(const std::string& path) {
+  // Only files inside the bundled assets directory, never absolute paths or ones that climb out.
+  if (path.empty() || path[0] == '/' || path[0] == '\\' || path.find(':') != std::string::npos)
+    return false;
+  for (size_t start = 0; start <= path.size();) {
+    size_t end = path.find_first_of("/\\", start);
+    if (end == std::string::npos)
+      end = path.size();
+    if (path.compare(start, end - start, "..") == 0)
+      return false;
+    start = end + 1;
+  }
+
+  for (const char* extension : kCachedExtensions) {
+    size_t length = strlen(extension);
+    if (path.size() > length && path.compare(path.size() - length, length, extension) == 0)
+      return true;
+  }
+  return false;
+}
+
+std::multimap<uint64_t, ResourceCache::Content>::iterator
+ResourceCache::AddContent(RefPtr<Buffer> buffer) {
+  const uint8_t* data = (const uint8_t*)buffer->data();
+  size_t size = buffer->size();
+  uint64_t hash = HashBytes(data, size);
+
+  // Equal hashes are only a hint, compare the bytes before sharing.
+  auto range = contents_.equal_range(hash);
+  for (auto content = range.first; content != range.second; ++content) {
+    RefPtr<Buffer> existing = content->second.buffer;
+    if (existing->size() == size && (!size || !memcmp(existing->data(), data, size))) {
+      stats_.bytes_deduplicated += size;
+      return content;
+    }
+  }
+
+  stats_.bytes += size;
+  Content content;
+  content.buffer = buffer;
+  return contents_.insert({ hash, content });
+}
+
+void ResourceCache::EvictContents() {
+  while (stats_.bytes > max_bytes_ && !contents_.empty()) {
+    auto lru = contents_.begin();
+    for (auto content = contents_.begin(); content != contents_.end(); ++content) {
+      if (content->second.last_used < lru->second.last_used)
+        lru = content;
+    }
+
+    for (auto path = paths_.begin(); path != paths_.end();) {
+      if (path->second == lru)
+        path = paths_.erase(path);
+      else
+        ++path;
+    }
+
+    stats_.bytes -= lru->second.buffer->size();
+    contents_.erase(lru);
+  }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <AppCore/AppCore.h>
+#include <Ultralight/platform/FileSystem.h>
+#include <map>
+#include <string>
+
+using namespace ultralight;
+
+/**
+* Keeps the scripts, stylesheets and images our pages load from the app's bundled assets in
+* memory, shared by every View and deduplicated by content.
+*
+* Only relative paths inside the assets directory are cached (absolute paths and paths with '..'
+* go straight to the file system we wrap). Those files are copied there at build time and don't
+* change while the app runs, so a cached entry never needs revalidating: a path is read from disk
+* once and then always maps to the same content.
+*
+* Each path maps to its content, which is keyed by a hash of its bytes: files with identical
+* contents under different paths (copies of the same logo or CSS bundle) are only held once, and
+* every View that loads a path gets the same bytes without touching the disk again.
+*
+* Files are kept in one reference-counted Buffer per distinct content, bounded by 'max_bytes'.
+* The least-recently-used contents are evicted first (Views still holding them keep them alive).
+* All other files are forwarded to the file system we wrap.
+*/
+class ResourceCache : public FileSystem {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t bytes = 0;              // Size of the distinct contents we hold
+    size_t bytes_deduplicated = 0; // Bytes read from disk that we already had under another URL
+    double read_ms = 0;            // Time spent reading files from disk
+  };
+
+  ResourceCache(FileSystem* fallback, size_t max_bytes);
+  virtual ~ResourceCache();
+
+  const Stats& stats() const { return stats_; }
+
+  // Inherited from FileSystem
+  virtual bool FileExists(const String& file_path) override;
+  virtual String GetFileMimeType(const String& file_path) override;
+  virtual String GetFileCharset(const String& file_path) override;
+  virtual RefPtr<Buffer> OpenFile(const String& file_path) override;
+
+protected:
+  struct Content {
+    RefPtr<Buffer> buffer;
+    uint64_t last_used = 0;
+  };
+
+  // Scripts, stylesheets and images inside the assets directory.
+  static bool IsCachedPath(const std::string& path);
+
+  // Finds content we already hold that's identical to 'buffer', or adds it.
+  std::multimap<uint64_t, Content>::iterator AddContent(RefPtr<Buffer> buffer);
+
+  void EvictContents();
+
+  FileSystem* fallback_;
+  size_t max_bytes_;
+  uint64_t counter_ = 0;
+  std::map<std::string, std::multimap<uint64_t, Content>::iterator> paths_;
+  std::multimap<uint64_t, Content> contents_;  // By content hash
+  Stats stats_;
+};
@@ -1,23 +1,53 @@
 #include "Tab.h"
 #include "UI.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
 #define INSPECTOR_DRAG_HANDLE_HEIGHT 10
 
+// Ultralight doesn't report memory per View, so we assume a fixed cost for the DOM, JS heap,
+// decoded images and other per-page state on top of the View's render target.
+#define VIEW_MEMORY_ESTIMATE (24 * 1024 * 1024)
+
 Tab::Tab(UI* ui, uint64_t id, uint32_t width, uint32_t height, int x, int y) 
-  : ui_(ui), id_(id), container_width_(width), container_height_(height) {
-  overlay_ = Overlay::Create(ui->window_, width, height, x, y);
-  view()->set_view_listener(this);
-  view()->set_load_listener(this);
+  : ui_(ui), id_(id), container_width_(width), container_height_(height),
+    container_x_(x), container_y_(y) {
+  CreateOverlay();
+}
+
+Tab::Tab(UI* ui, uint64_t id, uint32_t width, uint32_t height, int x, int y,
+         const TabSessionState& state)
+  : ui_(ui), id_(id), container_width_(width), container_height_(height),
+    container_x_(x), container_y_(y), session_state_(state) {
 }
 
 Tab::~Tab() {
-  view()->set_view_listener(nullptr);
-  view()->set_load_listener(nullptr);
+  if (overlay_) {
+    view()->set_view_listener(nullptr);
+    view()->set_load_listener(nullptr);
+  }
+}
+
+void Tab::CreateOverlay() {
+  RefPtr<View> pooled_view = ui_->view_pool_->Acquire(container_width_, container_height_,
+                                                      ui_->window_->scale());
+  overlay_ = Overlay::Create(ui_->window_, pooled_view, container_x_, container_y_);
+  view()->set_view_listener(this);
+  view()->set_load_listener(this);
 }
 
 void Tab::Show() {
+  if (lifecycle_.is_suspended()) {
+    TabLifecycle::Stats stats = lifecycle_.Resume(view().get());
+    std::cout << "Tab " << id_ << " resumed after " << stats.background_ms / 1000.0
+              << "s in the background: skipped " << stats.frames_skipped << " animation frames and "
+              << stats.timer_runs_skipped << " timer runs (~" << stats.cpu_ms_saved
+              << " ms CPU saved, " << lifecycle_.totals().cpu_ms_saved << " ms total)" << std::endl;
+  }
+
   overlay_->Show();
   overlay_->Focus();
 
@@ -26,11 +56,138 @@ void Tab::Show() {
 }
 
 void Tab::Hide() {
+  if (is_discarded())
+    return;
+
   overlay_->Hide();
   overlay_->Unfocus();
 
   if (inspector_overlay_)
     inspector_overlay_->Hide();
+
+  // Snapshot the page for previews before it's throttled (or discarded). A tab that's closing
+  // has already had its thumbnail removed, don't bring it back.
+  if (ui_->thumbnails_enabled_ && !ready_to_close_)
+    ui_->thumbnails_->Capture(id_, view()->surface());
+
+  lifecycle_.Suspend(view().get());
+}
+
+void Tab::UpdateSessionState() {
+  if (is_discarded())
+    return;
+
+  // Keep what we had if the page never got anywhere (eg, its load is still queued) or is
+  // showing an error page.
+  String url = view()->url();
+  if (!url.empty() && url != "about:blank")
+    session_state_.url = url;
+  else if (!history_.empty())
+    session_state_.url = history_[history_index_];
+
+  String title = view()->title();
+  if (!title.empty())
+    session_state_.title = title;
+
+  if (!history_.empty()) {
+    session_state_.history = history_;
+    session_state_.history_index = history_index_;
+  }
+
+  int scroll_x = 0, scroll_y = 0;
+  String scroll = view()->EvaluateScript("Math.round(window.scrollX) + ' ' + Math.round(window.scrollY)");
+  if (sscanf(scroll.utf8().data(), "%d %d", &scroll_x, &scroll_y) == 2) {
+    session_state_.scroll_x = scroll_x;
+    session_state_.scroll_y = scroll_y;
+  }
+}
+
+void Tab::Discard() {
+  if (is_discarded())
+    return;
+
+  UpdateSessionState();
+
+  view()->set_view_listener(nullptr);
+  view()->set_load_listener(nullptr);
+  inspector_overlay_ = nullptr;
+  overlay_ = nullptr;
+
+  // The page is gone, nothing left to throttle.
+  lifecycle_ = TabLifecycle();
+}
+
+void Tab::Restore() {
+  if (!is_discarded())
+    return;
+
+  CreateOverlay();
+
+  history_ = session_state_.history;
+  history_index_ = session_state_.history_index;
+  pending_history_offset_ = 0;
+  use_session_history_ = true;
+  restore_scroll_ = session_state_.scroll_x || session_state_.scroll_y;
+}
+
+void Tab::StartLoad() {
+  is_load_preempted_ = false;
+
+  if (session_state_.url.empty())
+    view()->LoadURL("file:///new_tab_page.html");
+  else
+    view()->LoadURL(session_state_.url);
+}
+
+void Tab::PreemptLoad() {
+  is_load_preempted_ = true;
+  view()->Stop();
+}
+
+size_t Tab::EstimateMemoryUsage() const {
+  if (is_discarded())
+    return 0;
+
+  size_t bytes = VIEW_MEMORY_ESTIMATE + (size_t)overlay_->width() * overlay_->height() * 4;
+  if (inspector_overlay_)
+    bytes += VIEW_MEMORY_ESTIMATE +
+             (size_t)inspector_overlay_->width() * inspector_overlay_->height() * 4;
+
+  return bytes;
+}
+
+String Tab::title() {
+  return is_discarded() ? session_state_.title : view()->title();
+}
+
+bool Tab::CanGoBack() {
+  return use_session_history_ ? history_index_ > 0 : view()->CanGoBack();
+}
+
+bool Tab::CanGoForward() {
+  return use_session_history_ ? history_index_ + 1 < history_.size() : view()->CanGoForward();
+}
+
+void Tab::GoBack() {
+  if (!CanGoBack())
+    return;
+
+  pending_history_offset_ = -1;
+  if (use_session_history_)
+    view()->LoadURL(history_[history_index_ - 1]);
+  else
+    view()->GoBack();
+}
+
+void Tab::GoForward() {
+  if (!CanGoForward())
+    return;
+
+  pending_history_offset_ = 1;
+  if (use_session_history_)
+    view()->LoadURL(history_[history_index_ + 1]);
+  else
+    view()->GoForward();
 }
 
 void Tab::ToggleInspector() {
@@ -91,6 +248,9 @@ void Tab::Resize(uint32_t width, uint32_t height) {
   container_width_ = width;
   container_height_ = height;
 
+  if (is_discarded())
+    return;
+
   uint32_t content_height = container_height_;
   if (inspector_overlay_ && !inspector_overlay_->is_hidden()) {
     content_height -= inspector_overlay_->height();
@@ -112,6 +272,25 @@ void Tab::OnChangeTitle(View* caller, const String& title) {
 }
 
 void Tab::OnChangeURL(View* caller, const String& url) {
+  // Error pages are loaded as raw HTML, keep them out of the history.
+  if (!url.empty() && url != "about:blank") {
+    // Back/forward only moves within the history if we land where we expected to.
+    size_t target = history_index_ + pending_history_offset_;
+    bool is_history_navigation = pending_history_offset_ && target < history_.size() &&
+                                 history_[target] == url;
+    pending_history_offset_ = 0;
+
+    if (is_history_navigation) {
+      history_index_ = target;
+    } else if (history_.empty() || history_[history_index_] != url) {
+      // A new navigation drops everything ahead of the current entry.
+      if (!history_.empty())
+        history_.resize(history_index_ + 1);
+      history_.push_back(url);
+      history_index_ = history_.size() - 1;
+    }
+  }
+
   ui_->UpdateTabURL(id_, url);
 }
 
@@ -152,16 +331,32 @@ RefPtr<View> Tab::OnCreateInspectorView(ultralight::View* caller, bool is_local,
 }
 
 void Tab::OnBeginLoading(View* caller, uint64_t frame_id, bool is_main_frame, const String& url) {
-  ui_->UpdateTabNavigation(id_, caller->is_loading(), caller->CanGoBack(), caller->CanGoForward());
+  ui_->UpdateTabNavigation(id_, caller->is_loading(), CanGoBack(), CanGoForward());
 }
 
 void Tab::OnFinishLoading(View* caller, uint64_t frame_id, bool is_main_frame, const String& url) {
-  ui_->UpdateTabNavigation(id_, caller->is_loading(), caller->CanGoBack(), caller->CanGoForward());
+  if (is_main_frame && restore_scroll_) {
+    char script[64];
+    snprintf(script, sizeof(script), "window.scrollTo(%d, %d)", session_state_.scroll_x,
+             session_state_.scroll_y);
+    caller->EvaluateScript(script);
+    restore_scroll_ = false;
+  }
+
+  if (is_main_frame)
+    ui_->OnTabLoadFinished(id_);
+
+  ui_->UpdateTabNavigation(id_, caller->is_loading(), CanGoBack(), CanGoForward());
 }
 
 void Tab::OnFailLoading(View* caller, uint64_t frame_id, bool is_main_frame, const String& url,
   const String& description, const String& error_domain, int error_code) {
+  if (is_main_frame && is_load_preempted_)
+    return;
+
   if (is_main_frame) {
+    ui_->OnTabLoadFinished(id_);
+
     char error_code_str[16]; 
     sprintf(error_code_str,"%d", error_code);
 
@@ -182,6 +377,75 @@ void Tab::OnFailLoading(View* caller, uint64_t frame_id, bool is_main_frame, con
   }
 }
 
+void Tab::OnWindowObjectReady(View* caller, uint64_t frame_id, bool is_main_frame,
+                              const String& url) {
+  if (is_main_frame) {
+    lifecycle_.Install(caller);
+    window_object_ready_ = std::chrono::steady_clock::now();
+  }
+}
+
+void Tab::OnDOMReady(View* caller, uint64_t frame_id, bool is_main_frame, const String& url) {
+  // Time our own pages spend parsing and running their scripts.
+  std::string page = url.utf8().data();
+  if (is_main_frame && page.compare(0, 8, "file:///") == 0) {
+    double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - window_object_ready_).count();
+    std::cout << "Tab " << id_ << " parsed and ran " << page << " in " << ms << " ms"
+              << ui_->ComparePageTime(page, ms) << std::endl;
+  }
+
+  if (is_main_frame && url == "file:///new_tab_page.html")
+    ui_->ShowTabPreviews(id_, caller);
+}
+
 void Tab::OnUpdateHistory(View* caller) {
-  ui_->UpdateTabNavigation(id_, caller->is_loading(), caller->CanGoBack(), caller->CanGoForward());
+  ui_->UpdateTabNavigation(id_, caller->is_loading(), CanGoBack(), CanGoForward());
+}
+
+// Strips the characters we use as separators from a session string.
+static std::string SanitizeSessionField(const String& str) {
+  std::string result = str.utf8().data();
+  std::replace_if(result.begin(), result.end(),
+                  [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+  return result;
+}
+
+std::string TabSessionState::Serialize() const {
+  std::string line = std::to_string(scroll_x) + "\t" + std::to_string(scroll_y) + "\t" +
+                     std::to_string(history_index) + "\t" + SanitizeSessionField(title) + "\t" +
+                     SanitizeSessionField(url);
+  for (auto& entry : history)
+    line += "\t" + SanitizeSessionField(entry);
+
+  return line;
+}
+
+bool TabSessionState::Deserialize(const std::string& line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  for (;;) {
+    size_t end = line.find('\t', start);
+    fields.push_back(line.substr(start, end - start));
+    if (end == std::string::npos)
+      break;
+    start = end + 1;
+  }
+
+  if (fields.size() < 5)
+    return false;
+
+  scroll_x = atoi(fields[0].c_str());
+  scroll_y = atoi(fields[1].c_str());
+  history_index = (size_t)strtoul(fields[2].c_str(), nullptr, 10);
+  title = fields[3].c_str();
+  url = fields[4].c_str();
+  history.clear();
+  for (size_t i = 5; i < fields.size(); ++i)
+    history.push_back(fields[i].c_str());
+
+  if (history_index >= history.size())
+    history_index = history.empty() ? 0 : history.size() - 1;
+
+  return true;
 }
@@ -1,10 +1,31 @@
 #pragma once
 #include <AppCore/AppCore.h>
 #include <Ultralight/Listener.h>
+#include "TabLifecycle.h"
+#include <chrono>
+#include <string>
+#include <vector>
 
 class UI;
 using namespace ultralight;
 
+/**
+* Everything we need to bring a discarded tab back: where it was and how it got there. (What it
+* looked like is kept in the UI's ThumbnailCache.)
+*/
+struct TabSessionState {
+  String url;
+  String title;
+  std::vector<String> history;
+  size_t history_index = 0;
+  int scroll_x = 0;
+  int scroll_y = 0;
+
+  // Saves/loads the state as a single line of text.
+  std::string Serialize() const;
+  bool Deserialize(const std::string& line);
+};
+
 /**
 * Browser Tab UI implementation. Renders the actual page content in bottom pane.
 */
@@ -12,13 +33,58 @@ class Tab : public ViewListener,
             public LoadListener {
 public:
   Tab(UI* ui, uint64_t id, uint32_t width, uint32_t height, int x, int y);
+
+  // Creates a placeholder tab from saved session state. No View is created until the tab is
+  // restored (when it is first activated).
+  Tab(UI* ui, uint64_t id, uint32_t width, uint32_t height, int x, int y,
+      const TabSessionState& state);
   ~Tab();
 
   void set_ready_to_close(bool ready) { ready_to_close_ = ready; }
   bool ready_to_close() { return ready_to_close_; }
                 
+  // Only valid while the tab is resident (not discarded).
   RefPtr<View> view() { return overlay_->view(); }
 
+  uint64_t id() const { return id_; }
+
+  String title();
+
+  // Stamped by the UI every time this tab is activated, used to find the least-recently-used tab.
+  void set_last_active(uint64_t stamp) { last_active_ = stamp; }
+  uint64_t last_active() const { return last_active_; }
+
+  bool is_discarded() const { return !overlay_; }
+
+  const TabSessionState& session_state() const { return session_state_; }
+
+  /**
+  * Saves the tab's session state and releases its View (and inspector), freeing the page's DOM,
+  * JS heap and render target. The tab stays in the tab strip and is restored when activated.
+  */
+  void Discard();
+
+  // Recreates the View for a discarded tab. Call StartLoad() afterwards to reload its page.
+  void Restore();
+
+  // Loads the URL from our session state (or the new tab page), called by the UI's load queue.
+  void StartLoad();
+
+  // Stops a load that was admitted by the load queue, it will be started again later.
+  void PreemptLoad();
+
+  // Refreshes our session state from the live View.
+  void UpdateSessionState();
+
+  // Rough estimate of how much memory this tab keeps alive, in bytes.
+  size_t EstimateMemoryUsage() const;
+
+  // Back/forward go through the tab so they keep working after the tab was restored.
+  bool CanGoBack();
+  bool CanGoForward();
+  void GoBack();
+  void GoForward();
+
   void Show();
 
   void Hide();
@@ -57,13 +123,37 @@ public:
   virtual void OnFailLoading(View* caller, uint64_t frame_id,
     bool is_main_frame, const String& url, const String& description,
     const String& error_domain, int error_code) override;
+  virtual void OnWindowObjectReady(View* caller, uint64_t frame_id,
+    bool is_main_frame, const String& url) override;
+  virtual void OnDOMReady(View* caller, uint64_t frame_id,
+    bool is_main_frame, const String& url) override;
   virtual void OnUpdateHistory(View* caller) override;
 
 protected:
+  void CreateOverlay();
+
   UI* ui_;
   RefPtr<Overlay> overlay_;
   RefPtr<Overlay> inspector_overlay_;
+  TabLifecycle lifecycle_;
   uint64_t id_;
   bool ready_to_close_ = false;
   uint32_t container_width_, container_height_;
+  int container_x_, container_y_;
+  uint64_t last_active_ = 0;
+
+  // The history we know about for this tab. A View's own back/forward list is lost when it is
+  // discarded, so once restored we navigate through this list instead.
+  std::vector<String> history_;
+  size_t history_index_ = 0;
+  int pending_history_offset_ = 0;
+  bool use_session_history_ = false;
+
+  TabSessionState session_state_;
+  bool restore_scroll_ = false;
+  bool is_load_preempted_ = false;
+
+  // When the current page's window object was created, the start of parsing it and running its
+  // scripts.
+  std::chrono::steady_clock::time_point window_object_ready_;
 };
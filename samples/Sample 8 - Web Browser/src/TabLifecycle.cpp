@@ -0,0 +1,242 @@
+#include "TabLifecycle.h"
+#include <cstdio>
+
+//
+// Installed into every page before any of its own scripts run.
+//
+// We take over setTimeout/setInterval/requestAnimationFrame so we can hold callbacks back while
+// the tab is hidden:
+//  - Animation frames requested while hidden are queued and only scheduled once we are shown.
+//  - Timers that come due while hidden are pushed back to the next background wake-up (once per
+//    second), so an interval runs at most once per second in the background.
+//  - CSS animations are paused through a stylesheet.
+//
+// The cost of callbacks is sampled while visible so we can estimate how much CPU time the
+// callbacks we skipped would have taken.
+//
+static const char* kLifecycleScript = R"JS(
+(function() {
+  if (window.__tabLifecycle)
+    return;
+
+  var BACKGROUND_WAKE_UP_INTERVAL = 1000;
+  var FRAME_INTERVAL = 1000 / 60;
+
+  var nativeSetTimeout = window.setTimeout.bind(window);
+  var nativeClearTimeout = window.clearTimeout.bind(window);
+  var nativeRequestAnimationFrame = window.requestAnimationFrame.bind(window);
+  var nativeCancelAnimationFrame = window.cancelAnimationFrame.bind(window);
+  var now = performance.now.bind(performance);
+
+  var hidden = false;
+  var hiddenSince = 0;
+  var timerRunsSkipped = 0;
+  var pauseStyle = null;
+  var frameCost = 0;
+  var timerCost = 0;
+
+  function average(avg, sample) {
+    return avg ? avg * 0.9 + sample * 0.1 : sample;
+  }
+
+  function invoke(callback, args) {
+    if (typeof callback === "function")
+      callback.apply(window, args);
+    else
+      (0, eval)(String(callback));
+  }
+
+  var timers = {};
+  var nextTimerId = 1;
+
+  function scheduleTimer(id, delay) {
+    timers[id].handle = nativeSetTimeout(function() { fireTimer(id); }, delay);
+  }
+
+  function fireTimer(id) {
+    var timer = timers[id];
+    if (!timer)
+      return;
+
+    var start = now();
+    if (hidden) {
+      var phase = (start - hiddenSince) % BACKGROUND_WAKE_UP_INTERVAL;
+      if (phase > FRAME_INTERVAL) {
+        scheduleTimer(id, BACKGROUND_WAKE_UP_INTERVAL - phase);
+        return;
+      }
+
+      if (timer.repeat && timer.lastRun)
+        timerRunsSkipped += Math.max(0, Math.floor((start - timer.lastRun) / timer.delay) - 1);
+    }
+
+    timer.lastRun = start;
+    if (timer.repeat)
+      scheduleTimer(id, timer.delay);
+    else
+      delete timers[id];
+
+    invoke(timer.callback, timer.args);
+
+    if (!hidden)
+      timerCost = average(timerCost, now() - start);
+  }
+
+  function addTimer(callback, delay, args, repeat) {
+    var id = nextTimerId++;
+    timers[id] = { callback: callback, args: args, delay: Math.max(Number(delay) || 0, 1),
+                   repeat: repeat, lastRun: 0, handle: 0 };
+    scheduleTimer(id, timers[id].delay);
+    return id;
+  }
+
+  function clearTimer(id) {
+    var timer = timers[id];
+    if (timer) {
+      nativeClearTimeout(timer.handle);
+      delete timers[id];
+    }
+  }
+
+  window.setTimeout = function(callback, delay) {
+    return addTimer(callback, delay, Array.prototype.slice.call(arguments, 2), false);
+  };
+
+  window.setInterval = function(callback, delay) {
+    return addTimer(callback, delay, Array.prototype.slice.call(arguments, 2), true);
+  };
+
+  window.clearTimeout = clearTimer;
+  window.clearInterval = clearTimer;
+
+  var frames = {};
+  var nextFrameId = 1;
+  var queuedFrames = [];
+
+  function scheduleFrame(id) {
+    frames[id].handle = nativeRequestAnimationFrame(function(timestamp) {
+      var frame = frames[id];
+      if (!frame)
+        return;
+
+      delete frames[id];
+      var start = now();
+      frame.callback(timestamp);
+      frameCost = average(frameCost, now() - start);
+    });
+  }
+
+  window.requestAnimationFrame = function(callback) {
+    var id = nextFrameId++;
+    frames[id] = { callback: callback, handle: 0 };
+    if (hidden)
+      queuedFrames.push(id);
+    else
+      scheduleFrame(id);
+    return id;
+  };
+
+  window.cancelAnimationFrame = function(id) {
+    var frame = frames[id];
+    if (frame) {
+      if (frame.handle)
+        nativeCancelAnimationFrame(frame.handle);
+      delete frames[id];
+    }
+  };
+
+  try {
+    Object.defineProperty(document, "hidden", { configurable: true,
+      get: function() { return hidden; } });
+    Object.defineProperty(document, "visibilityState", { configurable: true,
+      get: function() { return hidden ? "hidden" : "visible"; } });
+  } catch (e) {}
+
+  function setHidden(value) {
+    if (value == hidden)
+      return "";
+
+    hidden = value;
+
+    if (hidden) {
+      hiddenSince = now();
+      timerRunsSkipped = 0;
+
+      var parent = document.head || document.documentElement;
+      if (parent) {
+        pauseStyle = document.createElement("style");
+        pauseStyle.textContent =
+          "*, *::before, *::after { animation-play-state: paused !important; }";
+        parent.appendChild(pauseStyle);
+      }
+
+      document.dispatchEvent(new Event("visibilitychange"));
+      return "";
+    }
+
+    var backgroundMs = now() - hiddenSince;
+
+    // Every animation loop that stalled on a queued frame would have run at ~60 FPS.
+    var framesSkipped = queuedFrames.length * Math.floor(backgroundMs / FRAME_INTERVAL);
+    var cpuMsSaved = framesSkipped * frameCost + timerRunsSkipped * timerCost;
+
+    var pending = queuedFrames;
+    queuedFrames = [];
+    pending.forEach(function(id) {
+      if (frames[id])
+        scheduleFrame(id);
+    });
+
+    if (pauseStyle) {
+      pauseStyle.remove();
+      pauseStyle = null;
+    }
+
+    document.dispatchEvent(new Event("visibilitychange"));
+
+    return backgroundMs + " " + framesSkipped + " " + timerRunsSkipped + " " + cpuMsSaved;
+  }
+
+  window.__tabLifecycle = { setHidden: setHidden };
+})();
+)JS";
+
+void TabLifecycle::Install(View* view) {
+  view->EvaluateScript(kLifecycleScript);
+
+  if (is_suspended_)
+    view->EvaluateScript("__tabLifecycle.setHidden(true)");
+}
+
+void TabLifecycle::Suspend(View* view) {
+  if (is_suspended_)
+    return;
+
+  is_suspended_ = true;
+  view->EvaluateScript("window.__tabLifecycle && __tabLifecycle.setHidden(true)");
+}
+
+TabLifecycle::Stats TabLifecycle::Resume(View* view) {
+  Stats stats;
+  if (!is_suspended_)
+    return stats;
+
+  is_suspended_ = false;
+  String result = view->EvaluateScript("window.__tabLifecycle && __tabLifecycle.setHidden(false)");
+
+  unsigned long long frames_skipped, timer_runs_skipped;
+  if (sscanf(result.utf8().data(), "%lf %llu %llu %lf", &stats.background_ms, &frames_skipped,
+             &timer_runs_skipped, &stats.cpu_ms_saved) == 4) {
+    stats.frames_skipped = frames_skipped;
+    stats.timer_runs_skipped = timer_runs_skipped;
+  } else {
+    stats = Stats();
+  }
+
+  totals_.background_ms += stats.background_ms;
+  totals_.frames_skipped += stats.frames_skipped;
+  totals_.timer_runs_skipped += stats.timer_runs_skipped;
+  totals_.cpu_ms_saved += stats.cpu_ms_saved;
+
+  return stats;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <AppCore/AppCore.h>
+
+using namespace ultralight;
+
+/**
+* Throttles a tab's page while the tab is in the background.
+*
+* Hidden tabs keep their View, so left alone they keep running timers, animation frames and CSS
+* animations that nobody can see. We install a small script into every page that lets us freeze
+* requestAnimationFrame, batch timers into one wake-up per second and pause CSS animations while
+* the tab is hidden. Since nothing on the page invalidates anymore, the View stops painting too.
+*/
+class TabLifecycle {
+public:
+  struct Stats {
+    double background_ms = 0;
+    uint64_t frames_skipped = 0;
+    uint64_t timer_runs_skipped = 0;
+    double cpu_ms_saved = 0;
+  };
+
+  // Installs the throttling hooks into a new page, call this from OnWindowObjectReady.
+  void Install(View* view);
+
+  void Suspend(View* view);
+
+  // Resumes the page and returns what was saved while it was suspended.
+  Stats Resume(View* view);
+
+  bool is_suspended() const { return is_suspended_; }
+
+  // Stats accumulated over every time this tab was suspended.
+  const Stats& totals() const { return totals_; }
+
+protected:
+  bool is_suspended_ = false;
+  Stats totals_;
+};
@@ -0,0 +1,229 @@
+#include "ThumbnailCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define THUMBNAIL_WIDTH 320
+
+// Column sums are kept in 16 bits, which holds up to 257 rows of 255.
+#define MAX_BOX_FACTOR 256
+
+static const char* kThumbnailPrefix = "thumbnails/";
+
+// Adds a row of 8-bit channels to a row of 16-bit sums.
+static void AccumulateRow(const uint8_t* src, uint16_t* sums, size_t count) {
+  size_t i = 0;
+#if USE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= count; i += 16) {
+    __m128i pixels = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i lo = _mm_loadu_si128((const __m128i*)(sums + i));
+    __m128i hi = _mm_loadu_si128((const __m128i*)(sums + i + 8));
+    lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(pixels, zero));
+    hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(pixels, zero));
+    _mm_storeu_si128((__m128i*)(sums + i), lo);
+    _mm_storeu_si128((__m128i*)(sums + i + 8), hi);
+  }
+#endif
+  for (; i < count; ++i)
+    sums[i] += src[i];
+}
+
+ThumbnailCache::ThumbnailCache(FileSystem* fallback, const std::string& directory,
+                               size_t max_entries, size_t max_bytes)
+  : fallback_(fallback), directory_(directory), max_entries_(max_entries), max_bytes_(max_bytes) {
+#if defined(_WIN32)
+  _mkdir(directory_.c_str());
+#else
+  mkdir(directory_.c_str(), 0755);
+#endif
+}
+
+ThumbnailCache::~ThumbnailCache() {
+  for (auto& entry : entries_)
+    std::remove((directory_ + "/" + FileName(entry.first, entry.second)).c_str());
+}
+
+String ThumbnailCache::Capture(uint64_t tab_id, Surface* surface) {
+  if (!surface)
+    return String();
+
+  RefPtr<Bitmap> thumbnail = Downscale(surface, THUMBNAIL_WIDTH);
+  if (!thumbnail)
+    return String();
+
+  // Every capture gets a new file name so pages never see a stale cached image.
+  Remove(tab_id);
+
+  Entry entry;
+  entry.version = ++counter_;
+  std::string path = directory_ + "/" + FileName(tab_id, entry);
+  if (!thumbnail->WritePNG(path.c_str()))
+    return String();
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  entry.bytes = file ? (size_t)file.tellg() : 0;
+
+  entries_[tab_id] = entry;
+  total_bytes_ += entry.bytes;
+  EvictEntries();
+
+  return url(tab_id);
+}
+
+void ThumbnailCache::Remove(uint64_t tab_id) {
+  auto i = entries_.find(tab_id);
+  if (i == entries_.end())
+    return;
+
+  std::remove((directory_ + "/" + FileName(i->first, i->second)).c_str());
+  total_bytes_ -= i->second.bytes;
+  entries_.erase(i);
+}
+
+String ThumbnailCache::url(uint64_t tab_id) const {
+  auto i = entries_.find(tab_id);
+  if (i == entries_.end())
+    return String();
+
+  return String(("file:///" + std::string(kThumbnailPrefix) + FileName(i->first, i->second)).c_str());
+}
+
+RefPtr<Bitmap> ThumbnailCache::Downscale(Surface* surface, uint32_t max_width) {
+  uint32_t src_width = surface->width();
+  uint32_t src_height = surface->height();
+  if (!src_width || !src_height || !max_width)
+    return nullptr;
+
+  uint32_t factor = (src_width + max_width - 1) / max_width;
+  factor = std::min(std::max(factor, 1u), (uint32_t)MAX_BOX_FACTOR);
+
+  uint32_t width = src_width / factor;
+  uint32_t height = src_height / factor;
+  if (!width || !height)
+    return nullptr;
+
+  RefPtr<Bitmap> thumbnail = Bitmap::Create(width, height, BitmapFormat::BGRA8_UNORM_SRGB);
+
+  const uint8_t* src = (const uint8_t*)surface->LockPixels();
+  uint8_t* dest = (uint8_t*)thumbnail->LockPixels();
+
+  // Sum each block of 'factor' rows column by column (this is where the time goes, so it's
+  // vectorized) then sum 'factor' columns at a time for every output pixel. Surface pixels are
+  // premultiplied so the channels can be averaged independently.
+  size_t channels = (size_t)width * factor * 4;
+  std::vector<uint16_t> column_sums(channels);
+  uint32_t area = factor * factor;
+
+  for (uint32_t y = 0; y < height; ++y) {
+    std::fill(column_sums.begin(), column_sums.end(), 0);
+    for (uint32_t i = 0; i < factor; ++i)
+      AccumulateRow(src + (size_t)(y * factor + i) * surface->row_bytes(), column_sums.data(),
+                    channels);
+
+    uint8_t* dest_row = dest + (size_t)y * thumbnail->row_bytes();
+    for (uint32_t x = 0; x < width; ++x) {
+      const uint16_t* block = &column_sums[(size_t)x * factor * 4];
+      uint32_t sum[4] = { 0, 0, 0, 0 };
+      for (uint32_t i = 0; i < factor; ++i) {
+        sum[0] += block[i * 4 + 0];
+        sum[1] += block[i * 4 + 1];
+        sum[2] += block[i * 4 + 2];
+        sum[3] += block[i * 4 + 3];
+      }
+
+      for (int c = 0; c < 4; ++c)
+        dest_row[x * 4 + c] = (uint8_t)((sum[c] + area / 2) / area);
+    }
+  }
+
+  thumbnail->UnlockPixels();
+  surface->UnlockPixels();
+
+  return thumbnail;
+}
+
+bool ThumbnailCache::FileExists(const String& file_path) {
+  std::string disk_path;
+  if (!IsThumbnailPath(file_path, disk_path))
+    return fallback_->FileExists(file_path);
+
+  return std::ifstream(disk_path).good();
+}
+
+String ThumbnailCache::GetFileMimeType(const String& file_path) {
+  std::string disk_path;
+  if (!IsThumbnailPath(file_path, disk_path))
+    return fallback_->GetFileMimeType(file_path);
+
+  return "image/png";
+}
+
+String ThumbnailCache::GetFileCharset(const String& file_path) {
+  std::string disk_path;
+  if (!IsThumbnailPath(file_path, disk_path))
+    return fallback_->GetFileCharset(file_path);
+
+  return "utf-8";
+}
+
+RefPtr<Buffer> ThumbnailCache::OpenFile(const String& file_path) {
+  std::string disk_path;
+  if (!IsThumbnailPath(file_path, disk_path))
+    return fallback_->OpenFile(file_path);
+
+  std::ifstream file(disk_path, std::ios::binary);
+  if (!file)
+    return nullptr;
+
+  std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return Buffer::CreateFromCopy(data.data(), data.size());
+}
+
+std::string ThumbnailCache::FileName(uint64_t tab_id, const Entry& entry) const {
+  return "tab_" + std::to_string(tab_id) + "_" + std::to_string(entry.version) + ".png";
+}
+
+bool ThumbnailCache::IsThumbnailPath(const String& file_path, std::string& disk_path) const {
+  std::string path = file_path.utf8().data();
+  if (!path.empty() && path[0] == '/')
+    path = path.substr(1);
+
+  size_t prefix_length = strlen(kThumbnailPrefix);
+  if (path.compare(0, prefix_length, kThumbnailPrefix) != 0)
+    return false;
+
+  std::string name = path.substr(prefix_length);
+  if (name.empty() || name.find('/') != std::string::npos || name.find('\\') != std::string::npos ||
+      name.find("..") != std::string::npos)
+    return false;
+
+  disk_path = directory_ + "/" + name;
+  return true;
+}
+
+void ThumbnailCache::EvictEntries() {
+  while (!entries_.empty() && (entries_.size() > max_entries_ || total_bytes_ > max_bytes_)) {
+    auto oldest = entries_.begin();
+    for (auto i = entries_.begin(); i != entries_.end(); ++i) {
+      if (i->second.version < oldest->second.version)
+        oldest = i;
+    }
+
+    Remove(oldest->first);
+  }
+}
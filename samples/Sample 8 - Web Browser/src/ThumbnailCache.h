@@ -0,0 +1,60 @@
+#pragma once
+#include <AppCore/AppCore.h>
+#include <Ultralight/platform/FileSystem.h>
+#include <map>
+#include <string>
+
+using namespace ultralight;
+
+/**
+* Downscaled snapshots of tabs, used for previews on the new tab page.
+*
+* Snapshots are box-filtered straight from a View's Surface and written to disk as PNG, so a tab
+* can be previewed without keeping its View (or an uncompressed copy of its pixels) around. The
+* cache is bounded by number of entries and total bytes, the least-recently-captured snapshots
+* are evicted first.
+*
+* The cache doubles as a FileSystem: pages can load thumbnails from file:///thumbnails/..., all
+* other paths are forwarded to the file system we wrap.
+*/
+class ThumbnailCache : public FileSystem {
+public:
+  ThumbnailCache(FileSystem* fallback, const std::string& directory, size_t max_entries,
+                 size_t max_bytes);
+  virtual ~ThumbnailCache();
+
+  // Snapshots a tab's surface, returns the URL of the new thumbnail (empty if nothing was captured).
+  String Capture(uint64_t tab_id, Surface* surface);
+
+  void Remove(uint64_t tab_id);
+
+  // URL of the tab's latest thumbnail, empty if we don't have one.
+  String url(uint64_t tab_id) const;
+
+  // Box-filters a surface down by the smallest integer factor that makes it fit in max_width.
+  static RefPtr<Bitmap> Downscale(Surface* surface, uint32_t max_width);
+
+  // Inherited from FileSystem
+  virtual bool FileExists(const String& file_path) override;
+  virtual String GetFileMimeType(const String& file_path) override;
+  virtual String GetFileCharset(const String& file_path) override;
+  virtual RefPtr<Buffer> OpenFile(const String& file_path) override;
+
+protected:
+  struct Entry {
+    uint64_t version; // Increases with every capture
+    size_t bytes;
+  };
+
+  std::string FileName(uint64_t tab_id, const Entry& entry) const;
+  bool IsThumbnailPath(const String& file_path, std::string& disk_path) const;
+  void EvictEntries();
+
+  FileSystem* fallback_;
+  std::string directory_;
+  size_t max_entries_;
+  size_t max_bytes_;
+  size_t total_bytes_ = 0;
+  uint64_t counter_ = 0;
+  std::map<uint64_t, Entry> entries_;
+};
@@ -1,9 +1,38 @@
 #include "UI.h"
+#include <Ultralight/platform/Platform.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
 
 static UI* g_ui = 0;
 
 #define UI_HEIGHT 80
 
+// Once the estimated memory of all tabs goes over this, background tabs are discarded.
+#define TAB_MEMORY_BUDGET (256 * 1024 * 1024)
+
+#define MAX_CONCURRENT_TAB_LOADS 3
+
+// Written to the working directory when the window is closed.
+#define SESSION_FILE "session.txt"
+#define PAGE_TIMES_FILE "page_times.txt"
+
+#define THUMBNAIL_CACHE_DIR "thumbnail_cache"
+#define MAX_THUMBNAILS 64
+#define MAX_THUMBNAIL_BYTES (16 * 1024 * 1024)
+#define MAX_TAB_PREVIEWS 8
+// Shown on the new tab page (and logged) when Views are GPU-rendered, see Browser.cpp.
+#define TAB_PREVIEWS_UNAVAILABLE \
+  "Tab previews need the CPU renderer (force_cpu_renderer in Browser.cpp)."
+
+// Scripts, stylesheets and images from file:/// kept in memory for all Views.
+#define MAX_RESOURCE_CACHE_BYTES (32 * 1024 * 1024)
+
+// Views kept warm for new tabs.
+#define VIEW_POOL_SIZE 2
+
 UI::UI(RefPtr<Window> window) : window_(window), cur_cursor_(Cursor::kCursor_Pointer), 
 is_resizing_inspector_(false), is_over_inspector_resize_drag_handle_(false) {
   uint32_t window_width = window_->width();
@@ -11,8 +40,26 @@ is_resizing_inspector_(false), is_over_inspector_resize_drag_handle_(false) {
   overlay_ = Overlay::Create(window_, window_width, ui_height_, 0, 0);
   g_ui = this;
 
+  // Serve tab thumbnails from file:///thumbnails/ and scripts, stylesheets and images from memory,
+  // on top of the default file system.
+  default_file_system_ = Platform::instance().file_system();
+  resources_.reset(new ResourceCache(default_file_system_, MAX_RESOURCE_CACHE_BYTES));
+  thumbnails_.reset(new ThumbnailCache(resources_.get(), THUMBNAIL_CACHE_DIR, MAX_THUMBNAILS,
+                                       MAX_THUMBNAIL_BYTES));
+  Platform::instance().set_file_system(thumbnails_.get());
+
+  // Thumbnails are read from each tab's Surface, GPU-rendered Views don't have one.
+  thumbnails_enabled_ = App::instance()->settings().force_cpu_renderer;
+  if (!thumbnails_enabled_)
+    std::cout << "Tab thumbnails disabled: " << TAB_PREVIEWS_UNAVAILABLE << std::endl;
+
+  view_pool_.reset(new ViewPool(!App::instance()->settings().force_cpu_renderer));
+  ReserveTabViews();
+
   view()->set_load_listener(this);
   view()->set_view_listener(this);
+  LoadPageTimes();
+  ui_load_start_ = std::chrono::steady_clock::now();
   view()->LoadURL("file:///ui.html");
 }
 
@@ -20,6 +67,12 @@ UI::~UI() {
   view()->set_load_listener(nullptr);
   view()->set_view_listener(nullptr);
   g_ui = nullptr;
+
+  Platform::instance().set_file_system(default_file_system_);
+}
+
+void UI::OnUpdate() {
+  view_pool_->Update();
 }
 
 bool UI::OnKeyEvent(const ultralight::KeyEvent& evt) {
@@ -70,6 +123,8 @@ bool UI::OnMouseEvent(const ultralight::MouseEvent& evt) {
 }
 
 void UI::OnClose(ultralight::Window* window) {
+  SaveSession();
+  SavePageTimes();
   App::instance()->Quit();
 }
 
@@ -85,9 +140,20 @@ void UI::OnResize(ultralight::Window* window, uint32_t width, uint32_t height) {
     if (tab.second)
       tab.second->Resize(window->width(), (uint32_t)tab_height);
   }
+
+  ReserveTabViews();
 }
 
 void UI::OnDOMReady(View* caller, uint64_t frame_id, bool is_main_frame, const String& url) {
+  const ResourceCache::Stats& resources = resources_->stats();
+  double ui_ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - ui_load_start_).count();
+  std::cout << "UI ready in " << ui_ms << " ms" << ComparePageTime(url.utf8().data(), ui_ms)
+            << ": " << resources.misses << " resources read from disk ("
+            << resources.bytes / 1024 << " KB in " << resources.read_ms << " ms, "
+            << resources.bytes_deduplicated / 1024 << " KB deduplicated), " << resources.hits
+            << " from memory" << std::endl;
+
   // Set the context for all subsequent JS* calls
   RefPtr<JSContext> locked_context = view()->LockJSContext();
   SetJSContext(locked_context->ctx());
@@ -100,6 +166,8 @@ void UI::OnDOMReady(View* caller, uint64_t frame_id, bool is_main_frame, const S
   addTab = global["addTab"];
   updateTab = global["updateTab"];
   closeTab = global["closeTab"];
+  setTabDiscarded = global["setTabDiscarded"];
+  selectTab = global["selectTab"];
 
   global["OnBack"] = BindJSCallback(&UI::OnBack);
   global["OnForward"] = BindJSCallback(&UI::OnForward);
@@ -111,17 +179,18 @@ void UI::OnDOMReady(View* caller, uint64_t frame_id, bool is_main_frame, const S
   global["OnActiveTabChange"] = BindJSCallback(&UI::OnActiveTabChange);
   global["OnRequestChangeURL"] = BindJSCallback(&UI::OnRequestChangeURL);
 
-  CreateNewTab();
+  if (!RestoreSession())
+    CreateNewTab();
 }
 
 void UI::OnBack(const JSObject& obj, const JSArgs& args) {
   if (active_tab())
-    active_tab()->view()->GoBack();
+    active_tab()->GoBack();
 }
 
 void UI::OnForward(const JSObject& obj, const JSArgs& args) {
   if (active_tab())
-    active_tab()->view()->GoForward();
+    active_tab()->GoForward();
 }
 
 void UI::OnRefresh(const JSObject& obj, const JSArgs& args) {
@@ -151,8 +220,14 @@ void UI::OnRequestTabClose(const JSObject& obj, const JSArgs& args) {
     if (!tab)
       return;
 
-    if (tabs_.size() == 1 && App::instance())
+    if (tabs_.size() == 1 && App::instance()) {
+      // Closing the last tab doesn't leave anything to restore next time.
+      std::remove(SESSION_FILE);
       App::instance()->Quit();
+    }
+
+    CancelTabLoad(id);
+    thumbnails_->Remove(id);
 
     if (id != active_tab_id_) {
       tabs_[id].reset();
@@ -171,7 +246,9 @@ void UI::OnActiveTabChange(const JSObject& obj, const JSArgs& args) {
   if (args.size() == 1) {
     uint64_t id = args[0];
 
-    if (id == active_tab_id_)
+    // Tabs are selected one after another while the strip is being rebuilt, we activate the
+    // session's active tab ourselves once we're done.
+    if (id == active_tab_id_ || is_restoring_session_)
       return;
 
     auto& tab = tabs_[id];
@@ -185,17 +262,45 @@ void UI::OnActiveTabChange(const JSObject& obj, const JSArgs& args) {
       tabs_.erase(active_tab_id_);
     }
 
-    active_tab_id_ = id;
-    tabs_[active_tab_id_]->Show();
-      
-    auto tab_view = tabs_[active_tab_id_]->view();
-    SetLoading(tab_view->is_loading());
-    SetCanGoBack(tab_view->CanGoBack());
-    SetCanGoForward(tab_view->CanGoBack());
-    SetURL(tab_view->url());
+    ActivateTab(id);
   }
 }
 
+void UI::ActivateTab(uint64_t id) {
+  active_tab_id_ = id;
+  Tab* active = tabs_[active_tab_id_].get();
+  active->set_last_active(++activation_counter_);
+
+  if (active->is_discarded()) {
+    active->Restore();
+    std::cout << "Restored tab " << id << " (" << active->session_state().url.utf8().data()
+              << ")" << std::endl;
+
+    {
+      RefPtr<JSContext> lock(view()->LockJSContext());
+      setTabDiscarded({ id, false });
+    }
+
+    QueueTabLoad(id);
+  } else {
+    // Let the tab jump the queue if its load is still waiting.
+    PumpTabLoads();
+  }
+
+  active->Show();
+    
+  auto tab_view = active->view();
+  SetLoading(tab_view->is_loading());
+  SetCanGoBack(active->CanGoBack());
+  SetCanGoForward(active->CanGoForward());
+  SetURL(tab_view->url());
+
+  // Don't discard tabs while we're being called from inside one of them (eg, while it's
+  // creating a child view), its View is still on the stack. We'll catch up on the next tab change.
+  if (!is_inside_tab_callback_)
+    EnforceTabMemoryBudget();
+}
+
 void UI::OnRequestChangeURL(const JSObject& obj, const JSArgs& args) {
   if (args.size() == 1) {
     ultralight::String url = args[0];
@@ -207,6 +312,22 @@ void UI::OnRequestChangeURL(const JSObject& obj, const JSArgs& args) {
   }
 }
 
+void UI::OnSelectTab(const JSObject& obj, const JSArgs& args) {
+  if (args.size() == 1) {
+    uint64_t id = args[0];
+
+    auto tab = tabs_.find(id);
+    if (tab == tabs_.end() || !tab->second)
+      return;
+
+    // Selecting the tab in the strip lets it activate the tab like a click would.
+    is_inside_tab_callback_ = true;
+    RefPtr<JSContext> lock(view()->LockJSContext());
+    selectTab({ id });
+    is_inside_tab_callback_ = false;
+  }
+}
+
 void UI::CreateNewTab() {
   uint64_t id = tab_id_counter_++;
   RefPtr<Window> window = window_;
@@ -214,7 +335,12 @@ void UI::CreateNewTab() {
   if (tab_height < 1)
     tab_height = 1;
   tabs_[id].reset(new Tab(this, id, window->width(), (uint32_t)tab_height, 0, ui_height_));
-  tabs_[id]->view()->LoadURL("file:///new_tab_page.html");
+  QueueTabLoad(id);
+
+  const ViewPool::Stats& stats = view_pool_->stats();
+  std::cout << "View pool: " << stats.hits << " hits, " << stats.misses << " misses ("
+            << (int)std::round(stats.hit_rate() * 100) << "% hit rate), ~"
+            << (int)std::round(stats.ms_saved()) << " ms saved" << std::endl;
 
   RefPtr<JSContext> lock(view()->LockJSContext());
   addTab({ id, "New Tab", "", tabs_[id]->view()->is_loading() });
@@ -228,8 +354,10 @@ RefPtr<View> UI::CreateNewTabForChildView(const String& url) {
     tab_height = 1;
   tabs_[id].reset(new Tab(this, id, window->width(), (uint32_t)tab_height, 0, ui_height_));
 
+  is_inside_tab_callback_ = true;
   RefPtr<JSContext> lock(view()->LockJSContext());
   addTab({ id, "", url, tabs_[id]->view()->is_loading() });
+  is_inside_tab_callback_ = false;
 
   return tabs_[id]->view();
 }
@@ -258,6 +386,280 @@ void UI::UpdateTabNavigation(uint64_t id, bool is_loading, bool can_go_back, boo
   }
 }
 
+void UI::ReserveTabViews() {
+  int tab_height = window_->height() - ui_height_;
+  if (tab_height < 1)
+    tab_height = 1;
+
+  uint32_t width = window_->width();
+  double scale = window_->scale();
+  if (width == reserved_width_ && (uint32_t)tab_height == reserved_height_ &&
+      scale == reserved_scale_)
+    return;
+
+  // Views of the old size are no use to us anymore.
+  if (reserved_width_)
+    view_pool_->Reserve(reserved_width_, reserved_height_, reserved_scale_, 0);
+
+  reserved_width_ = width;
+  reserved_height_ = (uint32_t)tab_height;
+  reserved_scale_ = scale;
+  view_pool_->Reserve(reserved_width_, reserved_height_, reserved_scale_, VIEW_POOL_SIZE);
+}
+
+void UI::EnforceTabMemoryBudget() {
+  size_t total = 0;
+  for (auto& tab : tabs_) {
+    if (tab.second)
+      total += tab.second->EstimateMemoryUsage();
+  }
+
+  while (total > TAB_MEMORY_BUDGET) {
+    Tab* lru = nullptr;
+    for (auto& tab : tabs_) {
+      Tab* candidate = tab.second.get();
+      if (!candidate || candidate->is_discarded() || candidate->id() == active_tab_id_)
+        continue;
+
+      if (!lru || candidate->last_active() < lru->last_active())
+        lru = candidate;
+    }
+
+    // Only the active tab is left resident.
+    if (!lru)
+      break;
+
+    CancelTabLoad(lru->id());
+
+    size_t before = lru->EstimateMemoryUsage();
+    lru->Discard();
+    size_t reclaimed = before - lru->EstimateMemoryUsage();
+    total -= reclaimed;
+    bytes_reclaimed_ += reclaimed;
+
+    size_t num_resident = 0, num_discarded = 0;
+    for (auto& tab : tabs_) {
+      if (tab.second)
+        tab.second->is_discarded() ? num_discarded++ : num_resident++;
+    }
+
+    std::cout << "Discarded tab " << lru->id() << " (~" << reclaimed / (1024 * 1024)
+              << " MB): " << num_resident << " tabs resident, " << num_discarded
+              << " discarded, " << bytes_reclaimed_ / (1024 * 1024) << " MB reclaimed in total"
+              << std::endl;
+
+    RefPtr<JSContext> lock(view()->LockJSContext());
+    setTabDiscarded({ lru->id(), true });
+  }
+
+  PumpTabLoads();
+}
+
+void UI::QueueTabLoad(uint64_t id) {
+  load_queue_.push_back(id);
+  PumpTabLoads();
+}
+
+void UI::CancelTabLoad(uint64_t id) {
+  load_queue_.erase(std::remove(load_queue_.begin(), load_queue_.end(), id), load_queue_.end());
+  loading_tabs_.erase(std::remove(loading_tabs_.begin(), loading_tabs_.end(), id),
+                      loading_tabs_.end());
+}
+
+void UI::PumpTabLoads() {
+  auto active = std::find(load_queue_.begin(), load_queue_.end(), active_tab_id_);
+  if (active != load_queue_.end()) {
+    load_queue_.erase(active);
+
+    // The active tab never waits. If we're full, stop the oldest background load and put it
+    // back at the front of the queue so it's the next one to resume.
+    if (loading_tabs_.size() >= MAX_CONCURRENT_TAB_LOADS) {
+      uint64_t preempted = loading_tabs_.front();
+      loading_tabs_.erase(loading_tabs_.begin());
+      tabs_[preempted]->PreemptLoad();
+      load_queue_.push_front(preempted);
+    }
+
+    loading_tabs_.push_back(active_tab_id_);
+    tabs_[active_tab_id_]->StartLoad();
+  }
+
+  while (!load_queue_.empty() && loading_tabs_.size() < MAX_CONCURRENT_TAB_LOADS) {
+    uint64_t id = load_queue_.front();
+    load_queue_.pop_front();
+    loading_tabs_.push_back(id);
+    tabs_[id]->StartLoad();
+  }
+}
+
+void UI::OnTabLoadFinished(uint64_t id) {
+  auto i = std::find(loading_tabs_.begin(), loading_tabs_.end(), id);
+  if (i == loading_tabs_.end())
+    return;
+
+  loading_tabs_.erase(i);
+
+  if (session_restore_tabs_ && id == active_tab_id_) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - session_restore_start_);
+    std::cout << "Active tab finished loading " << elapsed.count() << " ms after restoring a "
+              << session_restore_tabs_ << " tab session" << std::endl;
+    session_restore_tabs_ = 0;
+  }
+
+  PumpTabLoads();
+}
+
+void UI::ShowTabPreviews(uint64_t id, View* page) {
+  std::vector<Tab*> previews;
+  for (auto& tab : tabs_) {
+    if (tab.second && tab.first != id && !thumbnails_->url(tab.first).empty())
+      previews.push_back(tab.second.get());
+  }
+
+  std::sort(previews.begin(), previews.end(),
+            [](Tab* a, Tab* b) { return a->last_active() > b->last_active(); });
+  if (previews.size() > MAX_TAB_PREVIEWS)
+    previews.resize(MAX_TAB_PREVIEWS);
+
+  {
+    RefPtr<JSContext> lock(page->LockJSContext());
+    SetJSContext(lock->ctx());
+
+    JSObject global = JSGlobalObject();
+    if (!thumbnails_enabled_) {
+      JSFunction showTabPreviewsUnavailable = global["showTabPreviewsUnavailable"];
+      showTabPreviewsUnavailable({ TAB_PREVIEWS_UNAVAILABLE });
+    } else {
+      global["OnSelectTab"] = BindJSCallback(&UI::OnSelectTab);
+
+      JSFunction addTabPreview = global["addTabPreview"];
+      for (Tab* tab : previews)
+        addTabPreview({ tab->id(), tab->title(), thumbnails_->url(tab->id()) });
+    }
+  }
+
+  // Switch back to our own context, the rest of our JS calls expect it.
+  RefPtr<JSContext> lock(view()->LockJSContext());
+  SetJSContext(lock->ctx());
+}
+
+bool UI::RestoreSession() {
+  std::ifstream file(SESSION_FILE);
+  if (!file)
+    return false;
+
+  std::string line;
+  size_t active_index = 0;
+  if (!std::getline(file, line) || sscanf(line.c_str(), "active %zu", &active_index) != 1)
+    return false;
+
+  std::vector<TabSessionState> states;
+  while (std::getline(file, line)) {
+    TabSessionState state;
+    if (state.Deserialize(line))
+      states.push_back(state);
+  }
+
+  if (states.empty())
+    return false;
+
+  session_restore_start_ = std::chrono::steady_clock::now();
+  session_restore_tabs_ = states.size();
+
+  int tab_height = window_->height() - ui_height_;
+  if (tab_height < 1)
+    tab_height = 1;
+
+  RefPtr<JSContext> lock(view()->LockJSContext());
+  uint64_t active_id = tab_id_counter_;
+
+  is_restoring_session_ = true;
+  for (size_t i = 0; i < states.size(); ++i) {
+    uint64_t id = tab_id_counter_++;
+    tabs_[id].reset(new Tab(this, id, window_->width(), (uint32_t)tab_height, 0, ui_height_,
+                            states[i]));
+    addTab({ id, states[i].title, "", false });
+    setTabDiscarded({ id, true });
+
+    if (i == active_index)
+      active_id = id;
+  }
+  selectTab({ active_id });
+  is_restoring_session_ = false;
+
+  std::cout << "Restored a session with " << states.size() << " tabs, only the active tab is "
+            << "loaded" << std::endl;
+
+  ActivateTab(active_id);
+  return true;
+}
+
+void UI::SaveSession() {
+  std::ofstream file(SESSION_FILE, std::ios::trunc);
+  if (!file)
+    return;
+
+  size_t active_index = 0, index = 0;
+  std::vector<std::string> lines;
+  for (auto& tab : tabs_) {
+    if (!tab.second || tab.second->ready_to_close())
+      continue;
+
+    if (tab.first == active_tab_id_)
+      active_index = index;
+
+    tab.second->UpdateSessionState();
+    lines.push_back(tab.second->session_state().Serialize());
+    index++;
+  }
+
+  file << "active " << active_index << "\n";
+  for (auto& line : lines)
+    file << line << "\n";
+}
+
+std::string UI::ComparePageTime(const std::string& url, double ms) {
+  char comparison[96];
+  auto first = page_ms_.find(url);
+  if (first != page_ms_.end()) {
+    snprintf(comparison, sizeof(comparison), " (loaded again, %.1f ms the first time)",
+             first->second);
+    return comparison;
+  }
+
+  page_ms_[url] = ms;
+  auto previous = previous_page_ms_.find(url);
+  if (previous == previous_page_ms_.end())
+    return " (cold start, no time from a previous launch)";
+
+  snprintf(comparison, sizeof(comparison), " (warm start, %.1f ms last launch)",
+           previous->second);
+  return comparison;
+}
+
+void UI::LoadPageTimes() {
+  std::ifstream file(PAGE_TIMES_FILE);
+  double ms;
+  std::string url;
+  while (file >> ms && std::getline(file >> std::ws, url))
+    previous_page_ms_[url] = ms;
+}
+
+void UI::SavePageTimes() {
+  std::ofstream file(PAGE_TIMES_FILE, std::ios::trunc);
+  if (!file)
+    return;
+
+  // Keep the times of pages we didn't load this launch.
+  std::map<std::string, double> times = previous_page_ms_;
+  for (auto& page : page_ms_)
+    times[page.first] = page.second;
+
+  for (auto& page : times)
+    file << page.second << " " << page.first << "\n";
+}
+
 void UI::SetLoading(bool is_loading) {
   RefPtr<JSContext> lock(view()->LockJSContext());
   updateLoading({ is_loading });
@@ -1,8 +1,15 @@
 #pragma once
 #include <AppCore/AppCore.h>
 #include "Tab.h"
+#include "ResourceCache.h"
+#include "ThumbnailCache.h"
+#include "ViewPool.h"
+#include <chrono>
+#include <deque>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 using ultralight::JSObject;
 using ultralight::JSArgs;
@@ -14,13 +21,17 @@ class Console;
 /**
 * Browser UI implementation. Renders the toolbar/addressbar/tabs in top pane.
 */
-class UI : public WindowListener,
+class UI : public AppListener,
+           public WindowListener,
            public LoadListener,
            public ViewListener {
  public:
   UI(RefPtr<Window> window);
   ~UI();
                
+  // Inherited from AppListener
+  virtual void OnUpdate() override;
+
   // Inherited from WindowListener
   virtual bool OnKeyEvent(const ultralight::KeyEvent& evt) override;
   virtual bool OnMouseEvent(const ultralight::MouseEvent& evt) override;
@@ -45,15 +56,45 @@ class UI : public WindowListener,
   void OnActiveTabChange(const JSObject& obj, const JSArgs& args);
   void OnRequestChangeURL(const JSObject& obj, const JSArgs& args);
 
+  // Called by the new tab page
+  void OnSelectTab(const JSObject& obj, const JSArgs& args);
+
   RefPtr<Window> window() { return window_; }
 
 protected:
+  void ActivateTab(uint64_t id);
   void CreateNewTab();
   RefPtr<View> CreateNewTabForChildView(const String& url);
   void UpdateTabTitle(uint64_t id, const String& title);
   void UpdateTabURL(uint64_t id, const String& url);
   void UpdateTabNavigation(uint64_t id, bool is_loading, bool can_go_back, bool can_go_forward);
 
+  // Keeps Views the size of a tab warm in the ViewPool.
+  void ReserveTabViews();
+
+  // Discards the least-recently-used background tabs until we are back under TAB_MEMORY_BUDGET.
+  void EnforceTabMemoryBudget();
+
+  // Tab loads started by the UI go through a queue that admits at most MAX_CONCURRENT_TAB_LOADS
+  // at a time. The active tab always jumps the queue.
+  void QueueTabLoad(uint64_t id);
+  void CancelTabLoad(uint64_t id);
+  void PumpTabLoads();
+  void OnTabLoadFinished(uint64_t id);
+
+  // Records how long one of our file:/// pages took from window object to DOM ready and returns
+  // how that compares to its first load this launch, or to the last launch (warm start).
+  std::string ComparePageTime(const std::string& url, double ms);
+  void LoadPageTimes();
+  void SavePageTimes();
+
+  // Lists the other tabs (with their thumbnails) on a tab's new tab page, or says why it can't.
+  void ShowTabPreviews(uint64_t id, View* page);
+
+  // Session restore creates placeholder tabs, only the active tab is loaded.
+  bool RestoreSession();
+  void SaveSession();
+
   void SetLoading(bool is_loading);
   void SetCanGoBack(bool can_go_back);
   void SetCanGoForward(bool can_go_forward);
@@ -71,6 +112,14 @@ protected:
   float scale_;
 
   std::map<uint64_t, std::unique_ptr<Tab>> tabs_;
+  std::unique_ptr<ResourceCache> resources_;
+  std::unique_ptr<ThumbnailCache> thumbnails_;
+  bool thumbnails_enabled_;  // Only with the CPU renderer, see Browser.cpp
+  std::unique_ptr<ViewPool> view_pool_;
+  uint32_t reserved_width_ = 0;
+  uint32_t reserved_height_ = 0;
+  double reserved_scale_ = 0;
+  FileSystem* default_file_system_;
   uint64_t active_tab_id_ = 0;
   uint64_t tab_id_counter_ = 0;
   Cursor cur_cursor_;
@@ -78,6 +127,17 @@ protected:
   bool is_over_inspector_resize_drag_handle_;
   int inspector_resize_begin_height_;
   int inspector_resize_begin_mouse_y_;
+  uint64_t activation_counter_ = 0;
+  uint64_t bytes_reclaimed_ = 0;
+  bool is_inside_tab_callback_ = false;
+  bool is_restoring_session_ = false;
+  std::deque<uint64_t> load_queue_;
+  std::vector<uint64_t> loading_tabs_; // In the order they were admitted
+  std::chrono::steady_clock::time_point ui_load_start_;
+  std::map<std::string, double> page_ms_;           // First load of each page this launch
+  std::map<std::string, double> previous_page_ms_;  // The same, from the last launch
+  std::chrono::steady_clock::time_point session_restore_start_;
+  size_t session_restore_tabs_ = 0;
 
   JSFunction updateBack;
   JSFunction updateForward;
@@ -86,6 +146,8 @@ protected:
   JSFunction addTab;
   JSFunction updateTab;
   JSFunction closeTab;
+  JSFunction setTabDiscarded;
+  JSFunction selectTab;
 
   friend class Tab;
 };
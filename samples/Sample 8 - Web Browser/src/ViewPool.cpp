@@ -0,0 +1,79 @@
+#include "ViewPool.h"
+#include <chrono>
+
+double ViewPool::Stats::ms_saved() const {
+  uint64_t views_created = views_warmed + misses;
+  if (!views_created)
+    return 0;
+
+  return hits * (warm_ms + miss_ms) / views_created;
+}
+
+ViewPool::ViewPool(bool is_accelerated) : is_accelerated_(is_accelerated) {
+}
+
+ViewPool::~ViewPool() {
+  views_.clear();
+}
+
+void ViewPool::Reserve(uint32_t width, uint32_t height, double scale, size_t count) {
+  Key key = { width, height, scale };
+  if (count) {
+    reserved_[key] = count;
+    return;
+  }
+
+  reserved_.erase(key);
+  views_.erase(key);
+}
+
+RefPtr<View> ViewPool::Acquire(uint32_t width, uint32_t height, double scale) {
+  Key key = { width, height, scale };
+
+  auto pooled = views_.find(key);
+  if (pooled != views_.end() && !pooled->second.empty()) {
+    RefPtr<View> view = pooled->second.front();
+    pooled->second.pop_front();
+    stats_.hits++;
+    return view;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  RefPtr<View> view = CreateWarmView(key);
+  stats_.miss_ms += std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+  stats_.misses++;
+  return view;
+}
+
+void ViewPool::Update() {
+  for (auto& reserved : reserved_) {
+    auto& views = views_[reserved.first];
+    if (views.size() >= reserved.second)
+      continue;
+
+    auto start = std::chrono::steady_clock::now();
+    views.push_back(CreateWarmView(reserved.first));
+    stats_.warm_ms += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+    stats_.views_warmed++;
+
+    // One View per update so we never hold up a frame for long.
+    return;
+  }
+}
+
+RefPtr<View> ViewPool::CreateWarmView(const Key& key) {
+  // Same config Overlay::Create() would use for a View in our window.
+  ViewConfig view_config;
+  view_config.is_accelerated = is_accelerated_;
+  view_config.initial_device_scale = key.scale;
+
+  RefPtr<View> view = App::instance()->renderer()->CreateView(key.width, key.height, view_config,
+                                                              nullptr);
+
+  // Running any script sets up the page's JavaScript context, without navigating (which would
+  // leave an about:blank entry in the View's history).
+  view->EvaluateScript("0");
+  return view;
+}
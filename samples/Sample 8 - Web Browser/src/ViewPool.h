@@ -0,0 +1,71 @@
+#pragma once
+#include <AppCore/AppCore.h>
+#include <deque>
+#include <map>
+
+using namespace ultralight;
+
+/**
+* Keeps a few pre-created Views around so new tabs don't have to wait for one.
+*
+* Creating a View and bringing up its first page (the JS context, default stylesheets and render
+* target) is on the critical path of opening a tab. The pool does that ahead of time, spread out
+* over app updates, and hands the Views out on demand.
+*
+* Pooled Views are fresh and still on their initial about:blank document (we only touch its
+* JavaScript to create the context), so they have no history. Views are never returned to the
+* pool, a used View can't be made clean again.
+*
+* Views are keyed by size and device scale, Reserve() says how many of each to keep warm.
+*/
+class ViewPool {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t views_warmed = 0;
+    double warm_ms = 0;      // Total time spent creating Views ahead of time
+    double miss_ms = 0;      // Total time callers waited on Views we didn't have
+
+    double hit_rate() const { return hits + misses ? (double)hits / (hits + misses) : 0; }
+
+    // Hits times the average cost of creating a View.
+    double ms_saved() const;
+  };
+
+  ViewPool(bool is_accelerated);
+  ~ViewPool();
+
+  // Keep 'count' Views of this size warm (0 to drop the ones we have).
+  void Reserve(uint32_t width, uint32_t height, double scale, size_t count);
+
+  // Hands out a warm View if we have one (a hit), otherwise creates one on the spot (a miss).
+  RefPtr<View> Acquire(uint32_t width, uint32_t height, double scale);
+
+  // Creates at most one View to top up the pool, call this once per app update.
+  void Update();
+
+  const Stats& stats() const { return stats_; }
+
+protected:
+  struct Key {
+    uint32_t width;
+    uint32_t height;
+    double scale;
+
+    bool operator<(const Key& other) const {
+      if (width != other.width)
+        return width < other.width;
+      if (height != other.height)
+        return height < other.height;
+      return scale < other.scale;
+    }
+  };
+
+  RefPtr<View> CreateWarmView(const Key& key);
+
+  bool is_accelerated_;
+  std::map<Key, size_t> reserved_;
+  std::map<Key, std::deque<RefPtr<View>>> views_;
+  Stats stats_;
+};
@@ -0,0 +1,221 @@
+#include "Rope.h"
+#include <algorithm>
+
+using ultralight::Char16;
+
+// Leaves are built at this size and are split once they grow past twice this size.
+static const size_t kLeafSize = 1024;
+
+// Trees deeper than this are flattened and rebuilt (typing in one spot deepens the tree slowly).
+static const int kMaxDepth = 48;
+
+static size_t CountNewlines(const Char16* text, size_t len) {
+  size_t count = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (text[i] == '\n')
+      count++;
+  }
+  return count;
+}
+
+struct Rope::Node {
+  std::unique_ptr<Node> left;
+  std::unique_ptr<Node> right;
+  std::vector<Char16> text; // Only used by leaves
+  size_t length = 0;
+  size_t newlines = 0;
+  int depth = 0;
+
+  bool is_leaf() const { return !left; }
+
+  void UpdateFromChildren() {
+    length = left->length + right->length;
+    newlines = left->newlines + right->newlines;
+    depth = 1 + std::max(left->depth, right->depth);
+  }
+};
+
+Rope::Rope() {
+}
+
+Rope::~Rope() {
+}
+
+void Rope::Assign(const ultralight::String& text) {
+  const ultralight::String16& utf16 = text.utf16();
+  root_ = Build(utf16.data(), utf16.length());
+}
+
+void Rope::Insert(size_t offset, const Char16* text, size_t len) {
+  if (!len)
+    return;
+
+  Insert(root_, std::min(offset, length()), text, len);
+  Rebalance();
+}
+
+void Rope::Erase(size_t offset, size_t len) {
+  size_t total = length();
+  if (offset >= total || !len)
+    return;
+
+  Erase(root_, offset, std::min(len, total - offset));
+  Rebalance();
+}
+
+size_t Rope::OffsetFromPosition(size_t row, size_t column) const {
+  if (!root_)
+    return 0;
+
+  if (row > root_->newlines)
+    return root_->length;
+
+  size_t line_start = 0;
+
+  if (row > 0) {
+    // Find the offset just past the row-th line break.
+    const Node* node = root_.get();
+    size_t remaining = row;
+    while (!node->is_leaf()) {
+      if (node->left->newlines >= remaining) {
+        node = node->left.get();
+      } else {
+        remaining -= node->left->newlines;
+        line_start += node->left->length;
+        node = node->right.get();
+      }
+    }
+
+    for (size_t i = 0; i < node->text.size(); ++i) {
+      if (node->text[i] == '\n' && --remaining == 0) {
+        line_start += i + 1;
+        break;
+      }
+    }
+  }
+
+  return std::min(line_start + column, root_->length);
+}
+
+size_t Rope::length() const {
+  return root_ ? root_->length : 0;
+}
+
+size_t Rope::line_count() const {
+  return root_ ? root_->newlines + 1 : 1;
+}
+
+ultralight::String Rope::ToString() const {
+  if (!root_)
+    return ultralight::String();
+
+  std::vector<Char16> buffer(root_->length);
+  CopyTo(root_.get(), buffer.data());
+  return ultralight::String(buffer.data(), buffer.size());
+}
+
+std::unique_ptr<Rope::Node> Rope::Build(const Char16* text, size_t len) {
+  if (!len)
+    return nullptr;
+
+  std::unique_ptr<Node> node(new Node());
+
+  if (len <= kLeafSize) {
+    node->text.assign(text, text + len);
+    node->length = len;
+    node->newlines = CountNewlines(text, len);
+    return node;
+  }
+
+  size_t mid = len / 2;
+  node->left = Build(text, mid);
+  node->right = Build(text + mid, len - mid);
+  node->UpdateFromChildren();
+  return node;
+}
+
+void Rope::Insert(std::unique_ptr<Node>& node, size_t offset, const Char16* text, size_t len) {
+  if (!node) {
+    node = Build(text, len);
+    return;
+  }
+
+  if (node->is_leaf()) {
+    node->text.insert(node->text.begin() + offset, text, text + len);
+    node->length += len;
+    node->newlines += CountNewlines(text, len);
+
+    if (node->length > kLeafSize * 2) {
+      std::unique_ptr<Node> split = Build(node->text.data(), node->text.size());
+      node = std::move(split);
+    }
+    return;
+  }
+
+  if (offset <= node->left->length)
+    Insert(node->left, offset, text, len);
+  else
+    Insert(node->right, offset - node->left->length, text, len);
+
+  node->UpdateFromChildren();
+}
+
+void Rope::Erase(std::unique_ptr<Node>& node, size_t offset, size_t len) {
+  if (node->is_leaf()) {
+    auto begin = node->text.begin() + offset;
+    node->newlines -= CountNewlines(&node->text[offset], len);
+    node->text.erase(begin, begin + len);
+    node->length -= len;
+
+    if (!node->length)
+      node.reset();
+    return;
+  }
+
+  size_t left_length = node->left->length;
+  if (offset < left_length) {
+    size_t left_part = std::min(len, left_length - offset);
+    Erase(node->left, offset, left_part);
+    if (len > left_part)
+      Erase(node->right, 0, len - left_part);
+  } else {
+    Erase(node->right, offset - left_length, len);
+  }
+
+  if (!node->left) {
+    std::unique_ptr<Node> child = std::move(node->right);
+    node = std::move(child);
+  } else if (!node->right) {
+    std::unique_ptr<Node> child = std::move(node->left);
+    node = std::move(child);
+  } else if (node->left->is_leaf() && node->right->is_leaf() &&
+             node->left->length + node->right->length <= kLeafSize) {
+    // Merge small siblings so repeated deletes don't leave a trail of tiny leaves.
+    std::unique_ptr<Node> merged = std::move(node->left);
+    merged->text.insert(merged->text.end(), node->right->text.begin(), node->right->text.end());
+    merged->length += node->right->length;
+    merged->newlines += node->right->newlines;
+    node = std::move(merged);
+  } else {
+    node->UpdateFromChildren();
+  }
+}
+
+void Rope::CopyTo(const Node* node, Char16* dest) {
+  if (node->is_leaf()) {
+    std::copy(node->text.begin(), node->text.end(), dest);
+    return;
+  }
+
+  CopyTo(node->left.get(), dest);
+  CopyTo(node->right.get(), dest + node->left->length);
+}
+
+void Rope::Rebalance() {
+  if (!root_ || root_->depth <= kMaxDepth)
+    return;
+
+  std::vector<Char16> buffer(root_->length);
+  CopyTo(root_.get(), buffer.data());
+  root_ = Build(buffer.data(), buffer.size());
+}
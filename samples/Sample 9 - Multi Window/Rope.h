@@ -0,0 +1,58 @@
+#pragma once
+#include <Ultralight/String.h>
+#include <memory>
+#include <vector>
+
+///
+/// A rope of UTF-16 code units that mirrors the editor's document on the native side.
+///
+/// Ace reports edits as (row, column) ranges, so every node also keeps track of how many line
+/// breaks it contains. This lets us resolve a position to an offset in O(log n) instead of
+/// re-scanning the whole document for every change.
+///
+class Rope {
+public:
+  Rope();
+  ~Rope();
+
+  ///
+  /// Replace the entire contents of the rope.
+  ///
+  void Assign(const ultralight::String& text);
+
+  ///
+  /// Insert 'len' code units at 'offset' (clamped to the end of the document).
+  ///
+  void Insert(size_t offset, const ultralight::Char16* text, size_t len);
+
+  ///
+  /// Remove 'len' code units starting at 'offset' (clamped to the end of the document).
+  ///
+  void Erase(size_t offset, size_t len);
+
+  ///
+  /// Convert a zero-based (row, column) position to an offset, clamped to the document.
+  ///
+  size_t OffsetFromPosition(size_t row, size_t column) const;
+
+  size_t length() const;
+
+  size_t line_count() const;
+
+  ///
+  /// Flatten the rope into a single String.
+  ///
+  ultralight::String ToString() const;
+
+private:
+  struct Node;
+
+  static std::unique_ptr<Node> Build(const ultralight::Char16* text, size_t len);
+  static void Insert(std::unique_ptr<Node>& node, size_t offset, const ultralight::Char16* text,
+                     size_t len);
+  static void Erase(std::unique_ptr<Node>& node, size_t offset, size_t len);
+  static void CopyTo(const Node* node, ultralight::Char16* dest);
+  void Rebalance();
+
+  std::unique_ptr<Node> root_;
+};
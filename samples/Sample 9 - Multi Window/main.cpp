@@ -2,12 +2,32 @@
 #include <AppCore/Window.h>
 #include <AppCore/Overlay.h>
 #include <AppCore/JSHelpers.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <memory>
+#include "Rope.h"
 
 using namespace ultralight;
 
 const char* htmlString();
 
+///
+/// Bounds (in milliseconds) for how long the editor page waits between flushing batches of edits.
+///
+#define MIN_FLUSH_DELAY 16
+#define MAX_FLUSH_DELAY 500
+
+///
+/// Flattening the document and re-parsing it in the preview costs O(n) no matter how small the
+/// edit, so the preview is only refreshed once the editor has been idle for PREVIEW_IDLE_DELAY
+/// milliseconds. While typing continues it is refreshed at most every PREVIEW_MIN_INTERVAL
+/// milliseconds, or PREVIEW_COST_FACTOR times as long as the last refresh took if that's longer.
+///
+#define PREVIEW_IDLE_DELAY 250
+#define PREVIEW_MIN_INTERVAL 1000
+#define PREVIEW_COST_FACTOR 10
+
 ///
 /// Welcome to Sample 9!
 ///
@@ -55,12 +75,18 @@ class EditorListener {
 public:
   EditorListener() {}
   virtual ~EditorListener() {}
-  virtual void OnUpdateEditor(const ultralight::String& content) = 0;
+
+  ///
+  /// Called after each full sync or batch of deltas, with the number of deltas in the batch (0
+  /// for a full sync) and how long it took to apply.
+  ///
+  virtual void OnUpdateEditor(const Rope& document, size_t num_deltas, double apply_ms) = 0;
 };
 
 class EditorWindow : public HTMLWindow,
                      public LoadListener {
   EditorListener* editor_listener_ = nullptr;
+  Rope document_;
 public:
   EditorWindow(const char* title, const char* url, int x, int y, int width, int height) 
     : HTMLWindow(title, url, x, y, width, height) {
@@ -71,6 +97,8 @@ public:
 
   EditorListener* editor_listener() { return editor_listener_; }
 
+  const Rope& document() const { return document_; }
+
   ///
   /// Inherited from LoadListener, called when the page has finished parsing
   /// the document.
@@ -107,7 +135,15 @@ public:
     ///
     global["UpdateEditor"] = BindJSCallbackWithRetval(&EditorWindow::UpdateEditor);
 
-    caller->EvaluateScript("var content = editor.getSession().getValue(); UpdateEditor(content);");
+    ///
+    /// Bind EditorWindow::ApplyEditorDeltas to the JavaScript function named "ApplyEditorDeltas".
+    ///
+    /// After the initial sync, the page only sends us what changed, we keep our own copy of the
+    /// document up to date in 'document_'.
+    ///
+    global["ApplyEditorDeltas"] = BindJSCallbackWithRetval(&EditorWindow::ApplyEditorDeltas);
+
+    caller->EvaluateScript("syncEditorContent();");
   }
 
   ///
@@ -115,18 +151,86 @@ public:
   /// JavaScript by calling UpdateEditor(). We bind the callback within
   /// the DOMReady callback defined below.
   ///
+  /// This receives the entire document, the page only uses it for the initial sync and whenever
+  /// too many edits have piled up to be worth sending individually.
+  ///
   JSValue UpdateEditor(const JSObject& thisObject, const JSArgs& args) {
-    if (editor_listener_ && args.size() == 1)
-      editor_listener_->OnUpdateEditor(args[0].ToString());
+    if (args.size() == 1) {
+      auto start = std::chrono::steady_clock::now();
+      document_.Assign(args[0].ToString());
+      NotifyListener(0, start);
+    }
 
     return JSValue();
   }
+
+  ///
+  /// Native JavaScript callback that receives a batch of Ace change deltas, flattened into an
+  /// array of [action, startRow, startColumn, endRow, endColumn, text] tuples (action is 1 for
+  /// an insert and 0 for a removal).
+  ///
+  /// We return how many milliseconds the page should wait before sending the next batch. This
+  /// scales with how long it took us to apply this one so the page coalesces more edits per
+  /// batch when we start falling behind.
+  ///
+  JSValue ApplyEditorDeltas(const JSObject& thisObject, const JSArgs& args) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (args.size() == 1 && args[0].IsArray()) {
+      JSArray deltas = args[0].ToArray();
+      unsigned length = deltas.length();
+
+      size_t num_deltas = length / 6;
+      for (unsigned i = 0; i + 5 < length; i += 6) {
+        bool is_insert = deltas[i].ToBoolean();
+        size_t begin = document_.OffsetFromPosition((size_t)deltas[i + 1].ToNumber(),
+                                                    (size_t)deltas[i + 2].ToNumber());
+        if (is_insert) {
+          String text = deltas[i + 5].ToString();
+          const String16& utf16 = text.utf16();
+          document_.Insert(begin, utf16.data(), utf16.length());
+        } else {
+          size_t end = document_.OffsetFromPosition((size_t)deltas[i + 3].ToNumber(),
+                                                    (size_t)deltas[i + 4].ToNumber());
+          if (end > begin)
+            document_.Erase(begin, end - begin);
+        }
+      }
+
+      NotifyListener(num_deltas, start);
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+
+    return JSValue(std::min(std::max(elapsed_ms * 2.0, (double)MIN_FLUSH_DELAY),
+                            (double)MAX_FLUSH_DELAY));
+  }
+
+protected:
+  void NotifyListener(size_t num_deltas, std::chrono::steady_clock::time_point start) {
+    if (editor_listener_)
+      editor_listener_->OnUpdateEditor(document_, num_deltas, std::chrono::duration<double,
+        std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
 };
 
-class MyApp : public EditorListener  {
+class MyApp : public EditorListener,
+              public AppListener {
   RefPtr<App> app_;
   std::unique_ptr<EditorWindow> editor_window_;
   std::unique_ptr<HTMLWindow> preview_window_;
+
+  ///
+  /// Edits the preview hasn't caught up with yet.
+  ///
+  bool preview_stale_ = false;
+  std::chrono::steady_clock::time_point last_edit_;
+  std::chrono::steady_clock::time_point last_refresh_;
+  double last_refresh_ms_ = 0;
+  size_t num_batches_ = 0;
+  size_t num_deltas_ = 0;
+  double apply_ms_ = 0;
 public:
   MyApp() {
     ///
@@ -136,6 +240,7 @@ public:
     /// and is required to create any windows.
     ///
     app_ = App::Create();
+    app_->set_listener(this);
 
     editor_window_.reset(new EditorWindow("Ultralight Sample 9 - HTML Editor", "file:///editor.html", 50, 50, 600, 700));
     editor_window_->set_editor_listener(this);
@@ -145,13 +250,64 @@ public:
 
   virtual ~MyApp() {}
 
-  virtual void OnUpdateEditor(const ultralight::String& content) {
+  virtual void OnUpdateEditor(const Rope& document, size_t num_deltas, double apply_ms) override {
+    preview_stale_ = true;
+    last_edit_ = std::chrono::steady_clock::now();
+    num_batches_++;
+    num_deltas_ += num_deltas;
+    apply_ms_ += apply_ms;
+  }
+
+  ///
+  /// Inherited from AppListener, called every time the App updates. We refresh the preview
+  /// here once the edits have settled.
+  ///
+  virtual void OnUpdate() override {
+    if (!preview_stale_)
+      return;
+
+    auto now = std::chrono::steady_clock::now();
+    double idle_ms = std::chrono::duration<double, std::milli>(now - last_edit_).count();
+    double since_refresh_ms = std::chrono::duration<double, std::milli>(now - last_refresh_).count();
+    double max_wait_ms = std::max((double)PREVIEW_MIN_INTERVAL,
+                                  last_refresh_ms_ * PREVIEW_COST_FACTOR);
+
+    if (idle_ms >= PREVIEW_IDLE_DELAY || since_refresh_ms >= max_wait_ms)
+      RefreshPreview();
+  }
+
+  ///
+  /// Flatten the document and write it into the preview, then report what the edits since the
+  /// last refresh and the refresh itself cost for a document of this size.
+  ///
+  void RefreshPreview() {
+    const Rope& document = editor_window_->document();
+
+    auto start = std::chrono::steady_clock::now();
+    String content = document.ToString();
+    auto flattened = std::chrono::steady_clock::now();
+
     RefPtr<JSContext> context = preview_window_->view()->LockJSContext();
     SetJSContext(context->ctx());
     JSObject global = JSGlobalObject();
     global["html_content"] = content;
 
     preview_window_->view()->EvaluateScript("document.open(); document.write(html_content); document.close();");
+    auto written = std::chrono::steady_clock::now();
+
+    double flatten_ms = std::chrono::duration<double, std::milli>(flattened - start).count();
+    double write_ms = std::chrono::duration<double, std::milli>(written - flattened).count();
+    std::cout << "Document: " << document.length() * sizeof(Char16) / 1024 << " KB, "
+              << document.line_count() << " lines. " << num_batches_ << " batches ("
+              << num_deltas_ << " deltas) applied in " << apply_ms_ << " ms, preview flattened in "
+              << flatten_ms << " ms and written in " << write_ms << " ms" << std::endl;
+
+    preview_stale_ = false;
+    last_refresh_ = written;
+    last_refresh_ms_ = flatten_ms + write_ms;
+    num_batches_ = 0;
+    num_deltas_ = 0;
+    apply_ms_ = 0;
   }
 
   void Run() {